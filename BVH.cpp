@@ -0,0 +1,257 @@
+// ======================================================================== //
+// Copyright 2018-2024 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "BVH.h"
+//std
+#include <algorithm>
+
+/*! \namespace osc - Optix Siggraph Course */
+namespace osc {
+
+  static_assert(sizeof(WideBVH::Node) == 64,
+                "a wide BVH node should fill exactly one cache line");
+
+  namespace {
+
+    enum { NUM_BINS = 16 };
+
+    /*! temporary, full-precision binary node; only lives during the
+        build, and gets collapsed into wide nodes afterwards */
+    struct BinaryNode {
+      box3f    bounds;
+      uint32_t begin, count;
+      int32_t  child[2] { -1, -1 };
+
+      bool isLeaf() const { return child[0] < 0; }
+    };
+
+    struct BinaryBuilder {
+      const std::vector<box3f> &primBounds;
+      std::vector<vec3f>       centroids;
+      std::vector<uint32_t>   &primIDs;
+      std::vector<BinaryNode>  nodes;
+
+      BinaryBuilder(const std::vector<box3f> &primBounds,
+                    std::vector<uint32_t> &primIDs)
+        : primBounds(primBounds), primIDs(primIDs)
+      {
+        centroids.resize(primBounds.size());
+        primIDs.resize(primBounds.size());
+        for (size_t i=0;i<primBounds.size();i++) {
+          centroids[i] = primBounds[i].center();
+          primIDs[i]   = (uint32_t)i;
+        }
+      }
+
+      /*! binned SAH build of the given range of primIDs[]; returns
+          index of the created node */
+      int build(uint32_t begin, uint32_t count)
+      {
+        const int nodeID = (int)nodes.size();
+        nodes.push_back(BinaryNode());
+
+        box3f bounds, centBounds;
+        for (uint32_t i=begin;i<begin+count;i++) {
+          bounds.extend(primBounds[primIDs[i]]);
+          centBounds.extend(centroids[primIDs[i]]);
+        }
+        nodes[nodeID].bounds = bounds;
+        nodes[nodeID].begin  = begin;
+        nodes[nodeID].count  = count;
+        if (count == 1) return nodeID;
+
+        const int   dim    = arg_max(centBounds.span());
+        const float lo     = centBounds.lower[dim];
+        const float extent = centBounds.span()[dim];
+
+        uint32_t mid = begin + count/2;
+        if (extent > 0.f) {
+          // bin primitives, then sweep for cheapest SAH split
+          box3f    binBounds[NUM_BINS];
+          uint32_t binCount[NUM_BINS] = { 0 };
+          const float scale = NUM_BINS*(1.f-1e-5f)/extent;
+          for (uint32_t i=begin;i<begin+count;i++) {
+            const uint32_t primID = primIDs[i];
+            int bin = int((centroids[primID][dim]-lo)*scale);
+            bin = std::min(std::max(bin,0),NUM_BINS-1);
+            binBounds[bin].extend(primBounds[primID]);
+            binCount[bin]++;
+          }
+          float    rightArea[NUM_BINS];
+          uint32_t rightCount[NUM_BINS];
+          box3f    accum;
+          uint32_t accumCount = 0;
+          for (int b=NUM_BINS-1;b>0;--b) {
+            accum.extend(binBounds[b]);
+            accumCount += binCount[b];
+            rightArea[b]  = accumCount ? area(accum) : 0.f;
+            rightCount[b] = accumCount;
+          }
+          accum = box3f();
+          accumCount = 0;
+          float bestCost = count * area(bounds);
+          int   bestBin  = -1;
+          for (int b=1;b<NUM_BINS;b++) {
+            accum.extend(binBounds[b-1]);
+            accumCount += binCount[b-1];
+            if (accumCount == 0 || rightCount[b] == 0) continue;
+            const float cost
+              = accumCount * area(accum) + rightCount[b] * rightArea[b];
+            if (cost < bestCost) { bestCost = cost; bestBin = b; }
+          }
+
+          if (bestBin < 0 && count <= MAX_LEAF_PRIMS)
+            return nodeID;
+
+          if (bestBin > 0) {
+            auto it = std::partition(primIDs.begin()+begin,
+                                     primIDs.begin()+begin+count,
+                                     [&](uint32_t primID) {
+                                       int bin = int((centroids[primID][dim]-lo)*scale);
+                                       return std::min(std::max(bin,0),NUM_BINS-1) < bestBin;
+                                     });
+            mid = uint32_t(it - primIDs.begin());
+          } else {
+            std::nth_element(primIDs.begin()+begin,
+                             primIDs.begin()+mid,
+                             primIDs.begin()+begin+count,
+                             [&](uint32_t a, uint32_t b) {
+                               return centroids[a][dim] < centroids[b][dim];
+                             });
+          }
+        } else if (count <= MAX_LEAF_PRIMS) {
+          // all centroids on the same spot - no point in splitting
+          return nodeID;
+        }
+
+        const int left  = build(begin,mid-begin);
+        const int right = build(mid,begin+count-mid);
+        nodes[nodeID].child[0] = left;
+        nodes[nodeID].child[1] = right;
+        return nodeID;
+      }
+
+      enum { MAX_LEAF_PRIMS = WideBVH::MAX_LEAF_SIZE };
+    };
+
+    /*! compute the (conservative) quantization of given child box
+        relative to the parent's quantization grid */
+    void quantize(WideBVH::Node &node, int slot, const box3f &box)
+    {
+      for (int d=0;d<3;d++) {
+        const float scale = ldexpf(1.f,node.exponent[d]);
+        int lo = (int)floorf((box.lower[d]-node.origin[d])/scale);
+        int hi = (int)ceilf ((box.upper[d]-node.origin[d])/scale);
+        lo = std::min(std::max(lo,0),255);
+        hi = std::min(std::max(hi,0),255);
+        // float rounding in origin+q*scale may make the decoded box
+        // slightly too small - widen until it's conservative
+        while (lo > 0   && node.origin[d]+lo*scale > box.lower[d]) --lo;
+        while (hi < 255 && node.origin[d]+hi*scale < box.upper[d]) ++hi;
+        node.lower[d][slot] = (uint8_t)lo;
+        node.upper[d][slot] = (uint8_t)hi;
+      }
+    }
+
+    /*! set up the parent's quantization grid such that 255 steps
+        cover the entire parent box */
+    void setupGrid(WideBVH::Node &node, const box3f &bounds)
+    {
+      node.origin = bounds.lower;
+      for (int d=0;d<3;d++) {
+        const float extent = bounds.upper[d]-bounds.lower[d];
+        int e = -100;
+        if (extent > 0.f) {
+          int exp2;
+          frexpf(extent/255.f,&exp2);
+          e = std::max(exp2,-100);
+        }
+        while (e < 127 && bounds.lower[d] + 255.f*ldexpf(1.f,e) < bounds.upper[d])
+          ++e;
+        node.exponent[d] = (int8_t)e;
+      }
+    }
+  }
+
+  /*! (re-)build over the given primitive bounds; primitive i in
+      traversal refers to primBounds[i] */
+  void WideBVH::build(const std::vector<box3f> &primBounds)
+  {
+    nodes.clear();
+    primIDs.clear();
+    bounds = box3f();
+    if (primBounds.empty()) return;
+
+    BinaryBuilder builder(primBounds,primIDs);
+    builder.build(0,(uint32_t)primBounds.size());
+    const std::vector<BinaryNode> &binary = builder.nodes;
+    bounds = binary[0].bounds;
+
+    // collapse: each wide node adopts up to WIDTH binary nodes, by
+    // repeatedly opening the largest inner node among its children
+    nodes.reserve(binary.size()/2+1);
+    struct Job { uint32_t wideID; int binaryID; };
+    std::vector<Job> jobs;
+    nodes.push_back(Node());
+    jobs.push_back({0,0});
+    while (!jobs.empty()) {
+      const Job job = jobs.back();
+      jobs.pop_back();
+
+      int children[WIDTH];
+      int numChildren = 0;
+      if (binary[job.binaryID].isLeaf())
+        children[numChildren++] = job.binaryID;
+      else {
+        children[numChildren++] = binary[job.binaryID].child[0];
+        children[numChildren++] = binary[job.binaryID].child[1];
+      }
+      while (numChildren < WIDTH) {
+        int   best     = -1;
+        float bestArea = -1.f;
+        for (int i=0;i<numChildren;i++) {
+          const BinaryNode &bn = binary[children[i]];
+          if (bn.isLeaf()) continue;
+          const float a = area(bn.bounds);
+          if (a > bestArea) { bestArea = a; best = i; }
+        }
+        if (best < 0) break;
+        const BinaryNode &bn = binary[children[best]];
+        children[best]          = bn.child[0];
+        children[numChildren++] = bn.child[1];
+      }
+
+      Node node = {};
+      setupGrid(node,binary[job.binaryID].bounds);
+      node.numChildren = (uint8_t)numChildren;
+      for (int i=0;i<numChildren;i++) {
+        const BinaryNode &bn = binary[children[i]];
+        quantize(node,i,bn.bounds);
+        if (bn.isLeaf()) {
+          node.child[i]     = bn.begin;
+          node.primCount[i] = (uint8_t)bn.count;
+        } else {
+          node.child[i]     = (uint32_t)nodes.size();
+          node.primCount[i] = 0;
+          nodes.push_back(Node());
+          jobs.push_back({node.child[i],children[i]});
+        }
+      }
+      nodes[job.wideID] = node;
+    }
+  }
+
+} // ::osc
@@ -0,0 +1,182 @@
+// ======================================================================== //
+// Copyright 2018-2024 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "gdt/math/box.h"
+#include <vector>
+#include <cmath>
+
+/*! \namespace osc - Optix Siggraph Course */
+namespace osc {
+  using namespace gdt;
+
+  /*! a simple ray for the CPU traversal code; tmax gets shrunk as
+      closer hits are found */
+  struct Ray {
+    vec3f org;
+    float tmin { 0.f };
+    vec3f dir;
+    float tmax { 1e20f };
+  };
+
+  /*! a 4-wide BVH, built by collapsing a binned-SAH binary BVH. Child
+      bounds are stored as 8-bit offsets relative to the parent box
+      (in power-of-two steps per axis), so that a full node - bounds
+      of all four children plus their references - fits into a
+      single 64-byte cache line.
+
+      The BVH itself only knows about primitive *bounds*; what a
+      primitive actually is (a triangle, an instance, ...) is up to
+      the caller, which gets handed primitive IDs during traversal */
+  struct WideBVH {
+    enum { WIDTH = 4, MAX_LEAF_SIZE = 8 };
+
+    struct alignas(64) Node {
+      /*! lower corner of this node's bounds, and per-axis
+          power-of-two exponent of the quantization step */
+      vec3f    origin;
+      int8_t   exponent[3];
+      uint8_t  numChildren;
+      /*! quantized child bounds, stored per axis so all four
+          children of one slab are next to each other */
+      uint8_t  lower[3][WIDTH];
+      uint8_t  upper[3][WIDTH];
+      /*! index of child node for inner children, or offset into
+          primIDs[] for leaf children */
+      uint32_t child[WIDTH];
+      /*! number of primitives for a leaf child; 0 for inner nodes */
+      uint8_t  primCount[WIDTH];
+    };
+
+    /*! (re-)build over the given primitive bounds; primitive i in
+        traversal refers to primBounds[i] */
+    void build(const std::vector<box3f> &primBounds);
+
+    /*! traverse the BVH with the given ray, and call
+        intersectPrim(primID,ray) for each primitive in each leaf
+        that the ray reaches. intersectPrim returns true if it found
+        a hit, in which case it is expected to have shrunk
+        ray.tmax. If ANY_HIT is set we stop at the first hit (for
+        shadow rays). Returns whether any primitive was hit */
+    template<bool ANY_HIT=false, typename IntersectPrim>
+    bool traverse(Ray &ray, const IntersectPrim &intersectPrim) const;
+
+    bool   empty() const { return nodes.empty(); }
+    /*! bytes used by nodes and primitive references */
+    size_t memoryUsage() const
+    { return nodes.size()*sizeof(Node) + primIDs.size()*sizeof(uint32_t); }
+
+    //! bounds of all primitives in this BVH
+    box3f                 bounds;
+    std::vector<Node>     nodes;
+    std::vector<uint32_t> primIDs;
+  };
+
+  /*! ray-triangle test (Moeller-Trumbore); returns true - and
+      distance and barycentrics - if the hit lies within
+      [ray.tmin,ray.tmax) */
+  inline bool intersectTriangle(const Ray &ray,
+                                const vec3f &A,
+                                const vec3f &B,
+                                const vec3f &C,
+                                float &t, float &u, float &v)
+  {
+    const vec3f e1  = B-A;
+    const vec3f e2  = C-A;
+    const vec3f pv  = cross(ray.dir,e2);
+    const float det = dot(e1,pv);
+    if (fabsf(det) < 1e-12f) return false;
+    const float invDet = 1.f/det;
+    const vec3f tv  = ray.org-A;
+    u = dot(tv,pv)*invDet;
+    if (u < 0.f || u > 1.f) return false;
+    const vec3f qv  = cross(tv,e1);
+    v = dot(ray.dir,qv)*invDet;
+    if (v < 0.f || u+v > 1.f) return false;
+    t = dot(e2,qv)*invDet;
+    return t >= ray.tmin && t < ray.tmax;
+  }
+
+  template<bool ANY_HIT, typename IntersectPrim>
+  inline bool WideBVH::traverse(Ray &ray, const IntersectPrim &intersectPrim) const
+  {
+    if (nodes.empty()) return false;
+
+    const vec3f rcpDir(fabsf(ray.dir.x) > 1e-20f ? 1.f/ray.dir.x : copysignf(1e20f,ray.dir.x),
+                       fabsf(ray.dir.y) > 1e-20f ? 1.f/ray.dir.y : copysignf(1e20f,ray.dir.y),
+                       fabsf(ray.dir.z) > 1e-20f ? 1.f/ray.dir.z : copysignf(1e20f,ray.dir.z));
+    bool foundHit = false;
+
+    uint32_t stack[128];
+    int      stackPtr = 0;
+    stack[stackPtr++] = 0;
+    while (stackPtr > 0) {
+      const Node &node = nodes[stack[--stackPtr]];
+      const vec3f scale(ldexpf(1.f,node.exponent[0]),
+                        ldexpf(1.f,node.exponent[1]),
+                        ldexpf(1.f,node.exponent[2]));
+      // pre-transform the ray into the node's quantized grid, so
+      // the slab test works directly on the 8-bit values
+      const vec3f org = (node.origin-ray.org)*rcpDir;
+      const vec3f rcpQ = scale*rcpDir;
+
+      // test all children, and sort hit ones near to far
+      float    hitDist[WIDTH];
+      uint32_t hitSlot[WIDTH];
+      int      numHit = 0;
+      for (int i=0;i<node.numChildren;i++) {
+        float t0 = ray.tmin, t1 = ray.tmax;
+        for (int d=0;d<3;d++) {
+          float tn = org[d] + node.lower[d][i]*rcpQ[d];
+          float tf = org[d] + node.upper[d][i]*rcpQ[d];
+          if (tn > tf) std::swap(tn,tf);
+          t0 = std::max(t0,tn);
+          t1 = std::min(t1,tf);
+        }
+        if (t0 > t1) continue;
+        int j = numHit++;
+        for (;j>0 && hitDist[j-1] > t0;--j) {
+          hitDist[j] = hitDist[j-1];
+          hitSlot[j] = hitSlot[j-1];
+        }
+        hitDist[j] = t0;
+        hitSlot[j] = i;
+      }
+
+      // leaves get intersected right away, nearest first ...
+      for (int j=0;j<numHit;j++) {
+        const int i = hitSlot[j];
+        if (node.primCount[i] == 0) continue;
+        for (int p=0;p<node.primCount[i];p++) {
+          if (intersectPrim(primIDs[node.child[i]+p],ray)) {
+            foundHit = true;
+            if (ANY_HIT) return true;
+          }
+        }
+      }
+      // ... inner nodes get pushed far to near, so the nearest one
+      // gets popped first
+      for (int j=numHit-1;j>=0;--j) {
+        const int i = hitSlot[j];
+        if (node.primCount[i] == 0)
+          stack[stackPtr++] = node.child[i];
+      }
+    }
+    return foundHit;
+  }
+
+} // ::osc
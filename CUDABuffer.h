@@ -59,6 +59,13 @@ namespace osc {
       alloc(vt.size()*sizeof(T));
       upload((const T*)vt.data(),vt.size());
     }
+
+    template<typename T>
+    void alloc_and_upload(const T *t, size_t count)
+    {
+      alloc(count*sizeof(T));
+      upload(t,count);
+    }
     
     template<typename T>
     void upload(const T *t, size_t count)
@@ -0,0 +1,642 @@
+// ======================================================================== //
+// Copyright 2018-2024 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "ConvexDecomposition.h"
+#include "gdt/math/box.h"
+//std
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_invoke.h>
+#include <queue>
+#include <unordered_map>
+
+/*! \namespace osc - Optix Siggraph Course */
+namespace osc {
+
+  /*! candidate split planes tried per axis */
+  static const int SPLITS_PER_AXIS = 3;
+  /*! vertex budget of the hulls split candidates get rated by */
+  static const int SPLIT_HULL_VERTICES = 32;
+
+  float ConvexHull::volume() const
+  {
+    float sum = 0.f;
+    for (const vec3i &t : index)
+      sum += dot(vertex[t.x],cross(vertex[t.y],vertex[t.z]));
+    return sum / 6.f;
+  }
+
+  /*! incremental quickhull. Every face keeps the points above it (its
+      conflict list); each step adds the point farthest above any
+      face, replacing all faces it sees by a cone from the horizon */
+  class QuickHull {
+  public:
+    QuickHull(const vec3f *points, size_t numPoints)
+      : points(points), numPoints(numPoints)
+    {}
+
+    ConvexHull compute(int maxVertices)
+    {
+      ConvexHull hull;
+      if (!initTetrahedron()) return hull;
+      for (int numVertices=4;numVertices<maxVertices;numVertices++)
+        if (!addFarthestPoint()) break;
+
+      // compact: only the vertices still referenced by faces
+      std::unordered_map<int,int> newID;
+      for (const Face &face : faces) {
+        if (!face.alive) continue;
+        vec3i t;
+        for (int i=0;i<3;i++) {
+          auto it = newID.find(face.v[i]);
+          if (it == newID.end()) {
+            it = newID.insert({face.v[i],int(hull.vertex.size())}).first;
+            hull.vertex.push_back(points[face.v[i]]);
+          }
+          t[i] = it->second;
+        }
+        hull.index.push_back(t);
+      }
+      return hull;
+    }
+
+  private:
+    struct Face {
+      int   v[3];
+      vec3f n;
+      float d;
+      bool  alive { true };
+      /*! the point farthest above, among conflict */
+      int   farthest { -1 };
+      float farthestDist { 0.f };
+      int   visited { -1 };
+      std::vector<int> conflict;
+    };
+
+    static uint64_t edgeKey(int a, int b)
+    { return (uint64_t(uint32_t(a)) << 32) | uint32_t(b); }
+
+    float distance(const Face &face, const vec3f &p) const
+    { return dot(face.n,p) - face.d; }
+
+    int addFace(int a, int b, int c)
+    {
+      Face face;
+      face.v[0] = a; face.v[1] = b; face.v[2] = c;
+      const vec3f n = cross(points[b]-points[a],points[c]-points[a]);
+      const float len = length(n);
+      face.n = len > 0.f ? n * (1.f/len) : vec3f(0.f);
+      face.d = dot(face.n,points[a]);
+      const int faceID = int(faces.size());
+      faces.push_back(std::move(face));
+      edges[edgeKey(a,b)] = faceID;
+      edges[edgeKey(b,c)] = faceID;
+      edges[edgeKey(c,a)] = faceID;
+      return faceID;
+    }
+
+    /*! put the point into the conflict list of the first of the given
+        faces it's above, if any */
+    void assign(int pointID, const std::vector<int> &candidates)
+    {
+      const vec3f &p = points[pointID];
+      for (int faceID : candidates) {
+        Face &face = faces[faceID];
+        const float dist = distance(face,p);
+        if (dist <= eps) continue;
+        face.conflict.push_back(pointID);
+        if (dist > face.farthestDist) {
+          face.farthestDist = dist;
+          face.farthest     = pointID;
+        }
+        return;
+      }
+    }
+
+    /*! faces only get points while they're created, so their
+        farthest point is final by the time they get queued */
+    void enqueue(int faceID)
+    {
+      if (faces[faceID].farthest >= 0)
+        outside.push({faces[faceID].farthestDist,faceID});
+    }
+
+    bool initTetrahedron()
+    {
+      if (numPoints < 4) return false;
+      // the extreme points along the axes, and the farthest pair of them
+      int extreme[6] = { 0,0,0,0,0,0 };
+      vec3f maxAbs(0.f);
+      for (size_t i=0;i<numPoints;i++) {
+        const vec3f &p = points[i];
+        for (int a=0;a<3;a++) {
+          if (p[a] < points[extreme[2*a  ]][a]) extreme[2*a  ] = int(i);
+          if (p[a] > points[extreme[2*a+1]][a]) extreme[2*a+1] = int(i);
+          maxAbs[a] = std::max(maxAbs[a],fabsf(p[a]));
+        }
+      }
+      eps = 3.f * FLT_EPSILON * (maxAbs.x + maxAbs.y + maxAbs.z);
+
+      int a = 0, b = 0;
+      float best = -1.f;
+      for (int i=0;i<6;i++)
+        for (int j=i+1;j<6;j++) {
+          const float d = length(points[extreme[i]]-points[extreme[j]]);
+          if (d > best) { best = d; a = extreme[i]; b = extreme[j]; }
+        }
+      if (best <= eps) return false;
+
+      // the point farthest from line ab, then the one farthest from plane abc
+      const vec3f ab = normalize(points[b]-points[a]);
+      int c = -1;
+      best = eps;
+      for (size_t i=0;i<numPoints;i++) {
+        const float d = length(cross(points[i]-points[a],ab));
+        if (d > best) { best = d; c = int(i); }
+      }
+      if (c < 0) return false;
+      const vec3f n = normalize(cross(points[b]-points[a],points[c]-points[a]));
+      int d = -1;
+      best = eps;
+      for (size_t i=0;i<numPoints;i++) {
+        const float dist = fabsf(dot(points[i]-points[a],n));
+        if (dist > best) { best = dist; d = int(i); }
+      }
+      if (d < 0) return false;
+
+      // four faces, each oriented away from the tetrahedron's centroid
+      const vec3f center
+        = .25f*(points[a]+points[b]+points[c]+points[d]);
+      const int tets[4][3] = { {a,b,c},{a,b,d},{a,c,d},{b,c,d} };
+      std::vector<int> initial;
+      for (auto &t : tets) {
+        const vec3f tn = cross(points[t[1]]-points[t[0]],points[t[2]]-points[t[0]]);
+        if (dot(tn,center-points[t[0]]) > 0.f)
+          initial.push_back(addFace(t[0],t[2],t[1]));
+        else
+          initial.push_back(addFace(t[0],t[1],t[2]));
+      }
+      for (size_t i=0;i<numPoints;i++)
+        if (int(i) != a && int(i) != b && int(i) != c && int(i) != d)
+          assign(int(i),initial);
+      for (int faceID : initial) enqueue(faceID);
+      return true;
+    }
+
+    /*! add the point farthest out to the hull; false if all points
+        are inside already */
+    bool addFarthestPoint()
+    {
+      while (!outside.empty() && !faces[outside.top().second].alive)
+        outside.pop();
+      if (outside.empty()) return false;
+      const int start = outside.top().second;
+      outside.pop();
+      const int   eyeID = faces[start].farthest;
+      const vec3f eye   = points[eyeID];
+      const int   tag   = ++iteration;
+
+      // all faces the eye sees, which are connected; their edges whose
+      // neighbor isn't one of them form the horizon
+      std::vector<int> visible = { start }, stack = { start };
+      std::vector<std::pair<int,int>> horizon;
+      faces[start].visited = tag;
+      while (!stack.empty()) {
+        const int faceID = stack.back();
+        stack.pop_back();
+        for (int e=0;e<3;e++) {
+          const int v0 = faces[faceID].v[e], v1 = faces[faceID].v[(e+1)%3];
+          const auto twin = edges.find(edgeKey(v1,v0));
+          if (twin == edges.end()) continue;
+          Face &neighbor = faces[twin->second];
+          if (neighbor.visited == tag) continue;
+          if (distance(neighbor,eye) > 0.f) {
+            neighbor.visited = tag;
+            visible.push_back(twin->second);
+            stack.push_back(twin->second);
+          }
+        }
+      }
+      for (int faceID : visible)
+        for (int e=0;e<3;e++) {
+          const int v0 = faces[faceID].v[e], v1 = faces[faceID].v[(e+1)%3];
+          const auto twin = edges.find(edgeKey(v1,v0));
+          if (twin == edges.end() || faces[twin->second].visited != tag)
+            horizon.push_back({v0,v1});
+        }
+
+      std::vector<int> orphans;
+      for (int faceID : visible) {
+        Face &face = faces[faceID];
+        face.alive = false;
+        for (int e=0;e<3;e++)
+          edges.erase(edgeKey(face.v[e],face.v[(e+1)%3]));
+        orphans.insert(orphans.end(),face.conflict.begin(),face.conflict.end());
+        std::vector<int>().swap(face.conflict);
+      }
+      std::vector<int> cone;
+      for (auto &edge : horizon)
+        cone.push_back(addFace(edge.first,edge.second,eyeID));
+      for (int pointID : orphans)
+        if (pointID != eyeID)
+          assign(pointID,cone);
+      for (int faceID : cone) enqueue(faceID);
+      return true;
+    }
+
+    const vec3f *points;
+    size_t       numPoints;
+    float        eps { 0.f };
+    int          iteration { 0 };
+    std::vector<Face> faces;
+    /*! faces with points above them, farthest first; may contain
+        faces that died since */
+    std::priority_queue<std::pair<float,int>> outside;
+    /*! directed edge -> the face it belongs to */
+    std::unordered_map<uint64_t,int> edges;
+  };
+
+  ConvexHull computeConvexHull(const vec3f *points, size_t numPoints,
+                               int maxVertices)
+  {
+    return QuickHull(points,numPoints).compute(std::max(maxVertices,4));
+  }
+
+  /*! the mesh's solid, as a voxel grid: voxels the surface passes
+      through, and those it encloses. Meshes that aren't closed have
+      no inside, and are just their surface voxels. Stores twice the
+      fraction of each voxel that's solid */
+  struct SolidVoxels {
+    vec3f lower;
+    float voxelSize;
+    vec3i dims;
+    std::vector<uint8_t> solid;
+
+    size_t cellID(int x, int y, int z) const
+    { return (size_t(z)*dims.y + y)*dims.x + x; }
+
+    vec3i cellOf(const vec3f &p) const
+    {
+      const vec3f f = (p - lower) * (1.f/voxelSize);
+      return vec3i(std::min(std::max(int(f.x),0),dims.x-1),
+                    std::min(std::max(int(f.y),0),dims.y-1),
+                    std::min(std::max(int(f.z),0),dims.z-1));
+    }
+
+    void build(const vec3f *vertex, const vec3i *index,
+               const std::vector<int> &triangles,
+               const box3f &bounds, int resolution)
+    {
+      // one voxel of padding all around, so the outside is connected
+      voxelSize = std::max(reduce_max(bounds.span()),1e-20f) / float(resolution);
+      lower     = bounds.lower - vec3f(voxelSize);
+      dims      = vec3i(int(bounds.span().x/voxelSize) + 3,
+                        int(bounds.span().y/voxelSize) + 3,
+                        int(bounds.span().z/voxelSize) + 3);
+      enum { OUTSIDE = 0, SURFACE = 1, UNKNOWN = 2 };
+      solid.assign(size_t(dims.x)*dims.y*dims.z,UNKNOWN);
+
+      // surface: sample each triangle at half the voxel size
+      for (int t : triangles) {
+        const vec3f a = vertex[index[t].x];
+        const vec3f b = vertex[index[t].y];
+        const vec3f c = vertex[index[t].z];
+        const float longest = std::max(std::max(length(b-a),length(c-b)),length(a-c));
+        const int   n = std::min(int(2.f*longest/voxelSize) + 1,1<<12);
+        for (int i=0;i<=n;i++)
+          for (int j=0;i+j<=n;j++) {
+            const vec3f p = a + (b-a)*(float(i)/n) + (c-a)*(float(j)/n);
+            const vec3i cell = cellOf(p);
+            solid[cellID(cell.x,cell.y,cell.z)] = SURFACE;
+          }
+      }
+
+      // outside: whatever the padding reaches without crossing the surface
+      std::vector<vec3i> stack = { vec3i(0) };
+      solid[0] = OUTSIDE;
+      while (!stack.empty()) {
+        const vec3i cell = stack.back();
+        stack.pop_back();
+        static const int step[6][3]
+          = { {-1,0,0},{1,0,0},{0,-1,0},{0,1,0},{0,0,-1},{0,0,1} };
+        for (auto &d : step) {
+          const vec3i n(cell.x+d[0],cell.y+d[1],cell.z+d[2]);
+          if (n.x < 0 || n.y < 0 || n.z < 0
+              || n.x >= dims.x || n.y >= dims.y || n.z >= dims.z)
+            continue;
+          uint8_t &state = solid[cellID(n.x,n.y,n.z)];
+          if (state != UNKNOWN) continue;
+          state = OUTSIDE;
+          stack.push_back(n);
+        }
+      }
+      // the surface cuts through its voxels, so count those as half
+      for (uint8_t &state : solid)
+        state = (state == OUTSIDE) ? 0 : (state == SURFACE) ? 1 : 2;
+    }
+
+    /*! volume of the solid voxels whose centers lie within region */
+    float volume(const box3f &region) const
+    {
+      // voxel x's center is at lower + (x+.5)*voxelSize
+      vec3i lo, hi;
+      for (int a=0;a<3;a++) {
+        const float l = (region.lower[a]-lower[a])/voxelSize - .5f;
+        const float h = (region.upper[a]-lower[a])/voxelSize - .5f;
+        lo[a] = int(ceilf(std::min(std::max(l,0.f),float(dims[a]))));
+        hi[a] = int(ceilf(std::min(std::max(h,0.f),float(dims[a]))));
+      }
+      size_t count = 0;
+      for (int z=lo.z;z<hi.z;z++)
+        for (int y=lo.y;y<hi.y;y++)
+          for (int x=lo.x;x<hi.x;x++)
+            count += solid[cellID(x,y,z)];
+      return .5f * float(count) * voxelSize*voxelSize*voxelSize;
+    }
+  };
+
+  /*! recursive splitting of a mesh's triangles into convex parts */
+  struct Decomposer {
+    const vec3f        *vertex;
+    const vec3i        *index;
+    std::vector<vec3f>  centroid;
+    SolidVoxels         voxels;
+    DecompositionParams params;
+    /*! maxConcavity, as a volume */
+    float               volumeLimit;
+
+    /*! the (unique) vertices of the given triangles */
+    std::vector<vec3f> partPoints(const std::vector<int> &triangles) const
+    {
+      std::vector<int> ids;
+      ids.reserve(3*triangles.size());
+      for (int t : triangles) {
+        ids.push_back(index[t].x);
+        ids.push_back(index[t].y);
+        ids.push_back(index[t].z);
+      }
+      std::sort(ids.begin(),ids.end());
+      ids.erase(std::unique(ids.begin(),ids.end()),ids.end());
+      std::vector<vec3f> points(ids.size());
+      for (size_t i=0;i<ids.size();i++) points[i] = vertex[ids[i]];
+      return points;
+    }
+
+    void split(const std::vector<int> &triangles, int axis, float pos,
+               std::vector<int> &below, std::vector<int> &above) const
+    {
+      for (int t : triangles)
+        (centroid[t][axis] < pos ? below : above).push_back(t);
+    }
+
+    /*! hull volume of the triangles' hull at the candidates' vertex
+        budget; with lookahead, the smaller of that and the volume of
+        the triangles' best split. Looking one split ahead is what
+        gets rings split: cutting a ring once doesn't shrink its
+        hull, only cutting it twice does */
+    float splitHullVolume(const std::vector<int> &triangles, bool lookahead) const
+    {
+      const std::vector<vec3f> points = partPoints(triangles);
+      float volume
+        = computeConvexHull(points.data(),points.size(),SPLIT_HULL_VERTICES).volume();
+      int   axis;
+      float pos, splitVolume;
+      if (lookahead && triangles.size() >= 2
+          && bestSplit(triangles,axis,pos,splitVolume,false))
+        volume = std::min(volume,splitVolume);
+      return volume;
+    }
+
+    /*! the axis-aligned plane through the part's centroids whose halves
+        have the smallest summed hull volume, and that volume; false if
+        there's no plane that separates anything. Candidates get rated
+        in parallel */
+    bool bestSplit(const std::vector<int> &triangles,
+                   int &bestAxis, float &bestPos, float &bestCost,
+                   bool lookahead = true) const
+    {
+      box3f bounds;
+      for (int t : triangles) bounds.extend(centroid[t]);
+      auto position = [&](int c) {
+        const int axis = c / SPLITS_PER_AXIS;
+        return bounds.lower[axis]
+          + (bounds.upper[axis]-bounds.lower[axis])
+          * float(c % SPLITS_PER_AXIS + 1) / float(SPLITS_PER_AXIS + 1);
+      };
+
+      const int numCandidates = 3*SPLITS_PER_AXIS;
+      std::vector<float> cost(numCandidates,FLT_MAX);
+      tbb::parallel_for(0,numCandidates,[&](int c) {
+          std::vector<int> below, above;
+          split(triangles,c / SPLITS_PER_AXIS,position(c),below,above);
+          if (below.empty() || above.empty()) return;
+          cost[c] = splitHullVolume(below,lookahead)
+            + splitHullVolume(above,lookahead);
+        });
+
+      const int best = int(std::min_element(cost.begin(),cost.end()) - cost.begin());
+      if (cost[best] == FLT_MAX) return false;
+      bestAxis = best / SPLITS_PER_AXIS;
+      bestPos  = position(best);
+      bestCost = cost[best];
+      return true;
+    }
+
+    /*! a set of triangles, the region of space they (and the solid
+        they bound) were split into, and their hull */
+    struct Part {
+      std::vector<int> triangles;
+      box3f            region;
+      ConvexHull       hull;
+      /*! how much more the hull encloses than the solid does; -1
+          once the part can't be split any further */
+      float            concavity;
+    };
+
+    Part makePart(std::vector<int> &&triangles, const box3f &region) const
+    {
+      Part part;
+      part.triangles = std::move(triangles);
+      part.region    = region;
+      const std::vector<vec3f> points = partPoints(part.triangles);
+      part.hull = computeConvexHull(points.data(),points.size(),
+                                    params.maxHullVertices);
+      part.concavity = part.hull.volume() - voxels.volume(region);
+      return part;
+    }
+
+    /*! split the most concave part in two until all are convex
+        enough, or there are maxHulls of them */
+    std::vector<ConvexHull> decompose(Part &&whole) const
+    {
+      std::vector<Part> parts;
+      // flat parts have no volume to collide with
+      if (!whole.hull.empty()) parts.push_back(std::move(whole));
+      while (!parts.empty() && int(parts.size()) < params.maxHulls) {
+        auto worst = std::max_element(parts.begin(),parts.end(),
+                                      [](const Part &a, const Part &b) {
+                                        return a.concavity < b.concavity;
+                                      });
+        if (worst->concavity <= volumeLimit) break;
+
+        int   axis;
+        float pos, cost;
+        if (worst->triangles.size() < 2
+            || !bestSplit(worst->triangles,axis,pos,cost)) {
+          worst->concavity = -1.f;
+          continue;
+        }
+        std::vector<int> below, above;
+        split(worst->triangles,axis,pos,below,above);
+        box3f regionBelow = worst->region, regionAbove = worst->region;
+        regionBelow.upper[axis] = pos;
+        regionAbove.lower[axis] = pos;
+        Part partBelow, partAbove;
+        tbb::parallel_invoke(
+          [&]{ partBelow = makePart(std::move(below),regionBelow); },
+          [&]{ partAbove = makePart(std::move(above),regionAbove); });
+
+        parts.erase(worst);
+        for (Part *part : { &partBelow, &partAbove })
+          if (!part->hull.empty()) parts.push_back(std::move(*part));
+      }
+
+      std::vector<ConvexHull> hulls;
+      for (Part &part : parts) hulls.push_back(std::move(part.hull));
+      return hulls;
+    }
+  };
+
+  std::vector<ConvexHull> decomposeConvex(const vec3f *vertex, size_t numVertices,
+                                          const vec3i *index, size_t numTriangles,
+                                          const DecompositionParams &params)
+  {
+    // drop triangles with out-of-range vertices up front
+    std::vector<int> triangles;
+    triangles.reserve(numTriangles);
+    for (size_t i=0;i<numTriangles;i++) {
+      const vec3i t = index[i];
+      if (t.x >= 0 && t.y >= 0 && t.z >= 0
+          && size_t(t.x) < numVertices && size_t(t.y) < numVertices
+          && size_t(t.z) < numVertices)
+        triangles.push_back(int(i));
+    }
+    if (triangles.empty()) return {};
+
+    Decomposer decomposer;
+    decomposer.vertex = vertex;
+    decomposer.index  = index;
+    decomposer.params = params;
+    decomposer.centroid.resize(numTriangles);
+    box3f bounds;
+    for (int t : triangles) {
+      const vec3f a = vertex[index[t].x], b = vertex[index[t].y], c = vertex[index[t].z];
+      decomposer.centroid[t] = (a+b+c) * (1.f/3.f);
+      bounds.extend(a);
+      bounds.extend(b);
+      bounds.extend(c);
+    }
+    decomposer.voxels.build(vertex,index,triangles,bounds,
+                            std::max(params.voxelResolution,8));
+
+    box3f everywhere;
+    everywhere.lower = vec3f(-FLT_MAX);
+    everywhere.upper = vec3f(+FLT_MAX);
+    Decomposer::Part whole = decomposer.makePart(std::move(triangles),everywhere);
+    decomposer.volumeLimit = params.maxConcavity * whole.hull.volume();
+    return decomposer.decompose(std::move(whole));
+  }
+
+  /* hull cache file layout: HullCacheHeader, then per hull its
+     numVertices and numTriangles (uint32 each), vertices, triangles */
+  static const char     HULL_MAGIC[8]  = { 'O','S','C','H','U','L','L','S' };
+  static const uint32_t HULL_VERSION   = 1;
+
+  struct HullCacheHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t numHulls;
+    uint64_t key;
+  };
+
+  bool saveHullCache(const std::string &fileName, uint64_t key,
+                     const std::vector<ConvexHull> &hulls)
+  {
+    HullCacheHeader header = {};
+    memcpy(header.magic,HULL_MAGIC,sizeof(HULL_MAGIC));
+    header.version  = HULL_VERSION;
+    header.numHulls = uint32_t(hulls.size());
+    header.key      = key;
+
+    const std::string tmpFile = fileName + ".tmp";
+    FILE *file = fopen(tmpFile.c_str(),"wb");
+    if (!file) return false;
+    bool ok = fwrite(&header,sizeof(header),1,file) == 1;
+    for (const ConvexHull &hull : hulls) {
+      const uint32_t sizes[2] = { uint32_t(hull.vertex.size()),
+                                  uint32_t(hull.index.size()) };
+      ok = ok
+        && fwrite(sizes,sizeof(sizes),1,file) == 1
+        && fwrite(hull.vertex.data(),sizeof(vec3f),sizes[0],file) == sizes[0]
+        && fwrite(hull.index.data(), sizeof(vec3i),sizes[1],file) == sizes[1];
+    }
+    ok = (fclose(file) == 0) && ok;
+
+    std::error_code ec;
+    if (ok) std::filesystem::rename(tmpFile,fileName,ec);
+    if (!ok || ec) {
+      std::filesystem::remove(tmpFile,ec);
+      return false;
+    }
+    return true;
+  }
+
+  bool loadHullCache(const std::string &fileName, uint64_t key,
+                     std::vector<ConvexHull> &hulls)
+  {
+    FILE *file = fopen(fileName.c_str(),"rb");
+    if (!file) return false;
+
+    HullCacheHeader header;
+    bool ok = fread(&header,sizeof(header),1,file) == 1
+      && memcmp(header.magic,HULL_MAGIC,sizeof(HULL_MAGIC)) == 0
+      && header.version == HULL_VERSION
+      && header.key     == key;
+    std::vector<ConvexHull> loaded(ok ? header.numHulls : 0);
+    for (ConvexHull &hull : loaded) {
+      uint32_t sizes[2];
+      ok = ok && fread(sizes,sizeof(sizes),1,file) == 1;
+      if (!ok) break;
+      hull.vertex.resize(sizes[0]);
+      hull.index.resize(sizes[1]);
+      ok = fread(hull.vertex.data(),sizeof(vec3f),sizes[0],file) == sizes[0]
+        && fread(hull.index.data(), sizeof(vec3i),sizes[1],file) == sizes[1];
+      for (const vec3i &t : hull.index)
+        ok = ok && t.x >= 0 && t.y >= 0 && t.z >= 0
+          && uint32_t(t.x) < sizes[0] && uint32_t(t.y) < sizes[0]
+          && uint32_t(t.z) < sizes[0];
+    }
+    fclose(file);
+    if (ok) hulls = std::move(loaded);
+    return ok;
+  }
+
+} // ::osc
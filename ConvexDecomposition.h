@@ -0,0 +1,87 @@
+// ======================================================================== //
+// Copyright 2018-2024 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "gdt/math/vec.h"
+//std
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*! \namespace osc - Optix Siggraph Course */
+namespace osc {
+  using namespace gdt;
+
+  /*! a closed convex polytope, with outward-facing triangles */
+  struct ConvexHull {
+    std::vector<vec3f> vertex;
+    std::vector<vec3i> index;
+
+    bool empty() const { return index.empty(); }
+    float volume() const;
+  };
+
+  /*! convex hull of the given points (quickhull). If the points have
+      more than maxVertices hull vertices, the hull gets simplified by
+      stopping once it has maxVertices of them - as those are always
+      the ones farthest out, the result is the best hull of that many
+      the greedy choice finds, and lies within the exact one.
+
+      Empty if the points are all (nearly) coplanar. */
+  ConvexHull computeConvexHull(const vec3f *points, size_t numPoints,
+                               int maxVertices = 1<<30);
+
+  struct DecompositionParams {
+    /*! parts whose hull exceeds their solid volume by more than this
+        (as a fraction of the whole mesh's hull volume) get split */
+    float maxConcavity    { .02f };
+    /*! most hulls to decompose a mesh into */
+    int   maxHulls        { 16 };
+    /*! vertex budget each hull gets simplified to */
+    int   maxHullVertices { 64 };
+    /*! voxels along the mesh's longest axis, for measuring volumes */
+    int   voxelResolution { 64 };
+  };
+
+  /*! approximate convex decomposition of a triangle mesh, in the
+      spirit of V-HACD: the mesh's solid gets voxelized, and the part
+      whose hull encloses the most empty space gets split in two by
+      the axis-aligned plane that minimizes the summed volume of the
+      halves' hulls - until each part's hull is within maxConcavity
+      of the solid it covers, or the hull budget is used up. A convex
+      mesh stays a single hull; a mesh that isn't closed has no
+      volume, and so gets split up to the budget.
+
+      Triangles go to the side of the plane their centroid is on, so
+      neighboring hulls can overlap slightly; that's fine for
+      collision geometry, which is what this is for. */
+  std::vector<ConvexHull> decomposeConvex(const vec3f *vertex, size_t numVertices,
+                                          const vec3i *index, size_t numTriangles,
+                                          const DecompositionParams &params
+                                          = DecompositionParams());
+
+  /*! write the hulls to a cache file, tagged with the given key (eg,
+      a hash of the mesh and params they were computed from) */
+  bool saveHullCache(const std::string &fileName, uint64_t key,
+                     const std::vector<ConvexHull> &hulls);
+
+  /*! read hulls written by saveHullCache; false if the file doesn't
+      exist, is broken, or has a different key */
+  bool loadHullCache(const std::string &fileName, uint64_t key,
+                     std::vector<ConvexHull> &hulls);
+
+} // ::osc
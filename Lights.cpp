@@ -0,0 +1,194 @@
+// ======================================================================== //
+// Copyright 2018-2024 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "Lights.h"
+
+/*! \namespace osc - Optix Siggraph Course */
+namespace osc {
+
+  static_assert(sizeof(LightSampler::Entry) == 16,
+                "alias table entries should stay at 16 bytes each");
+
+  /*! two unit vectors perpendicular to n (and each other) */
+  inline void makeFrame(const vec3f &n, vec3f &t, vec3f &b)
+  {
+    t = fabsf(n.x) > .9f
+      ? normalize(cross(n,vec3f(0.f,1.f,0.f)))
+      : normalize(cross(n,vec3f(1.f,0.f,0.f)));
+    b = cross(n,t);
+  }
+
+  inline float average(const vec3f &v)
+  {
+    return (v.x+v.y+v.z)*(1.f/3.f);
+  }
+
+  /*! total emitted power of a light, up to a common constant. Only
+      used to decide how often to pick which light, so it doesn't
+      need to be exact - it just needs to be non-zero for every light
+      that emits anything */
+  static float estimatePower(const Light &light, float sceneRadius)
+  {
+    const float L = average(light.radiance);
+    switch (light.type) {
+    case Light::DISTANT:
+      return L * float(M_PI) * sceneRadius * sceneRadius;
+    case Light::SPHERE:
+      return light.radius > 0.f
+        ? L * 4.f*float(M_PI)*light.radius*light.radius * float(M_PI)
+        : L * 4.f*float(M_PI);
+    case Light::RECT:
+      return L * 4.f*length(cross(light.edgeU,light.edgeV)) * float(M_PI);
+    case Light::DOME:
+      return L * 4.f*float(M_PI)*float(M_PI) * sceneRadius * sceneRadius;
+    }
+    return 0.f;
+  }
+
+  void LightSampler::build(const std::vector<Light> &lights,
+                           const box3f &sceneBounds)
+  {
+    table.clear();
+    sceneDiameter = sceneBounds.empty()
+      ? 1.f
+      : 2.f*length(sceneBounds.span());
+
+    const size_t numLights = lights.size();
+    std::vector<float> power(numLights);
+    double sum = 0.;
+    for (size_t i=0;i<numLights;i++) {
+      power[i] = std::max(0.f,estimatePower(lights[i],.5f*sceneDiameter));
+      sum += power[i];
+    }
+    if (sum <= 0.) return;
+
+    // Vose's alias method: scale to an average of 1, then repeatedly
+    // fill up one under-full bin with the excess of an over-full one
+    table.resize(numLights);
+    std::vector<float>    scaled(numLights);
+    std::vector<uint32_t> small, large;
+    for (size_t i=0;i<numLights;i++) {
+      table[i].pdf   = float(power[i] / sum);
+      table[i].alias = uint32_t(i);
+      table[i].pad   = 0;
+      scaled[i]      = float(power[i] * numLights / sum);
+      (scaled[i] < 1.f ? small : large).push_back(uint32_t(i));
+    }
+    while (!small.empty() && !large.empty()) {
+      const uint32_t s = small.back(); small.pop_back();
+      const uint32_t l = large.back(); large.pop_back();
+      table[s].threshold = scaled[s];
+      table[s].alias     = l;
+      scaled[l] = (scaled[l] + scaled[s]) - 1.f;
+      (scaled[l] < 1.f ? small : large).push_back(l);
+    }
+    // whatever is left is (up to round-off) exactly full
+    for (uint32_t i : small) table[i].threshold = 1.f;
+    for (uint32_t i : large) table[i].threshold = 1.f;
+  }
+
+  bool LightSampler::sample(const std::vector<Light> &lights,
+                            const vec3f &P, const vec3f &N,
+                            float u0, float u1, float u2,
+                            LightSample &ls) const
+  {
+    if (table.empty()) return false;
+
+    // pick a bin uniformly, then either its own light or its alias;
+    // the remainder of u0 decides which
+    const size_t numBins = table.size();
+    const float  scaled  = u0 * numBins;
+    const size_t bin     = std::min(size_t(scaled),numBins-1);
+    const uint32_t lightID
+      = (scaled - bin) < table[bin].threshold ? uint32_t(bin) : table[bin].alias;
+    const float pickPdf  = table[lightID].pdf;
+    if (pickPdf <= 0.f) return false;
+
+    const Light &light = lights[lightID];
+    switch (light.type) {
+    case Light::DISTANT: {
+      // uniformly within the cone the light subtends
+      const vec3f w = -normalize(light.direction);
+      vec3f t, b;
+      makeFrame(w,t,b);
+      const float cosMax   = cosf(light.angle);
+      const float cosTheta = 1.f - u1*(1.f-cosMax);
+      const float sinTheta = sqrtf(std::max(0.f,1.f-cosTheta*cosTheta));
+      const float phi      = 2.f*float(M_PI)*u2;
+      ls.dir = sceneDiameter
+        * (cosTheta*w + sinTheta*(cosf(phi)*t + sinf(phi)*b));
+      ls.contribution = light.radiance * (1.f/pickPdf);
+      return true;
+    }
+    case Light::SPHERE: {
+      if (light.radius <= 0.f) {
+        ls.dir = light.position - P;
+        const float dist2 = dot(ls.dir,ls.dir);
+        if (dist2 <= 0.f) return false;
+        ls.contribution = light.radiance * (1.f/(dist2*pickPdf));
+        return true;
+      }
+      // uniformly on the whole sphere; points on the far side fail
+      // the cosine test below
+      const float z   = 1.f - 2.f*u1;
+      const float r   = sqrtf(std::max(0.f,1.f-z*z));
+      const float phi = 2.f*float(M_PI)*u2;
+      const vec3f n(r*cosf(phi),r*sinf(phi),z);
+      ls.dir = light.position + light.radius*n - P;
+      const float dist2    = dot(ls.dir,ls.dir);
+      const float cosLight = -dot(n,ls.dir);
+      if (dist2 <= 0.f || cosLight <= 0.f) return false;
+      const float area = 4.f*float(M_PI)*light.radius*light.radius;
+      ls.contribution = light.radiance
+        * (cosLight/sqrtf(dist2) * area / (dist2*pickPdf));
+      return true;
+    }
+    case Light::RECT: {
+      const vec3f normal = cross(light.edgeU,light.edgeV);
+      const float area   = 4.f*length(normal);
+      if (area <= 0.f) return false;
+      ls.dir = light.position
+        + (2.f*u1-1.f)*light.edgeU
+        + (2.f*u2-1.f)*light.edgeV
+        - P;
+      const float dist2    = dot(ls.dir,ls.dir);
+      // one-sided, emitting towards -normal
+      const float cosLight = dot(normalize(normal),ls.dir);
+      if (dist2 <= 0.f || cosLight <= 0.f) return false;
+      ls.contribution = light.radiance
+        * (cosLight/sqrtf(dist2) * area / (dist2*pickPdf));
+      return true;
+    }
+    case Light::DOME: {
+      // cosine-weighted around N; the receiver's cosine is applied by
+      // the caller, so divide it back out here
+      vec3f t, b;
+      makeFrame(N,t,b);
+      const float r        = sqrtf(u1);
+      const float phi      = 2.f*float(M_PI)*u2;
+      const float cosTheta = sqrtf(std::max(0.f,1.f-u1));
+      if (cosTheta <= 1e-4f) return false;
+      ls.dir = sceneDiameter
+        * (r*cosf(phi)*t + r*sinf(phi)*b + cosTheta*N);
+      ls.contribution = light.radiance
+        * (float(M_PI)/(cosTheta*pickPdf));
+      return true;
+    }
+    }
+    return false;
+  }
+
+} // ::osc
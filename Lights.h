@@ -0,0 +1,96 @@
+// ======================================================================== //
+// Copyright 2018-2024 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "gdt/math/AffineSpace.h"
+//std
+#include <vector>
+
+/*! \namespace osc - Optix Siggraph Course */
+namespace osc {
+  using namespace gdt;
+
+  /*! a light source, in world space. Which of the fields are used
+      depends on the type:
+      - DISTANT: direction (towards which light travels), angle
+      - SPHERE : position, radius (0 for a point light)
+      - RECT   : position (center), the two half-extent vectors edgeU
+                 and edgeV; emits towards -cross(edgeU,edgeV)
+      - DOME   : nothing but the radiance
+  */
+  struct Light {
+    typedef enum { DISTANT, SPHERE, RECT, DOME } Type;
+
+    Type  type      { SPHERE };
+    /*! emitted radiance (or, for distant lights, irradiance) */
+    vec3f radiance  { 1.f };
+    vec3f position  { 0.f };
+    vec3f direction { 0.f, 0.f, -1.f };
+    vec3f edgeU     { .5f, 0.f, 0.f };
+    vec3f edgeV     { 0.f, .5f, 0.f };
+    float radius    { 0.f };
+    /*! half of the angle subtended by a distant light, in radians */
+    float angle     { 0.f };
+  };
+
+  /*! one sample towards a light, as seen from some surface point */
+  struct LightSample {
+    /*! un-normalized direction from the surface point to the sampled
+        point on the light; for distant and dome lights a direction
+        scaled to reach past the scene */
+    vec3f dir;
+    /*! radiance arriving along dir, already divided by the pdf of
+        both picking this light and this point on it; the cosine at
+        the surface point is left to the caller */
+    vec3f contribution;
+  };
+
+  /*! picks lights proportional to their (estimated) power, in O(1)
+      regardless of how many lights there are, using Vose's alias
+      method. Each surface point thus traces a constant number of
+      shadow rays no matter how many lights the scene has */
+  struct LightSampler {
+    /*! (re-)build the alias table over the given lights; sceneBounds
+        is used to estimate the power of distant and dome lights */
+    void build(const std::vector<Light> &lights, const box3f &sceneBounds);
+
+    bool empty() const { return table.empty(); }
+
+    /*! sample a light (with u0) and a point on it (with u1,u2), as
+        seen from surface point P with (shading) normal N. Returns
+        false if the sampled point can't illuminate P */
+    bool sample(const std::vector<Light> &lights,
+                const vec3f &P, const vec3f &N,
+                float u0, float u1, float u2,
+                LightSample &ls) const;
+
+    struct Entry {
+      /*! probability of keeping this bin's own light, rather than
+          taking the alias */
+      float    threshold;
+      uint32_t alias;
+      /*! probability of picking the light of this index overall */
+      float    pdf;
+      uint32_t pad;
+    };
+    std::vector<Entry> table;
+    /*! distance that is guaranteed to reach past the scene, for
+        shadow rays towards distant and dome lights */
+    float sceneDiameter { 0.f };
+  };
+
+} // ::osc
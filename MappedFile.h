@@ -0,0 +1,86 @@
+// ======================================================================== //
+// Copyright 2018-2024 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+//std
+#include <string>
+#include <vector>
+#ifdef _WIN32
+# include <fstream>
+#else
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+/*! \namespace osc - Optix Siggraph Course */
+namespace osc {
+
+  /*! a read-only file, mapped copy-on-write so that mesh arrays that
+      view into it may still get modified in place. An empty file opens
+      fine, with a null data pointer */
+  struct MappedFile {
+    ~MappedFile()
+    {
+#ifndef _WIN32
+      if (data) munmap(data,size);
+#endif
+    }
+
+    bool open(const std::string &fileName)
+    {
+#ifdef _WIN32
+      std::ifstream in(fileName,std::ios::binary|std::ios::ate);
+      if (!in) return false;
+      size = (size_t)in.tellg();
+      buffer.resize(size);
+      in.seekg(0);
+      if (!in.read(buffer.data(),size)) return false;
+      data = buffer.data();
+      return true;
+#else
+      const int fd = ::open(fileName.c_str(),O_RDONLY);
+      if (fd < 0) return false;
+      struct stat st;
+      if (fstat(fd,&st) != 0 || st.st_size < 0) {
+        close(fd);
+        return false;
+      }
+      size = (size_t)st.st_size;
+      // empty files can't be mapped, but there's nothing to map, either
+      if (size == 0) {
+        close(fd);
+        return true;
+      }
+      void *mapped = mmap(nullptr,size,PROT_READ|PROT_WRITE,MAP_PRIVATE,fd,0);
+      // the mapping stays valid after closing the descriptor
+      close(fd);
+      if (mapped == MAP_FAILED) return false;
+      data = (char *)mapped;
+      return true;
+#endif
+    }
+
+    char  *data { nullptr };
+    size_t size { 0 };
+#ifdef _WIN32
+    std::vector<char> buffer;
+#endif
+  };
+
+} // ::osc
@@ -0,0 +1,104 @@
+// ======================================================================== //
+// Copyright 2018-2024 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "MeshArena.h"
+//std
+#include <cstdlib>
+#include <new>
+
+/*! \namespace osc - Optix Siggraph Course */
+namespace osc {
+
+  MeshArena::MeshArena(size_t blockSize)
+    : blockSize(blockSize)
+  {}
+
+  MeshArena::~MeshArena()
+  {
+    for (auto mesh : meshes)
+      mesh->~TriangleMesh();
+    for (auto &block : blocks)
+      free(block.data);
+  }
+
+  void *MeshArena::allocate(size_t bytes, size_t alignment)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!blocks.empty()) {
+      Block &block = blocks.back();
+      const size_t begin = (block.used + alignment-1) / alignment * alignment;
+      if (begin + bytes <= block.size) {
+        block.used = begin + bytes;
+        allocatedBytes += bytes;
+        return block.data + begin;
+      }
+    }
+    // doesn't fit the current block: start a new one, big enough for
+    // this allocation if it's larger than the regular block size.
+    // malloc returns memory aligned for any fundamental type, which
+    // covers ARRAY_ALIGNMENT on all platforms we care about
+    const size_t size = std::max(blockSize,bytes);
+    char *data = (char *)malloc(size);
+    if (!data) throw std::bad_alloc();
+    blocks.push_back({data,size,bytes});
+    allocatedBytes += bytes;
+    return data;
+  }
+
+  TriangleMesh *MeshArena::newMesh()
+  {
+    TriangleMesh *mesh
+      = new(allocate(sizeof(TriangleMesh),alignof(TriangleMesh))) TriangleMesh;
+    std::lock_guard<std::mutex> lock(mutex);
+    meshes.push_back(mesh);
+    return mesh;
+  }
+
+  TriangleMesh *MeshArena::packMesh(const TriangleMesh &source)
+  {
+    TriangleMesh *mesh = newMesh();
+    mesh->vertex   = copyArray(source.vertex.data(),  source.vertex.size());
+    mesh->normal   = copyArray(source.normal.data(),  source.normal.size());
+    mesh->texcoord = copyArray(source.texcoord.data(),source.texcoord.size());
+    mesh->index    = copyArray(source.index.data(),   source.index.size());
+    mesh->bounds           = source.bounds;
+    mesh->diffuse          = source.diffuse;
+    mesh->diffuseTextureID = source.diffuseTextureID;
+    return mesh;
+  }
+
+  bool MeshArena::contains(const void *ptr) const
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &block : blocks)
+      if (ptr >= block.data && ptr < block.data + block.size)
+        return true;
+    return false;
+  }
+
+  size_t MeshArena::numBlocks() const
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return blocks.size();
+  }
+
+  size_t MeshArena::memoryUsage() const
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return allocatedBytes;
+  }
+
+} // ::osc
@@ -0,0 +1,93 @@
+// ======================================================================== //
+// Copyright 2018-2024 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "Model.h"
+//std
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+/*! \namespace osc - Optix Siggraph Course */
+namespace osc {
+
+  /*! a bump allocator for the meshes of a model, and all their arrays.
+
+      Memory comes from a few large blocks; packing a mesh copies its
+      arrays into those blocks and gives back a mesh whose arrays are
+      views into them (see MeshArray), so loading many small meshes
+      doesn't mean many small allocations, their data ends up densely
+      packed, and tearing the model down is a handful of frees.
+      Allocation is thread-safe. */
+  class MeshArena {
+  public:
+    enum { ARRAY_ALIGNMENT = 16 };
+
+    /*! blocks are (at least) blockSize bytes each */
+    MeshArena(size_t blockSize = size_t(64) << 20);
+    /*! destroys all meshes created by newMesh / packMesh */
+    ~MeshArena();
+
+    MeshArena(const MeshArena &) = delete;
+    MeshArena &operator=(const MeshArena &) = delete;
+
+    /*! uninitialized memory, valid until the arena dies */
+    void *allocate(size_t bytes, size_t alignment = ARRAY_ALIGNMENT);
+
+    /*! copy the given elements into the arena, and return a view of
+        the copy */
+    template<typename T>
+    MeshArray<T> copyArray(const T *data, size_t count)
+    {
+      if (count == 0) return MeshArray<T>();
+      T *copy = (T *)allocate(count*sizeof(T),
+                              std::max<size_t>(alignof(T),ARRAY_ALIGNMENT));
+      memcpy((void *)copy,data,count*sizeof(T));
+      return MeshArray<T>::view(copy,count);
+    }
+
+    /*! a default-constructed mesh that lives in the arena */
+    TriangleMesh *newMesh();
+
+    /*! a copy of the given mesh that lives in the arena, arrays and
+        all; source can then be cleared and re-used */
+    TriangleMesh *packMesh(const TriangleMesh &source);
+
+    /*! whether ptr points into memory of this arena */
+    bool contains(const void *ptr) const;
+
+    size_t numBlocks() const;
+
+    /*! bytes allocated so far (not counting unused block space) */
+    size_t memoryUsage() const;
+
+  private:
+    struct Block {
+      char  *data;
+      size_t size;
+      size_t used;
+    };
+
+    size_t                      blockSize;
+    mutable std::mutex          mutex;
+    std::vector<Block>          blocks;
+    std::vector<TriangleMesh *> meshes;
+    size_t                      allocatedBytes { 0 };
+  };
+
+} // ::osc
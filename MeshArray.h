@@ -0,0 +1,150 @@
+// ======================================================================== //
+// Copyright 2018-2024 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+//std
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+/*! \namespace osc - Optix Siggraph Course */
+namespace osc {
+
+  /*! an array of mesh data that either owns its elements (like a
+      std::vector), or is a view into memory owned by somebody else -
+      eg, a memory-mapped model file. Reading is the same either way;
+      anything that changes the size first copies a view into owned
+      storage, so code that builds meshes can treat it like a vector.
+
+      Whoever creates views is responsible for keeping the viewed
+      memory alive as long as the array (see Model::storage). */
+  template<typename T>
+  class MeshArray {
+  public:
+    typedef T        value_type;
+    typedef T       *iterator;
+    typedef const T *const_iterator;
+
+    MeshArray() = default;
+    MeshArray(const MeshArray &other) { *this = other; }
+    MeshArray(MeshArray &&other) noexcept { *this = std::move(other); }
+    MeshArray(std::vector<T> &&elements)
+      : owned(std::move(elements))
+    { rebind(); }
+    MeshArray(std::initializer_list<T> elements)
+      : owned(elements)
+    { rebind(); }
+
+    /*! a non-owning array of the given elements */
+    static MeshArray view(T *data, size_t count)
+    {
+      MeshArray array;
+      array.ptr   = data;
+      array.count = count;
+      array.owns  = false;
+      return array;
+    }
+
+    MeshArray &operator=(const MeshArray &other)
+    {
+      if (this == &other) return *this;
+      owns = other.owns;
+      if (owns) {
+        owned = other.owned;
+        rebind();
+      } else {
+        owned.clear();
+        ptr   = other.ptr;
+        count = other.count;
+      }
+      return *this;
+    }
+
+    MeshArray &operator=(MeshArray &&other) noexcept
+    {
+      if (this == &other) return *this;
+      owns  = other.owns;
+      owned = std::move(other.owned);
+      if (owns) {
+        rebind();
+      } else {
+        ptr   = other.ptr;
+        count = other.count;
+      }
+      other.owns = true;
+      other.owned.clear();
+      other.rebind();
+      return *this;
+    }
+
+    /*! whether this array views memory it doesn't own */
+    bool isView() const { return !owns; }
+
+    size_t   size()  const { return count; }
+    bool     empty() const { return count == 0; }
+    T       *data()        { return ptr; }
+    const T *data()  const { return ptr; }
+
+    T       &operator[](size_t i)       { return ptr[i]; }
+    const T &operator[](size_t i) const { return ptr[i]; }
+
+    T       *begin()       { return ptr; }
+    T       *end()         { return ptr+count; }
+    const T *begin() const { return ptr; }
+    const T *end()   const { return ptr+count; }
+
+    T       &back()        { return ptr[count-1]; }
+    const T &back()  const { return ptr[count-1]; }
+
+    void push_back(const T &t)
+    { makeOwned(); owned.push_back(t); rebind(); }
+
+    void reserve(size_t n)
+    { makeOwned(); owned.reserve(n); rebind(); }
+
+    void resize(size_t n)
+    { makeOwned(); owned.resize(n); rebind(); }
+
+    template<typename It>
+    void assign(It first, It last)
+    { owns = true; owned.assign(first,last); rebind(); }
+
+    void clear()
+    { owns = true; owned.clear(); rebind(); }
+
+  private:
+    void rebind()
+    {
+      ptr   = owned.data();
+      count = owned.size();
+    }
+
+    void makeOwned()
+    {
+      if (owns) return;
+      owned.assign(ptr,ptr+count);
+      owns = true;
+      rebind();
+    }
+
+    T             *ptr   { nullptr };
+    size_t         count { 0 };
+    bool           owns  { true };
+    std::vector<T> owned;
+  };
+
+} // ::osc
@@ -0,0 +1,260 @@
+// ======================================================================== //
+// Copyright 2018-2024 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "MeshOptimizer.h"
+//std
+#include <algorithm>
+#include <cmath>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_sort.h>
+
+/*! \namespace osc - Optix Siggraph Course */
+namespace osc {
+
+  /*! size of the (simulated) post-transform vertex cache */
+  static const int CACHE_SIZE = 32;
+
+  /*! spread the lower 10 bits of v out to every third bit */
+  inline uint32_t expandBits(uint32_t v)
+  {
+    v = (v * 0x00010001u) & 0xFF0000FFu;
+    v = (v * 0x00000101u) & 0x0F00F00Fu;
+    v = (v * 0x00000011u) & 0xC30C30C3u;
+    v = (v * 0x00000005u) & 0x49249249u;
+    return v;
+  }
+
+  /*! 30-bit Morton code of a point in the unit cube */
+  inline uint32_t mortonCode(const vec3f &p)
+  {
+    const float scale = 1023.f;
+    const uint32_t x = (uint32_t)std::min(std::max(p.x*scale,0.f),scale);
+    const uint32_t y = (uint32_t)std::min(std::max(p.y*scale,0.f),scale);
+    const uint32_t z = (uint32_t)std::min(std::max(p.z*scale,0.f),scale);
+    return (expandBits(x) << 2) | (expandBits(y) << 1) | expandBits(z);
+  }
+
+  /*! triangle order sorted by the Morton codes of their centroids
+      within the mesh's bounds; ties keep their input order */
+  static std::vector<int> mortonOrder(const TriangleMesh &mesh)
+  {
+    const size_t numTriangles = mesh.index.size();
+    const box3f bounds = computeBounds(mesh.vertex.data(),mesh.vertex.size());
+    const vec3f extent = max(bounds.span(),vec3f(1e-20f));
+
+    std::vector<uint64_t> keys(numTriangles);
+    tbb::parallel_for(size_t(0),numTriangles,[&](size_t i) {
+        const vec3i idx = mesh.index[i];
+        const vec3f centroid
+          = (mesh.vertex[idx.x] + mesh.vertex[idx.y] + mesh.vertex[idx.z])
+          * (1.f/3.f);
+        keys[i] = (uint64_t(mortonCode((centroid - bounds.lower) / extent)) << 32)
+          | uint64_t(i);
+      });
+    tbb::parallel_sort(keys.begin(),keys.end());
+
+    std::vector<int> order(numTriangles);
+    for (size_t i=0;i<numTriangles;i++)
+      order[i] = int(keys[i] & 0xffffffffu);
+    return order;
+  }
+
+  /*! Forsyth's vertex score: recently used vertices score high (except
+      the last triangle's three, to avoid strips), as do vertices with
+      few triangles left - so they get finished off. Both terms come
+      from tables, as this gets evaluated a lot */
+  struct VertexScore {
+    enum { MAX_VALENCE = 64 };
+
+    VertexScore()
+    {
+      for (int i=0;i<CACHE_SIZE;i++)
+        cacheScore[i] = i < 3
+          ? .75f
+          : powf(1.f - float(i-3)/(CACHE_SIZE-3),1.5f);
+      valenceScore[0] = 0.f;
+      for (int i=1;i<MAX_VALENCE;i++)
+        valenceScore[i] = 2.f / sqrtf(float(i));
+    }
+
+    float operator()(int cachePosition, int remainingTriangles) const
+    {
+      if (remainingTriangles == 0) return -1.f;
+      return (cachePosition >= 0 ? cacheScore[cachePosition] : 0.f)
+        + (remainingTriangles < MAX_VALENCE
+           ? valenceScore[remainingTriangles]
+           : 2.f / sqrtf(float(remainingTriangles)));
+    }
+
+    float cacheScore[CACHE_SIZE];
+    float valenceScore[MAX_VALENCE];
+  };
+
+  /*! re-order the given triangle order for vertex cache reuse. When
+      no triangle of a cached vertex is left, continue with the first
+      one not emitted yet in the given order - so that order still
+      decides the overall layout */
+  static std::vector<int> vertexCacheOrder(const TriangleMesh &mesh,
+                                           const std::vector<int> &inOrder)
+  {
+    const size_t numTriangles = inOrder.size();
+    const size_t numVertices  = mesh.vertex.size();
+
+    // triangles of each vertex (by position in inOrder), as CSR
+    std::vector<int> firstTriangle(numVertices+1,0);
+    for (int t : inOrder)
+      for (int k=0;k<3;k++) firstTriangle[mesh.index[t][k]+1]++;
+    for (size_t v=0;v<numVertices;v++)
+      firstTriangle[v+1] += firstTriangle[v];
+    std::vector<int> vertexTriangles(firstTriangle[numVertices]);
+    std::vector<int> remaining(numVertices,0);
+    for (size_t i=0;i<numTriangles;i++)
+      for (int k=0;k<3;k++) {
+        const int v = mesh.index[inOrder[i]][k];
+        vertexTriangles[firstTriangle[v] + remaining[v]++] = int(i);
+      }
+
+    static const VertexScore vertexScore;
+    std::vector<int>   cachePosition(numVertices,-1);
+    std::vector<float> score(numVertices);
+    for (size_t v=0;v<numVertices;v++)
+      score[v] = vertexScore(-1,remaining[v]);
+    std::vector<float> triangleScore(numTriangles);
+    std::vector<char>  emitted(numTriangles,0);
+    for (size_t i=0;i<numTriangles;i++) {
+      const vec3i idx = mesh.index[inOrder[i]];
+      triangleScore[i] = score[idx.x] + score[idx.y] + score[idx.z];
+    }
+
+    std::vector<int> cache, newCache;
+    cache.reserve(CACHE_SIZE+3);
+    newCache.reserve(CACHE_SIZE+3);
+    std::vector<int> outOrder;
+    outOrder.reserve(numTriangles);
+    size_t nextInOrder = 0;
+    int best = -1;
+    while (outOrder.size() < numTriangles) {
+      if (best < 0) {
+        while (emitted[nextInOrder]) nextInOrder++;
+        best = int(nextInOrder);
+      }
+      const vec3i idx = mesh.index[inOrder[best]];
+      outOrder.push_back(inOrder[best]);
+      emitted[best] = 1;
+
+      // the triangle's vertices move to the front of the cache
+      newCache.clear();
+      for (int k=0;k<3;k++) {
+        const int v = idx[k];
+        newCache.push_back(v);
+        // this triangle is done, so drop it from the vertex's list
+        int *tris = &vertexTriangles[firstTriangle[v]];
+        int *last = tris + remaining[v] - 1;
+        std::swap(*std::find(tris,last+1,best),*last);
+        remaining[v]--;
+      }
+      for (int v : cache)
+        if (v != idx.x && v != idx.y && v != idx.z)
+          newCache.push_back(v);
+
+      // re-score the vertices that are (or just fell out of) the
+      // cache, and their triangles, picking the best one for next
+      for (size_t i=0;i<newCache.size();i++) {
+        const int v = newCache[i];
+        cachePosition[v] = i < size_t(CACHE_SIZE) ? int(i) : -1;
+        const float newScore = vertexScore(cachePosition[v],remaining[v]);
+        const float delta    = newScore - score[v];
+        score[v] = newScore;
+        for (int j=0;j<remaining[v];j++)
+          triangleScore[vertexTriangles[firstTriangle[v]+j]] += delta;
+      }
+      best = -1;
+      float bestScore = -1.f;
+      for (size_t i=0;i<newCache.size() && i<size_t(CACHE_SIZE);i++) {
+        const int v = newCache[i];
+        for (int j=0;j<remaining[v];j++) {
+          const int t = vertexTriangles[firstTriangle[v]+j];
+          if (triangleScore[t] > bestScore) {
+            bestScore = triangleScore[t];
+            best      = t;
+          }
+        }
+      }
+      if (newCache.size() > size_t(CACHE_SIZE))
+        newCache.resize(CACHE_SIZE);
+      cache.swap(newCache);
+    }
+    return outOrder;
+  }
+
+  template<typename T>
+  static void permute(MeshArray<T> &array, const std::vector<int> &newToOld)
+  {
+    if (array.empty()) return;
+    std::vector<T> permuted(newToOld.size());
+    for (size_t i=0;i<newToOld.size();i++)
+      permuted[i] = array[newToOld[i]];
+    array = MeshArray<T>(std::move(permuted));
+  }
+
+  void optimizeMesh(TriangleMesh &mesh, MeshRemap *remap)
+  {
+    const size_t numVertices = mesh.vertex.size();
+    std::vector<int> triangleOrder
+      = vertexCacheOrder(mesh,mortonOrder(mesh));
+
+    // renumber vertices by first use
+    std::vector<int> oldToNew(numVertices,-1), newToOld;
+    newToOld.reserve(numVertices);
+    std::vector<vec3i> index(triangleOrder.size());
+    for (size_t i=0;i<triangleOrder.size();i++) {
+      const vec3i idx = mesh.index[triangleOrder[i]];
+      for (int k=0;k<3;k++) {
+        int &v = oldToNew[idx[k]];
+        if (v < 0) {
+          v = int(newToOld.size());
+          newToOld.push_back(idx[k]);
+        }
+        index[i][k] = v;
+      }
+    }
+    for (size_t v=0;v<numVertices;v++)
+      if (oldToNew[v] < 0) {
+        oldToNew[v] = int(newToOld.size());
+        newToOld.push_back(int(v));
+      }
+
+    mesh.index = MeshArray<vec3i>(std::move(index));
+    permute(mesh.vertex,  newToOld);
+    permute(mesh.normal,  newToOld);
+    permute(mesh.texcoord,newToOld);
+
+    if (remap) {
+      remap->triangle = std::move(triangleOrder);
+      remap->vertex   = std::move(newToOld);
+    }
+  }
+
+  void optimizeModel(Model *model, std::vector<MeshRemap> *remaps)
+  {
+    if (remaps) remaps->resize(model->meshes.size());
+    tbb::parallel_for(size_t(0),model->meshes.size(),[&](size_t meshID) {
+        optimizeMesh(*model->meshes[meshID],
+                     remaps ? &(*remaps)[meshID] : nullptr);
+      });
+  }
+
+} // ::osc
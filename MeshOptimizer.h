@@ -0,0 +1,60 @@
+// ======================================================================== //
+// Copyright 2018-2024 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "Model.h"
+//std
+#include <vector>
+
+/*! \namespace osc - Optix Siggraph Course */
+namespace osc {
+
+  /*! how optimizeMesh reordered a mesh: for each triangle and vertex
+      of the optimized mesh, its index in the mesh as it was before.
+      Eg, a hit's primID maps back to the input's triangle (and from
+      there to the face it was tessellated from) through triangle */
+  struct MeshRemap {
+    std::vector<int> triangle;
+    std::vector<int> vertex;
+
+    bool empty() const { return triangle.empty(); }
+  };
+
+  /*! reorder the mesh's triangles and vertices for memory locality,
+      without changing the surface it describes:
+
+      - triangles get sorted by the Morton code of their centroids, so
+        spatially close triangles are close in memory - which is what
+        BVH builds and traversal touch;
+
+      - within that order, triangles get locally re-ordered for vertex
+        cache reuse (Forsyth's "linear-speed vertex cache
+        optimisation"), which keeps the triangles sharing a vertex
+        together;
+
+      - vertices get renumbered in order of first use, and all
+        per-vertex arrays permuted accordingly. Vertices no triangle
+        uses keep their relative order, after all the used ones.
+
+      If remap is given, it receives the permutations applied */
+  void optimizeMesh(TriangleMesh &mesh, MeshRemap *remap = nullptr);
+
+  /*! optimizeMesh all of the model's meshes, in parallel; remaps (if
+      given) gets one remap per mesh */
+  void optimizeModel(Model *model, std::vector<MeshRemap> *remaps = nullptr);
+
+} // ::osc
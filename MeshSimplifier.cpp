@@ -0,0 +1,372 @@
+// ======================================================================== //
+// Copyright 2018-2024 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "MeshSimplifier.h"
+//std
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <queue>
+#include <system_error>
+
+/*! \namespace osc - Optix Siggraph Course */
+namespace osc {
+
+  /*! how much more than the surface open boundaries resist moving */
+  static const double BOUNDARY_WEIGHT = 1000.;
+  /*! collapses that turn a triangle's normal by more than about 80
+      degrees count as folding it over */
+  static const double MIN_NORMAL_COS = .2;
+
+  /*! symmetric 4x4 matrix of a quadric error: the sum of squared
+      distances to a set of (weighted) planes */
+  struct Quadric {
+    double a00 { 0 }, a01 { 0 }, a02 { 0 }, a03 { 0 };
+    double a11 { 0 }, a12 { 0 }, a13 { 0 };
+    double a22 { 0 }, a23 { 0 };
+    double a33 { 0 };
+
+    /*! the plane n.x + d = 0, n of unit length */
+    static Quadric plane(const vec3f &n, double d, double weight)
+    {
+      Quadric q;
+      q.a00 = weight*n.x*n.x; q.a01 = weight*n.x*n.y; q.a02 = weight*n.x*n.z; q.a03 = weight*n.x*d;
+      q.a11 = weight*n.y*n.y; q.a12 = weight*n.y*n.z; q.a13 = weight*n.y*d;
+      q.a22 = weight*n.z*n.z; q.a23 = weight*n.z*d;
+      q.a33 = weight*d*d;
+      return q;
+    }
+
+    Quadric &operator+=(const Quadric &o)
+    {
+      a00 += o.a00; a01 += o.a01; a02 += o.a02; a03 += o.a03;
+      a11 += o.a11; a12 += o.a12; a13 += o.a13;
+      a22 += o.a22; a23 += o.a23;
+      a33 += o.a33;
+      return *this;
+    }
+
+    double error(const vec3f &p) const
+    {
+      const double x = p.x, y = p.y, z = p.z;
+      return a00*x*x + 2*a01*x*y + 2*a02*x*z + 2*a03*x
+        +    a11*y*y + 2*a12*y*z + 2*a13*y
+        +    a22*z*z + 2*a23*z
+        +    a33;
+    }
+
+    /*! the point of least error; false if that's not unique (eg, for
+        planes that are all parallel) */
+    bool minimum(vec3f &p) const
+    {
+      const double det
+        = a00*(a11*a22 - a12*a12)
+        - a01*(a01*a22 - a12*a02)
+        + a02*(a01*a12 - a11*a02);
+      const double scale = a00*a11*a22;
+      if (fabs(det) <= 1e-12 * fabs(scale) || det == 0.) return false;
+      // Cramer's rule on A x = -b
+      const double b0 = -a03, b1 = -a13, b2 = -a23;
+      const double x
+        = (b0*(a11*a22 - a12*a12) - a01*(b1*a22 - a12*b2) + a02*(b1*a12 - a11*b2)) / det;
+      const double y
+        = (a00*(b1*a22 - a12*b2) - b0*(a01*a22 - a12*a02) + a02*(a01*b2 - b1*a02)) / det;
+      const double z
+        = (a00*(a11*b2 - b1*a12) - a01*(a01*b2 - b1*a02) + b0*(a01*a12 - a11*a02)) / det;
+      p = vec3f(float(x),float(y),float(z));
+      return std::isfinite(p.x) && std::isfinite(p.y) && std::isfinite(p.z);
+    }
+  };
+
+  /*! the state of an in-progress simplification */
+  class Simplifier {
+  public:
+    Simplifier(const vec3f *vertex, size_t numVertices,
+               const vec3i *index, size_t numTriangles)
+      : position(vertex,vertex+numVertices),
+        quadric(numVertices),
+        version(numVertices,0),
+        vertexTriangles(numVertices)
+    {
+      for (size_t i=0;i<numTriangles;i++) {
+        const vec3i t = index[i];
+        if (t.x < 0 || t.y < 0 || t.z < 0
+            || size_t(t.x) >= numVertices || size_t(t.y) >= numVertices
+            || size_t(t.z) >= numVertices
+            || t.x == t.y || t.y == t.z || t.z == t.x)
+          continue;
+        triangles.push_back(t);
+      }
+      triangleAlive.assign(triangles.size(),true);
+      numAlive = triangles.size();
+
+      // face planes, weighted by area
+      std::vector<std::pair<int,int>> edges;
+      for (size_t i=0;i<triangles.size();i++) {
+        const vec3i t = triangles[i];
+        const vec3f n = cross(position[t.y]-position[t.x],position[t.z]-position[t.x]);
+        const float area = .5f*length(n);
+        if (area > 0.f) {
+          const vec3f un = n * (.5f/area);
+          const Quadric q = Quadric::plane(un,-dot(un,position[t.x]),area);
+          for (int c=0;c<3;c++) quadric[t[c]] += q;
+        }
+        for (int c=0;c<3;c++) {
+          vertexTriangles[t[c]].push_back(int(i));
+          edges.push_back({t[c],t[(c+1)%3]});
+        }
+      }
+
+      // open boundaries: edges only one triangle has, in either direction
+      std::vector<std::pair<int,int>> undirected(edges);
+      for (auto &e : undirected) if (e.first > e.second) std::swap(e.first,e.second);
+      std::sort(undirected.begin(),undirected.end());
+      for (size_t i=0;i<triangles.size();i++) {
+        const vec3i t = triangles[i];
+        const vec3f n = cross(position[t.y]-position[t.x],position[t.z]-position[t.x]);
+        for (int c=0;c<3;c++) {
+          const int a = t[c], b = t[(c+1)%3];
+          const std::pair<int,int> key(std::min(a,b),std::max(a,b));
+          const auto range = std::equal_range(undirected.begin(),undirected.end(),key);
+          if (range.second - range.first != 1) continue;
+          const vec3f edge = position[b]-position[a];
+          const vec3f side = cross(edge,n);
+          const float len  = length(side);
+          if (len <= 0.f) continue;
+          const vec3f un = side * (1.f/len);
+          const Quadric q = Quadric::plane(un,-dot(un,position[a]),
+                                           BOUNDARY_WEIGHT*dot(edge,edge));
+          quadric[a] += q;
+          quadric[b] += q;
+        }
+      }
+
+      undirected.erase(std::unique(undirected.begin(),undirected.end()),undirected.end());
+      for (auto &e : undirected) pushEdge(e.first,e.second);
+    }
+
+    void run(size_t targetTriangles)
+    {
+      while (numAlive > targetTriangles && !queue.empty()) {
+        const Candidate c = queue.top();
+        queue.pop();
+        if (version[c.u] != c.versionU || version[c.v] != c.versionV)
+          continue;
+        collapse(c.u,c.v,c.target);
+      }
+    }
+
+    void output(std::vector<vec3f> &outVertex, std::vector<vec3i> &outIndex) const
+    {
+      outVertex.clear();
+      outIndex.clear();
+      std::vector<int> newID(position.size(),-1);
+      for (size_t i=0;i<triangles.size();i++) {
+        if (!triangleAlive[i]) continue;
+        vec3i t = triangles[i];
+        for (int c=0;c<3;c++) {
+          int &id = newID[t[c]];
+          if (id < 0) {
+            id = int(outVertex.size());
+            outVertex.push_back(position[t[c]]);
+          }
+          t[c] = id;
+        }
+        outIndex.push_back(t);
+      }
+    }
+
+  private:
+    struct Candidate {
+      double cost;
+      int    u, v;
+      int    versionU, versionV;
+      vec3f  target;
+      bool operator>(const Candidate &o) const { return cost > o.cost; }
+    };
+
+    void pushEdge(int u, int v)
+    {
+      Quadric q = quadric[u];
+      q += quadric[v];
+      Candidate c;
+      c.u = u;
+      c.v = v;
+      c.versionU = version[u];
+      c.versionV = version[v];
+      if (!q.minimum(c.target)) {
+        // no unique optimum: the best of the ends and the midpoint
+        const vec3f mid = .5f*(position[u]+position[v]);
+        c.target = position[u];
+        if (q.error(position[v]) < q.error(c.target)) c.target = position[v];
+        if (q.error(mid)         < q.error(c.target)) c.target = mid;
+      }
+      c.cost = std::max(q.error(c.target),0.);
+      queue.push(c);
+    }
+
+    /*! whether moving vertex from to p turns any of its triangles not
+        shared with other over */
+    bool foldsOver(int from, int other, const vec3f &p) const
+    {
+      for (int t : vertexTriangles[from]) {
+        if (!triangleAlive[t]) continue;
+        const vec3i tri = triangles[t];
+        if (tri.x == other || tri.y == other || tri.z == other) continue;
+        vec3f q[3] = { position[tri.x],position[tri.y],position[tri.z] };
+        const vec3f before = cross(q[1]-q[0],q[2]-q[0]);
+        for (int c=0;c<3;c++) if (tri[c] == from) q[c] = p;
+        const vec3f after = cross(q[1]-q[0],q[2]-q[0]);
+        const double lb = length(before), la = length(after);
+        if (la <= 0. || dot(before,after) < MIN_NORMAL_COS * lb * la)
+          return true;
+      }
+      return false;
+    }
+
+    /*! merge v into u, moving u to target */
+    void collapse(int u, int v, const vec3f &target)
+    {
+      if (foldsOver(u,v,target) || foldsOver(v,u,target)) return;
+
+      position[u] = target;
+      quadric[u] += quadric[v];
+      ++version[u];
+      ++version[v];
+      for (int t : vertexTriangles[v]) {
+        if (!triangleAlive[t]) continue;
+        vec3i &tri = triangles[t];
+        if (tri.x == u || tri.y == u || tri.z == u) {
+          triangleAlive[t] = false;
+          --numAlive;
+          continue;
+        }
+        for (int c=0;c<3;c++) if (tri[c] == v) tri[c] = u;
+        vertexTriangles[u].push_back(t);
+      }
+      std::vector<int>().swap(vertexTriangles[v]);
+
+      // drop the dead, and re-queue the edges around u
+      auto &around = vertexTriangles[u];
+      around.erase(std::remove_if(around.begin(),around.end(),
+                                  [&](int t) { return !triangleAlive[t]; }),
+                   around.end());
+      std::vector<int> neighbors;
+      for (int t : around)
+        for (int c=0;c<3;c++)
+          if (triangles[t][c] != u) neighbors.push_back(triangles[t][c]);
+      std::sort(neighbors.begin(),neighbors.end());
+      neighbors.erase(std::unique(neighbors.begin(),neighbors.end()),neighbors.end());
+      // only u's edges changed; the edges between its neighbors keep
+      // their quadrics and positions, so their queued costs still hold
+      for (int w : neighbors) pushEdge(u,w);
+    }
+
+    std::vector<vec3f>            position;
+    std::vector<Quadric>          quadric;
+    /*! bumped whenever a vertex moves or dies, which invalidates the
+        queued candidates using it */
+    std::vector<int>              version;
+    std::vector<vec3i>            triangles;
+    std::vector<bool>             triangleAlive;
+    std::vector<std::vector<int>> vertexTriangles;
+    size_t                        numAlive { 0 };
+    std::priority_queue<Candidate,std::vector<Candidate>,
+                        std::greater<Candidate>> queue;
+  };
+
+  void simplifyMesh(const vec3f *vertex, size_t numVertices,
+                    const vec3i *index,  size_t numTriangles,
+                    size_t targetTriangles,
+                    std::vector<vec3f> &outVertex,
+                    std::vector<vec3i> &outIndex)
+  {
+    Simplifier simplifier(vertex,numVertices,index,numTriangles);
+    simplifier.run(targetTriangles);
+    simplifier.output(outVertex,outIndex);
+  }
+
+  /* cache file layout: SimplifiedHeader, vertices, triangles */
+  static const char     LOD_MAGIC[8] = { 'O','S','C','L','O','D','M','S' };
+  static const uint32_t LOD_VERSION  = 1;
+
+  struct SimplifiedHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t numVertices;
+    uint64_t key;
+    uint64_t numTriangles;
+  };
+
+  bool saveSimplifiedMesh(const std::string &fileName, uint64_t key,
+                          const std::vector<vec3f> &vertex,
+                          const std::vector<vec3i> &index)
+  {
+    SimplifiedHeader header = {};
+    memcpy(header.magic,LOD_MAGIC,sizeof(LOD_MAGIC));
+    header.version      = LOD_VERSION;
+    header.numVertices  = uint32_t(vertex.size());
+    header.key          = key;
+    header.numTriangles = index.size();
+
+    const std::string tmpFile = fileName + ".tmp";
+    FILE *file = fopen(tmpFile.c_str(),"wb");
+    if (!file) return false;
+    bool ok = fwrite(&header,sizeof(header),1,file) == 1
+      && fwrite(vertex.data(),sizeof(vec3f),vertex.size(),file) == vertex.size()
+      && fwrite(index.data(), sizeof(vec3i),index.size(), file) == index.size();
+    ok = (fclose(file) == 0) && ok;
+
+    std::error_code ec;
+    if (ok) std::filesystem::rename(tmpFile,fileName,ec);
+    if (!ok || ec) {
+      std::filesystem::remove(tmpFile,ec);
+      return false;
+    }
+    return true;
+  }
+
+  bool loadSimplifiedMesh(const std::string &fileName, uint64_t key,
+                          std::vector<vec3f> &vertex,
+                          std::vector<vec3i> &index)
+  {
+    FILE *file = fopen(fileName.c_str(),"rb");
+    if (!file) return false;
+    SimplifiedHeader header;
+    bool ok = fread(&header,sizeof(header),1,file) == 1
+      && memcmp(header.magic,LOD_MAGIC,sizeof(LOD_MAGIC)) == 0
+      && header.version == LOD_VERSION
+      && header.key     == key;
+    std::vector<vec3f> v(ok ? header.numVertices  : 0);
+    std::vector<vec3i> t(ok ? header.numTriangles : 0);
+    ok = ok
+      && fread(v.data(),sizeof(vec3f),v.size(),file) == v.size()
+      && fread(t.data(),sizeof(vec3i),t.size(),file) == t.size();
+    fclose(file);
+    for (const vec3i &tri : t)
+      ok = ok && tri.x >= 0 && tri.y >= 0 && tri.z >= 0
+        && size_t(tri.x) < v.size() && size_t(tri.y) < v.size()
+        && size_t(tri.z) < v.size();
+    if (!ok) return false;
+    vertex = std::move(v);
+    index  = std::move(t);
+    return true;
+  }
+
+} // ::osc
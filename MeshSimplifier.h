@@ -0,0 +1,59 @@
+// ======================================================================== //
+// Copyright 2018-2024 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "gdt/math/vec.h"
+//std
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*! \namespace osc - Optix Siggraph Course */
+namespace osc {
+  using namespace gdt;
+
+  /*! simplify a triangle mesh to at most targetTriangles triangles,
+      by repeatedly collapsing the edge whose collapse adds the least
+      quadric error (Garland & Heckbert, "Surface Simplification Using
+      Quadric Error Metrics"). Collapsed vertices move to the position
+      minimizing the error. Open boundaries are held in place by extra
+      planes perpendicular to them, and collapses that would flip a
+      triangle are skipped - so the result may have more than
+      targetTriangles if nothing else can go without folding the
+      surface.
+
+      Triangles with out-of-range vertices are ignored; vertices no
+      triangle uses are dropped. */
+  void simplifyMesh(const vec3f *vertex, size_t numVertices,
+                    const vec3i *index,  size_t numTriangles,
+                    size_t targetTriangles,
+                    std::vector<vec3f> &outVertex,
+                    std::vector<vec3i> &outIndex);
+
+  /*! write a simplified mesh to a cache file, tagged with the given
+      key (eg, a hash of the mesh and budget it was made from) */
+  bool saveSimplifiedMesh(const std::string &fileName, uint64_t key,
+                          const std::vector<vec3f> &vertex,
+                          const std::vector<vec3i> &index);
+
+  /*! read a mesh written by saveSimplifiedMesh; false if the file
+      doesn't exist, is broken, or has a different key */
+  bool loadSimplifiedMesh(const std::string &fileName, uint64_t key,
+                          std::vector<vec3f> &vertex,
+                          std::vector<vec3i> &index);
+
+} // ::osc
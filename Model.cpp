@@ -15,6 +15,9 @@
 // ======================================================================== //
 
 #include "Model.h"
+#include "MeshArena.h"
+#include "MeshOptimizer.h"
+#include "ObjParser.h"
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "3rdParty/tiny_obj_loader.h"
 
@@ -22,71 +25,236 @@
 #include "3rdParty/stb_image.h"
 
 //std
-#include <set>
-
-namespace tinyobj {
-  inline bool operator<(const tinyobj::index_t &a,
-                        const tinyobj::index_t &b)
-  {
-    if (a.vertex_index < b.vertex_index) return true;
-    if (a.vertex_index > b.vertex_index) return false;
-    
-    if (a.normal_index < b.normal_index) return true;
-    if (a.normal_index > b.normal_index) return false;
-    
-    if (a.texcoord_index < b.texcoord_index) return true;
-    if (a.texcoord_index > b.texcoord_index) return false;
-    
-    return false;
-  }
-}
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
 
 /*! \namespace osc - Optix Siggraph Course */
 namespace osc {
   
+  Model::~Model()
+  {
+    for (auto mesh : meshes)
+      if (!arena || !arena->contains(mesh))
+        delete mesh;
+  }
 
+  box3f computeBounds(const vec3f *points, size_t count)
+  {
+    static_assert(sizeof(vec3f) == 3*sizeof(float),
+                  "computeBounds reads points as packed floats");
+    return tbb::parallel_reduce
+      (tbb::blocked_range<size_t>(0,count,size_t(16) << 10),box3f(),
+       [points](const tbb::blocked_range<size_t> &range, box3f bounds) {
+        // four points at a time are 12 floats, ie, three SIMD
+        // registers each for the running min and max - which the
+        // compiler vectorizes, unlike a min/max over vec3fs
+        float lo[12], hi[12];
+        for (int j=0;j<12;j++) {
+          lo[j] = bounds.lower[j%3];
+          hi[j] = bounds.upper[j%3];
+        }
+        size_t i = range.begin();
+        for (const float *f=(const float *)(points+i);
+             i+4<=range.end();i+=4,f+=12)
+          for (int j=0;j<12;j++) {
+            lo[j] = std::min(lo[j],f[j]);
+            hi[j] = std::max(hi[j],f[j]);
+          }
+        for (int j=0;j<12;j++) {
+          bounds.lower[j%3] = std::min(bounds.lower[j%3],lo[j]);
+          bounds.upper[j%3] = std::max(bounds.upper[j%3],hi[j]);
+        }
+        for (;i<range.end();i++)
+          bounds.extend(points[i]);
+        return bounds;
+      },
+       [](box3f a, const box3f &b) { return a.extend(b); });
+  }
+
+  void computeBounds(Model *model)
+  {
+    tbb::parallel_for(size_t(0),model->meshes.size(),[&](size_t meshID) {
+        TriangleMesh *mesh = model->meshes[meshID];
+        mesh->bounds = computeBounds(mesh->vertex.data(),mesh->vertex.size());
+      });
+    model->bounds = box3f();
+    for (auto mesh : model->meshes)
+      model->bounds.extend(mesh->bounds);
+  }
+
+  /*! open-addressing (linear probing) hash table from an OBJ corner -
+      ie, its position/normal/texcoord index triple - to the ID of the
+      mesh vertex it got welded into. Each slot packs the key and the
+      vertex ID into 16 bytes, so a probe sequence mostly stays within
+      one cache line */
+  struct VertexWelder {
+    struct Slot {
+      int32_t vertex, normal, texcoord;
+      int32_t vertexID;
+    };
+
+    /*! empty the table, sized for (up to) the given number of
+        distinct corners at a load factor of at most 1/2 */
+    void reset(size_t maxCorners)
+    {
+      size_t capacity = 16;
+      while (capacity < 2*maxCorners) capacity *= 2;
+      mask = capacity-1;
+      slots.assign(capacity,Slot{0,0,0,-1});
+    }
+
+    /*! the vertex ID of the given corner; if it's new, it gets newID
+        and isNew is set */
+    int findOrInsert(const tinyobj::index_t &idx, int newID, bool &isNew)
+    {
+      uint32_t h
+        = uint32_t(idx.vertex_index)   * 0x9e3779b1u
+        ^ uint32_t(idx.normal_index)   * 0x85ebca77u
+        ^ uint32_t(idx.texcoord_index) * 0xc2b2ae3du;
+      h ^= h >> 16;
+      for (size_t i=h & mask;;i=(i+1) & mask) {
+        Slot &slot = slots[i];
+        if (slot.vertexID < 0) {
+          slot = Slot{idx.vertex_index,idx.normal_index,idx.texcoord_index,newID};
+          isNew = true;
+          return newID;
+        }
+        if (slot.vertex   == idx.vertex_index &&
+            slot.normal   == idx.normal_index &&
+            slot.texcoord == idx.texcoord_index) {
+          isNew = false;
+          return slot.vertexID;
+        }
+      }
+    }
+
+    std::vector<Slot> slots;
+    size_t            mask { 0 };
+  };
 
   /*! find vertex with given position, normal, texcoord, and return
       its vertex ID, or, if it doesn't exit, add it to the mesh, and
-      its just-created index */
-  int addVertex(TriangleMesh *mesh,
-                tinyobj::attrib_t &attributes,
-                const tinyobj::index_t &idx,
-                std::map<tinyobj::index_t,int> &knownVertices)
+      its just-created index. Corners without a normal or texcoord get
+      zeroes; addMeshFaces drops arrays that end up all-missing */
+  static int addVertex(TriangleMesh *mesh,
+                       const tinyobj::attrib_t &attributes,
+                       const tinyobj::index_t &idx,
+                       VertexWelder &welder,
+                       bool &hasNormals,
+                       bool &hasTexcoords)
   {
-    if (knownVertices.find(idx) != knownVertices.end())
-      return knownVertices[idx];
+    bool isNew;
+    const int vertexID
+      = welder.findOrInsert(idx,(int)mesh->vertex.size(),isNew);
+    if (!isNew)
+      return vertexID;
 
     const vec3f *vertex_array   = (const vec3f*)attributes.vertices.data();
     const vec3f *normal_array   = (const vec3f*)attributes.normals.data();
     const vec2f *texcoord_array = (const vec2f*)attributes.texcoords.data();
-    
-    int newID = (int)mesh->vertex.size();
-    knownVertices[idx] = newID;
 
     mesh->vertex.push_back(vertex_array[idx.vertex_index]);
-    if (idx.normal_index >= 0) {
-      while (mesh->normal.size() < mesh->vertex.size())
-        mesh->normal.push_back(normal_array[idx.normal_index]);
-    }
-    if (idx.texcoord_index >= 0) {
-      while (mesh->texcoord.size() < mesh->vertex.size())
-        mesh->texcoord.push_back(texcoord_array[idx.texcoord_index]);
+    mesh->normal.push_back(idx.normal_index >= 0
+                           ? normal_array[idx.normal_index]
+                           : vec3f(0.f));
+    mesh->texcoord.push_back(idx.texcoord_index >= 0
+                             ? texcoord_array[idx.texcoord_index]
+                             : vec2f(0.f));
+    hasNormals   |= (idx.normal_index   >= 0);
+    hasTexcoords |= (idx.texcoord_index >= 0);
+    return vertexID;
+  }
+
+  /*! build a mesh from the given faces of a shape into scratch
+      (whose arrays keep their capacity from mesh to mesh), and pack
+      it into the arena */
+  static TriangleMesh *addMeshFaces(const tinyobj::attrib_t &attributes,
+                                    const tinyobj::shape_t &shape,
+                                    const int *faceIDs,
+                                    size_t numFaces,
+                                    VertexWelder &welder,
+                                    TriangleMesh &scratch,
+                                    MeshArena &arena)
+  {
+    TriangleMesh *mesh = &scratch;
+    mesh->vertex.clear();
+    mesh->normal.clear();
+    mesh->texcoord.clear();
+    mesh->index.clear();
+    welder.reset(3*numFaces);
+    mesh->index.reserve(numFaces);
+
+    bool hasNormals = false, hasTexcoords = false;
+    for (size_t i=0;i<numFaces;i++) {
+      const int faceID = faceIDs[i];
+      const tinyobj::index_t &idx0 = shape.mesh.indices[3*faceID+0];
+      const tinyobj::index_t &idx1 = shape.mesh.indices[3*faceID+1];
+      const tinyobj::index_t &idx2 = shape.mesh.indices[3*faceID+2];
+      
+      vec3i idx(addVertex(mesh,attributes,idx0,welder,hasNormals,hasTexcoords),
+                addVertex(mesh,attributes,idx1,welder,hasNormals,hasTexcoords),
+                addVertex(mesh,attributes,idx2,welder,hasNormals,hasTexcoords));
+      mesh->index.push_back(idx);
     }
+    if (!hasNormals)   mesh->normal.clear();
+    if (!hasTexcoords) mesh->texcoord.clear();
+    return arena.packMesh(*mesh);
+  }
 
-    // just for sanity's sake:
-    if (mesh->texcoord.size() > 0)
-      mesh->texcoord.resize(mesh->vertex.size());
-    // just for sanity's sake:
-    if (mesh->normal.size() > 0)
-      mesh->normal.resize(mesh->vertex.size());
-    
-    return newID;
+  /*! a mesh built from one shape's faces of one material */
+  struct ShapeMesh {
+    TriangleMesh *mesh;
+    int           materialID;
+  };
+
+  /*! split the shape's faces into one mesh per material. Faces get
+      bucketed by material with a single counting-sort pass, rather
+      than one pass over all faces per material */
+  static void buildShapeMeshes(const tinyobj::attrib_t &attributes,
+                               const tinyobj::shape_t &shape,
+                               int numMaterials,
+                               VertexWelder &welder,
+                               TriangleMesh &scratch,
+                               MeshArena &arena,
+                               std::vector<ShapeMesh> &meshes)
+  {
+    const std::vector<int> &faceMaterials = shape.mesh.material_ids;
+    const size_t numFaces = faceMaterials.size();
+
+    // bucket 0 is for faces without (or with an invalid) material
+    auto bucketOf = [numMaterials](int materialID) {
+      return (materialID >= 0 && materialID < numMaterials) ? materialID+1 : 0;
+    };
+    std::vector<size_t> bucketBegin(numMaterials+2,0);
+    for (int materialID : faceMaterials)
+      bucketBegin[bucketOf(materialID)+1]++;
+    for (size_t b=1;b<bucketBegin.size();b++)
+      bucketBegin[b] += bucketBegin[b-1];
+
+    std::vector<int>    sortedFaces(numFaces);
+    std::vector<size_t> fill(bucketBegin.begin(),bucketBegin.end()-1);
+    for (size_t faceID=0;faceID<numFaces;faceID++)
+      sortedFaces[fill[bucketOf(faceMaterials[faceID])]++] = (int)faceID;
+
+    for (int b=0;b<numMaterials+1;b++) {
+      const size_t begin = bucketBegin[b], end = bucketBegin[b+1];
+      if (begin == end) continue;
+      meshes.push_back({addMeshFaces(attributes,shape,
+                                     sortedFaces.data()+begin,end-begin,
+                                     welder,scratch,arena),
+                        b-1});
+    }
   }
 
-  /*! load a texture (if not already loaded), and return its ID in the
-      model's textures[] vector. Textures that could not get loaded
-      return -1 */
+  /*! register a texture with the model's texture cache (if not
+      already registered), and return its ID in there. Decoding the
+      file starts right away, in the background */
   int loadTexture(Model *model,
                   std::map<std::string,int> &knownTextures,
                   const std::string &inFileName,
@@ -104,42 +272,47 @@ namespace osc {
       if (c == '\\') c = '/';
     fileName = modelPath+"/"+fileName;
 
-    vec2i res;
-    int   comp;
-    unsigned char* image = stbi_load(fileName.c_str(),
-                                     &res.x, &res.y, &comp, STBI_rgb_alpha);
-    int textureID = -1;
-    if (image) {
-      textureID = (int)model->textures.size();
-      Texture *texture = new Texture;
-      texture->resolution = res;
-      texture->pixel      = (uint32_t*)image;
-
-      /* iw - actually, it seems that stbi loads the pictures
-         mirrored along the y axis - mirror them here */
-      for (int y=0;y<res.y/2;y++) {
-        uint32_t *line_y = texture->pixel + y * res.x;
-        uint32_t *mirrored_y = texture->pixel + (res.y-1-y) * res.x;
-        int mirror_y = res.y-1-y;
-        for (int x=0;x<res.x;x++) {
-          std::swap(line_y[x],mirrored_y[x]);
-        }
-      }
-      
-      model->textures.push_back(texture);
-    } else {
-      std::cout << GDT_TERMINAL_RED
-                << "Could not load texture from " << fileName << "!"
-                << GDT_TERMINAL_DEFAULT << std::endl;
-    }
-    
+    const int textureID = model->textures->addTexture(fileName);
+    model->textures->prefetch(textureID);
     knownTextures[inFileName] = textureID;
     return textureID;
   }
   
-  Model *loadOBJ(const std::string &objFile)
+  /*! where in cacheDir the cache of the given file goes: its name,
+      plus a hash of its absolute path, so that equally named models
+      in different directories don't share a cache file. Optimized
+      models get a cache of their own */
+  static std::string modelCacheFile(const std::string &cacheDir,
+                                    const std::string &objFile,
+                                    bool optimize)
   {
+    std::error_code ec;
+    const std::filesystem::path path
+      = std::filesystem::absolute(objFile,ec).lexically_normal();
+    char hash[17];
+    snprintf(hash,sizeof(hash),"%016llx",
+             (unsigned long long)std::hash<std::string>()(path.string()));
+    return (std::filesystem::path(cacheDir)
+            / (path.stem().string() + "-" + hash
+               + (optimize ? ".opt" : "") + ".oscmodel")).string();
+  }
+
+  Model *loadOBJ(const std::string &objFile, const std::string &cacheDir,
+                 bool optimize)
+  {
+    const bool useCache = !cacheDir.empty();
+    std::string cacheFile;
+    if (useCache) {
+      cacheFile = modelCacheFile(cacheDir,objFile,optimize);
+      if (Model *cached = loadModelCache(cacheFile,objFile)) {
+        std::cout << "mapped model cache " << cacheFile << " - "
+                  << cached->meshes.size() << " meshes" << std::endl;
+        return cached;
+      }
+    }
+
     Model *model = new Model;
+    model->arena = std::make_shared<MeshArena>();
 
     const std::string modelDir
       = objFile.substr(0,objFile.rfind('/')+1);
@@ -148,16 +321,11 @@ namespace osc {
     std::vector<tinyobj::shape_t> shapes;
     std::vector<tinyobj::material_t> materials;
     std::string err = "";
+    std::vector<std::string> mtlFiles;
 
     bool readOK
-      = tinyobj::LoadObj(&attributes,
-                         &shapes,
-                         &materials,
-                         &err,
-                         &err,
-                         objFile.c_str(),
-                         modelDir.c_str(),
-                         /* triangulate */true);
+      = parseOBJ(objFile,modelDir,attributes,shapes,materials,err,
+                 useCache ? &mtlFiles : nullptr);
     if (!readOK) {
       throw std::runtime_error("Could not read OBJ model from "+objFile+" : "+err);
     }
@@ -166,50 +334,68 @@ namespace osc {
       throw std::runtime_error("could not parse materials ...");
 
     std::cout << "Done loading obj file - found " << shapes.size() << " shapes with " << materials.size() << " materials" << std::endl;
+    // register the textures of all materials in use right away, which
+    // starts decoding them while the meshes get built
+    const int numMaterials = (int)materials.size();
     std::map<std::string, int>      knownTextures;
-    for (int shapeID=0;shapeID<(int)shapes.size();shapeID++) {
-      tinyobj::shape_t &shape = shapes[shapeID];
+    std::vector<bool> materialUsed(numMaterials,false);
+    for (auto &shape : shapes)
+      for (int materialID : shape.mesh.material_ids)
+        if (materialID >= 0 && materialID < numMaterials)
+          materialUsed[materialID] = true;
+    for (int materialID=0;materialID<numMaterials;materialID++)
+      if (materialUsed[materialID])
+        loadTexture(model,knownTextures,
+                    materials[materialID].diffuse_texname,modelDir);
 
-      std::set<int> materialIDs;
-      for (auto faceMatID : shape.mesh.material_ids)
-        materialIDs.insert(faceMatID);
-      
-      
-      for (int materialID : materialIDs) {
-        std::map<tinyobj::index_t,int> knownVertices;
-        TriangleMesh *mesh = new TriangleMesh;
-        
-        for (int faceID=0;faceID<shape.mesh.material_ids.size();faceID++) {
-          if (shape.mesh.material_ids[faceID] != materialID) continue;
-          tinyobj::index_t idx0 = shape.mesh.indices[3*faceID+0];
-          tinyobj::index_t idx1 = shape.mesh.indices[3*faceID+1];
-          tinyobj::index_t idx2 = shape.mesh.indices[3*faceID+2];
-          
-          vec3i idx(addVertex(mesh, attributes, idx0, knownVertices),
-                    addVertex(mesh, attributes, idx1, knownVertices),
-                    addVertex(mesh, attributes, idx2, knownVertices));
-          mesh->index.push_back(idx);
-          mesh->diffuse = (const vec3f&)materials[materialID].diffuse;
+    // shapes are independent, so build their meshes in parallel ...
+    std::vector<std::vector<ShapeMesh>> shapeMeshes(shapes.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0,shapes.size()),
+                      [&](const tbb::blocked_range<size_t> &range) {
+                        VertexWelder welder;
+                        TriangleMesh scratch;
+                        for (size_t shapeID=range.begin();shapeID<range.end();shapeID++)
+                          buildShapeMeshes(attributes,shapes[shapeID],
+                                           numMaterials,welder,scratch,
+                                           *model->arena,
+                                           shapeMeshes[shapeID]);
+                      });
+
+    // ... but assign materials and textures serially, and in order, so
+    // mesh IDs don't depend on scheduling
+    for (auto &meshes : shapeMeshes)
+      for (const ShapeMesh &sm : meshes) {
+        TriangleMesh *mesh = sm.mesh;
+        if (sm.materialID >= 0) {
+          const tinyobj::material_t &material = materials[sm.materialID];
+          mesh->diffuse = (const vec3f&)material.diffuse;
           mesh->diffuseTextureID = loadTexture(model,
                                                knownTextures,
-                                               materials[materialID].diffuse_texname,
+                                               material.diffuse_texname,
                                                modelDir);
+        } else {
+          mesh->diffuse = vec3f(.8f);
         }
-
-        if (mesh->vertex.empty())
-          delete mesh;
-        else
-          model->meshes.push_back(mesh);
+        model->meshes.push_back(mesh);
       }
-    }
 
-    // of course, you should be using tbb::parallel_for for stuff
-    // like this:
-    for (auto mesh : model->meshes)
-      for (auto vtx : mesh->vertex)
-        model->bounds.extend(vtx);
+    if (optimize)
+      optimizeModel(model);
+    computeBounds(model);
 
     std::cout << "created a total of " << model->meshes.size() << " meshes" << std::endl;
+
+    // the textures have been decoding while we built the meshes
+    model->textures->waitForPrefetches();
+
+    if (useCache) {
+      std::error_code ec;
+      std::filesystem::create_directories(cacheDir,ec);
+      if (ec || !saveModelCache(model,cacheFile,objFile,mtlFiles))
+        std::cout << GDT_TERMINAL_RED
+                  << "#osc: could not write model cache " << cacheFile
+                  << GDT_TERMINAL_DEFAULT << std::endl;
+    }
     return model;
   }
 }
@@ -17,6 +17,9 @@
 #pragma once
 
 #include "gdt/math/AffineSpace.h"
+#include "MeshArray.h"
+#include "TextureCache.h"
+#include <memory>
 #include <vector>
 
 /*! \namespace osc - Optix Siggraph Course */
@@ -26,36 +29,87 @@ namespace osc {
   /*! a simple indexed triangle mesh that our sample renderer will
       render */
   struct TriangleMesh {
-    std::vector<vec3f> vertex;
-    std::vector<vec3f> normal;
-    std::vector<vec2f> texcoord;
-    std::vector<vec3i> index;
+    MeshArray<vec3f> vertex;
+    MeshArray<vec3f> normal;
+    MeshArray<vec2f> texcoord;
+    MeshArray<vec3i> index;
+
+    /*! bounds of all vertices, as of the last computeBounds */
+    box3f              bounds;
 
     // material data:
     vec3f              diffuse;
     int                diffuseTextureID { -1 };
   };
 
-  struct Texture {
-    ~Texture()
-    { if (pixel) delete[] pixel; }
-    
-    uint32_t *pixel      { nullptr };
-    vec2i     resolution { -1 };
-  };
-  
+  class MeshArena;
+
   struct Model {
-    ~Model()
-    {
-      for (auto mesh : meshes) delete mesh;
-      for (auto texture : textures) delete texture;
-    }
+    /*! deletes all meshes, except those that live in (and so, get
+        destroyed with) the arena */
+    ~Model();
     
     std::vector<TriangleMesh *> meshes;
-    std::vector<Texture *>      textures;
+    /*! all textures referenced by the meshes' texture IDs. loadOBJ
+        decodes them in parallel while loading; otherwise (eg, from a
+        model cache) they only get read once somebody accesses them */
+    std::shared_ptr<TextureCache> textures
+      = std::make_shared<TextureCache>();
+    /*! keeps alive whatever memory the meshes' arrays are views into
+        (if any), eg the mapping of a model cache file */
+    std::shared_ptr<void>       storage;
+    /*! if set, (some or all) meshes and their arrays live in here,
+        rather than each in its own allocations (see MeshArena) */
+    std::shared_ptr<MeshArena>  arena;
     //! bounding box of all vertices in the model
     box3f bounds;
   };
 
-  Model *loadOBJ(const std::string &objFile);
+  /*! bounds of the given points, as a parallel min/max reduction */
+  box3f computeBounds(const vec3f *points, size_t count);
+
+  /*! set the bounds of each of the model's meshes, and the model's
+      bounds from those */
+  void computeBounds(Model *model);
+
+  /*! load the given OBJ file, with all meshes packed into the model's
+      arena. If a cacheDir is given, a binary cache of the model in
+      there gets memory-mapped instead if it is up to date (with the
+      OBJ file as well as its material libraries and textures), and
+      (re-)written after parsing otherwise; the directory gets created
+      if needed. No cache gets read or written by default.
+
+      With optimize, all meshes get re-ordered for memory locality
+      (see optimizeModel) before they get cached */
+  Model *loadOBJ(const std::string &objFile,
+                 const std::string &cacheDir = "",
+                 bool optimize = false);
+
+  /*! load all visible meshes of the given USD stage, with their world
+      transforms baked in and their faces triangulated. Diffuse color
+      (and texture) come from bound UsdPreviewSurface materials, or
+      displayColor if there's none */
+  Model *loadUSD(const std::string &usdFile);
+
+  /*! load the given binary little-endian PLY file as a single mesh.
+      The file gets memory-mapped, and its vertex and face blocks
+      copied (or converted, if not float / int) straight into the
+      mesh's arrays; polygons get fan-triangulated */
+  Model *loadPLY(const std::string &plyFile);
+
+  /*! write the model to a binary cache file, tagged with the size and
+      modification time of the file it was loaded from, of the other
+      files it depends on (eg, material libraries, whether they exist
+      or not), and of its textures */
+  bool saveModelCache(const Model *model,
+                      const std::string &cacheFile,
+                      const std::string &sourceFile,
+                      const std::vector<std::string> &dependencies);
+
+  /*! memory-map a model cache written by saveModelCache; the meshes'
+      arrays are views into the mapping. Returns null if the cache is
+      missing, was written by a different version, or if sourceFile or
+      any of the dependencies changed since */
+  Model *loadModelCache(const std::string &cacheFile,
+                        const std::string &sourceFile);
 }
@@ -0,0 +1,351 @@
+// ======================================================================== //
+// Copyright 2018-2024 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "Model.h"
+#include "MappedFile.h"
+#include "MeshArena.h"
+//std
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+
+/*! \namespace osc - Optix Siggraph Course */
+namespace osc {
+
+  /* file layout (all little-endian, as written by the host):
+
+     FileHeader
+     per mesh: vertex, normal, texcoord and index arrays, each
+               aligned to ARRAY_ALIGNMENT
+     MeshRecord[numMeshes]
+     TextureRecord[numTextures], followed by the texture file names
+     DependencyRecord[numDependencies], followed by their file names
+
+     bump VERSION whenever any of this (or TriangleMesh's element
+     types) changes; caches of other versions just get re-built */
+  static const char     MAGIC[8]        = { 'O','S','C','M','O','D','E','L' };
+  static const uint32_t VERSION         = 3;
+  static const uint32_t ENDIAN_TAG      = 0x01020304u;
+  static const uint64_t ARRAY_ALIGNMENT = 16;
+
+  struct FileHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t endianTag;
+    /*! size and modification time of the file the model came from */
+    uint64_t sourceSize;
+    int64_t  sourceTime;
+    uint64_t fileSize;
+    uint32_t numMeshes;
+    uint32_t numTextures;
+    box3f    bounds;
+    uint32_t numDependencies;
+    uint64_t meshTableOffset;
+    uint64_t textureTableOffset;
+    uint64_t dependencyTableOffset;
+  };
+
+  struct MeshRecord {
+    uint64_t vertexOffset, normalOffset, texcoordOffset, indexOffset;
+    uint64_t numVertices,  numNormals,   numTexcoords,   numIndices;
+    box3f    bounds;
+    vec3f    diffuse;
+    int32_t  diffuseTextureID;
+  };
+
+  struct TextureRecord {
+    uint64_t nameOffset;
+    uint64_t nameLength;
+  };
+
+  /*! another file the model got read from (material libraries,
+      textures), and its size and modification time back then */
+  struct DependencyRecord {
+    uint64_t nameOffset;
+    uint64_t nameLength;
+    uint64_t size;
+    int64_t  time;
+  };
+
+  /*! size and modification time of the given file; false if it
+      doesn't exist */
+  static bool getSourceStamp(const std::string &fileName,
+                             uint64_t &size, int64_t &time)
+  {
+    std::error_code ec;
+    size = std::filesystem::file_size(fileName,ec);
+    if (ec) return false;
+    const auto mtime = std::filesystem::last_write_time(fileName,ec);
+    if (ec) return false;
+    time = (int64_t)mtime.time_since_epoch().count();
+    return true;
+  }
+
+  /*! stamp of a dependency; one that doesn't exist gets a stamp no
+      existing file has, so creating it later invalidates the cache */
+  static void getDependencyStamp(const std::string &fileName,
+                                 uint64_t &size, int64_t &time)
+  {
+    if (!getSourceStamp(fileName,size,time)) {
+      size = ~uint64_t(0);
+      time = 0;
+    }
+  }
+
+  /*! appends to the cache file, tracking the write offset */
+  struct CacheWriter {
+    bool write(const void *ptr, size_t bytes)
+    {
+      if (bytes && fwrite(ptr,1,bytes,file) != bytes) return false;
+      offset += bytes;
+      return true;
+    }
+
+    bool align()
+    {
+      static const char zeros[ARRAY_ALIGNMENT] = {};
+      return write(zeros,(ARRAY_ALIGNMENT - offset % ARRAY_ALIGNMENT)
+                   % ARRAY_ALIGNMENT);
+    }
+
+    template<typename T>
+    bool writeArray(const MeshArray<T> &array, uint64_t &arrayOffset)
+    {
+      if (!align()) return false;
+      arrayOffset = offset;
+      return write(array.data(),array.size()*sizeof(T));
+    }
+
+    FILE    *file   { nullptr };
+    uint64_t offset { 0 };
+  };
+
+  bool saveModelCache(const Model *model,
+                      const std::string &cacheFile,
+                      const std::string &sourceFile,
+                      const std::vector<std::string> &dependencies)
+  {
+    // the header goes to disk byte by byte, so clear its padding, too
+    FileHeader header;
+    memset((void *)&header,0,sizeof(header));
+    memcpy(header.magic,MAGIC,sizeof(MAGIC));
+    header.version     = VERSION;
+    header.endianTag   = ENDIAN_TAG;
+    header.numMeshes   = (uint32_t)model->meshes.size();
+    header.numTextures = (uint32_t)model->textures->size();
+    header.bounds      = model->bounds;
+    if (!getSourceStamp(sourceFile,header.sourceSize,header.sourceTime))
+      return false;
+
+    // write to a temporary file first, and only rename it once it's
+    // complete, so a crash never leaves a broken cache behind
+    const std::string tmpFile = cacheFile + ".tmp";
+    CacheWriter out;
+    out.file = fopen(tmpFile.c_str(),"wb");
+    if (!out.file) return false;
+
+    bool ok = out.write(&header,sizeof(header));
+
+    std::vector<MeshRecord> meshRecords(header.numMeshes);
+    for (size_t i=0;ok && i<meshRecords.size();i++) {
+      const TriangleMesh &mesh = *model->meshes[i];
+      MeshRecord &rec = meshRecords[i];
+      rec.numVertices      = mesh.vertex.size();
+      rec.numNormals       = mesh.normal.size();
+      rec.numTexcoords     = mesh.texcoord.size();
+      rec.numIndices       = mesh.index.size();
+      rec.bounds           = mesh.bounds;
+      rec.diffuse          = mesh.diffuse;
+      rec.diffuseTextureID = mesh.diffuseTextureID;
+      ok = out.writeArray(mesh.vertex,  rec.vertexOffset)
+        && out.writeArray(mesh.normal,  rec.normalOffset)
+        && out.writeArray(mesh.texcoord,rec.texcoordOffset)
+        && out.writeArray(mesh.index,   rec.indexOffset);
+    }
+
+    std::vector<std::string>   names(header.numTextures);
+    std::vector<TextureRecord> textureRecords(header.numTextures);
+    for (size_t i=0;i<names.size();i++) {
+      names[i] = model->textures->fileName((int)i);
+      textureRecords[i].nameLength = names[i].size();
+    }
+
+    // textures are dependencies, too: editing one has to invalidate
+    // the cache just like editing the material that references it
+    std::vector<std::string> dependencyNames = dependencies;
+    dependencyNames.insert(dependencyNames.end(),names.begin(),names.end());
+    header.numDependencies = (uint32_t)dependencyNames.size();
+    std::vector<DependencyRecord> dependencyRecords(header.numDependencies);
+    for (size_t i=0;i<dependencyNames.size();i++) {
+      DependencyRecord &rec = dependencyRecords[i];
+      rec.nameLength = dependencyNames[i].size();
+      getDependencyStamp(dependencyNames[i],rec.size,rec.time);
+    }
+
+    ok = ok && out.align();
+    header.meshTableOffset = out.offset;
+    ok = ok && out.write(meshRecords.data(),
+                         meshRecords.size()*sizeof(MeshRecord));
+    header.textureTableOffset = out.offset;
+    uint64_t nameOffset
+      = out.offset + textureRecords.size()*sizeof(TextureRecord);
+    for (auto &rec : textureRecords) {
+      rec.nameOffset = nameOffset;
+      nameOffset += rec.nameLength;
+    }
+    ok = ok && out.write(textureRecords.data(),
+                         textureRecords.size()*sizeof(TextureRecord));
+    for (auto &name : names)
+      ok = ok && out.write(name.data(),name.size());
+
+    ok = ok && out.align();
+    header.dependencyTableOffset = out.offset;
+    nameOffset
+      = out.offset + dependencyRecords.size()*sizeof(DependencyRecord);
+    for (auto &rec : dependencyRecords) {
+      rec.nameOffset = nameOffset;
+      nameOffset += rec.nameLength;
+    }
+    ok = ok && out.write(dependencyRecords.data(),
+                         dependencyRecords.size()*sizeof(DependencyRecord));
+    for (auto &name : dependencyNames)
+      ok = ok && out.write(name.data(),name.size());
+
+    header.fileSize = out.offset;
+    ok = ok
+      && fseek(out.file,0,SEEK_SET) == 0
+      && fwrite(&header,sizeof(header),1,out.file) == 1;
+    ok = (fclose(out.file) == 0) && ok;
+
+    std::error_code ec;
+    if (ok) std::filesystem::rename(tmpFile,cacheFile,ec);
+    if (!ok || ec) {
+      std::filesystem::remove(tmpFile,ec);
+      return false;
+    }
+    return true;
+  }
+
+  /*! whether [offset,offset+count*sizeof(T)) lies within the file and
+      is suitably aligned for T */
+  template<typename T>
+  static bool validRange(const MappedFile &file, uint64_t offset, uint64_t count)
+  {
+    return offset <= file.size
+      && count <= (file.size - offset) / sizeof(T)
+      && (offset % alignof(T)) == 0;
+  }
+
+  template<typename T>
+  static MeshArray<T> viewArray(const MappedFile &file,
+                                uint64_t offset, uint64_t count)
+  {
+    return MeshArray<T>::view((T *)(file.data + offset),(size_t)count);
+  }
+
+  Model *loadModelCache(const std::string &cacheFile,
+                        const std::string &sourceFile)
+  {
+    uint64_t sourceSize;
+    int64_t  sourceTime;
+    if (!getSourceStamp(sourceFile,sourceSize,sourceTime))
+      return nullptr;
+
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+    if (!file->open(cacheFile) || file->size < sizeof(FileHeader))
+      return nullptr;
+
+    const FileHeader &header = *(const FileHeader *)file->data;
+    if (memcmp(header.magic,MAGIC,sizeof(MAGIC)) != 0
+        || header.version    != VERSION
+        || header.endianTag  != ENDIAN_TAG
+        || header.fileSize   != file->size
+        || header.sourceSize != sourceSize
+        || header.sourceTime != sourceTime)
+      return nullptr;
+    if (!validRange<MeshRecord>(*file,header.meshTableOffset,header.numMeshes)
+        || !validRange<TextureRecord>(*file,header.textureTableOffset,
+                                      header.numTextures)
+        || !validRange<DependencyRecord>(*file,header.dependencyTableOffset,
+                                         header.numDependencies)) {
+      std::cout << GDT_TERMINAL_RED
+                << "#osc: corrupt model cache " << cacheFile
+                << ", ignoring it" << GDT_TERMINAL_DEFAULT << std::endl;
+      return nullptr;
+    }
+
+    // out of date if any of the other files the model came from changed
+    const DependencyRecord *dependencyRecords
+      = (const DependencyRecord *)(file->data + header.dependencyTableOffset);
+    for (uint32_t i=0;i<header.numDependencies;i++) {
+      const DependencyRecord &rec = dependencyRecords[i];
+      if (!validRange<char>(*file,rec.nameOffset,rec.nameLength))
+        return nullptr;
+      uint64_t size;
+      int64_t  time;
+      getDependencyStamp(std::string(file->data + rec.nameOffset,
+                                     rec.nameLength),size,time);
+      if (size != rec.size || time != rec.time)
+        return nullptr;
+    }
+
+    std::unique_ptr<Model> model(new Model);
+    model->bounds = header.bounds;
+    // the arrays are views into the mapping; only the mesh objects
+    // themselves need memory, all of which comes from one block
+    model->arena
+      = std::make_shared<MeshArena>(std::max<size_t>(header.numMeshes,1)
+                                    * sizeof(TriangleMesh));
+    model->meshes.reserve(header.numMeshes);
+
+    const TextureRecord *textureRecords
+      = (const TextureRecord *)(file->data + header.textureTableOffset);
+    for (uint32_t i=0;i<header.numTextures;i++) {
+      const TextureRecord &rec = textureRecords[i];
+      if (!validRange<char>(*file,rec.nameOffset,rec.nameLength))
+        return nullptr;
+      model->textures->addTexture(std::string(file->data + rec.nameOffset,
+                                              rec.nameLength));
+    }
+
+    const MeshRecord *meshRecords
+      = (const MeshRecord *)(file->data + header.meshTableOffset);
+    for (uint32_t i=0;i<header.numMeshes;i++) {
+      const MeshRecord &rec = meshRecords[i];
+      if (!validRange<vec3f>(*file,rec.vertexOffset,  rec.numVertices)
+          || !validRange<vec3f>(*file,rec.normalOffset,  rec.numNormals)
+          || !validRange<vec2f>(*file,rec.texcoordOffset,rec.numTexcoords)
+          || !validRange<vec3i>(*file,rec.indexOffset,   rec.numIndices)
+          || rec.diffuseTextureID >= (int32_t)header.numTextures)
+        return nullptr;
+
+      TriangleMesh *mesh = model->arena->newMesh();
+      mesh->vertex   = viewArray<vec3f>(*file,rec.vertexOffset,  rec.numVertices);
+      mesh->normal   = viewArray<vec3f>(*file,rec.normalOffset,  rec.numNormals);
+      mesh->texcoord = viewArray<vec2f>(*file,rec.texcoordOffset,rec.numTexcoords);
+      mesh->index    = viewArray<vec3i>(*file,rec.indexOffset,   rec.numIndices);
+      mesh->bounds           = rec.bounds;
+      mesh->diffuse          = rec.diffuse;
+      mesh->diffuseTextureID = rec.diffuseTextureID;
+      model->meshes.push_back(mesh);
+    }
+
+    model->storage = file;
+    return model.release();
+  }
+
+} // ::osc
@@ -0,0 +1,520 @@
+// ======================================================================== //
+// Copyright 2018-2024 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "ObjParser.h"
+#include "MappedFile.h"
+#include "Triangulate.h"
+//std
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <map>
+#include <thread>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+/*! \namespace osc - Optix Siggraph Course */
+namespace osc {
+
+  /*! chunks are sized for a few chunks per thread, within these bounds */
+  static const size_t MIN_CHUNK_SIZE = size_t(64) << 10;
+  static const size_t MAX_CHUNK_SIZE = size_t(16) << 20;
+
+  /*! which of a corner's indices are relative to the end of the chunk
+      that parsed it, rather than absolute */
+  enum { RELATIVE_VERTEX = 1, RELATIVE_NORMAL = 2, RELATIVE_TEXCOORD = 4 };
+
+  /*! a face of more than three corners, which parseChunk fans until
+      all vertices are known and it can be triangulated properly */
+  struct ObjPolygon {
+    /*! the chunk's first of the face's triangles */
+    size_t firstFace;
+    int    numCorners;
+  };
+
+  /*! a 'g' or 'o' statement, which starts a new shape */
+  struct GroupMarker {
+    /*! the chunk's first triangle after the statement */
+    size_t      firstFace;
+    std::string name;
+  };
+
+  /*! everything parsed from one chunk of the file. Until stitching,
+      relative indices are relative to the chunk's own first element,
+      so they may be negative (ie, refer to earlier chunks) */
+  struct ObjChunk {
+    const char *begin, *end;
+
+    std::vector<float>            vertices, normals, texcoords;
+    /*! three corners per triangle, and their RELATIVE_* flags */
+    std::vector<tinyobj::index_t> corners;
+    std::vector<uint8_t>          relative;
+    /*! per triangle, index into materialNames, or -1 for whatever
+        material was active at the start of the chunk */
+    std::vector<int>              faceMaterials;
+    std::vector<ObjPolygon>       polygons;
+    std::vector<std::string>      materialNames;
+    /*! the last 'usemtl' of the chunk, as above */
+    int                           lastMaterial { -1 };
+    std::vector<GroupMarker>      groups;
+    std::vector<std::string>      mtlLibs;
+    /*! the chunk's first parse error, if any */
+    std::string                   err;
+
+    /*! set up for stitching: the offsets of the chunk's elements in
+        the stitched arrays, the IDs of materialNames, and the material
+        active at the start of the chunk */
+    size_t                        vertexBase, normalBase, texcoordBase;
+    size_t                        faceBase;
+    std::vector<int>              materialIDs;
+    int                           startMaterial;
+  };
+
+  static inline bool isSpace(char c) { return c == ' ' || c == '\t'; }
+
+  static inline const char *skipSpace(const char *p, const char *end)
+  {
+    while (p < end && isSpace(*p)) p++;
+    return p;
+  }
+
+  /*! whether the line at p starts with the given keyword, followed by
+      whitespace or the end of the line; advances p past it if so */
+  static inline bool keyword(const char *&p, const char *end,
+                             const char *word, size_t length)
+  {
+    if (size_t(end-p) < length || memcmp(p,word,length) != 0
+        || (p+length < end && !isSpace(p[length])))
+      return false;
+    p += length;
+    return true;
+  }
+
+  /*! the rest of the line, without leading and trailing whitespace */
+  static std::string restOfLine(const char *p, const char *end)
+  {
+    p = skipSpace(p,end);
+    while (end > p && isSpace(end[-1])) end--;
+    return std::string(p,end);
+  }
+
+  static inline bool parseFloat(const char *&p, const char *end, float &f)
+  {
+    p = skipSpace(p,end);
+    if (p < end && *p == '+') p++;
+    const std::from_chars_result result = std::from_chars(p,end,f);
+    if (result.ec != std::errc()) return false;
+    p = result.ptr;
+    return true;
+  }
+
+  /*! parse up to N floats into the array; missing ones (eg, a 'vt'
+      without v) default to zero. Returns false if there's not even
+      one */
+  template<int N>
+  static bool parseFloats(const char *p, const char *end,
+                          std::vector<float> &array)
+  {
+    float f[N] = {};
+    for (int i=0;i<N;i++)
+      if (!parseFloat(p,end,f[i]) && i == 0) return false;
+    array.insert(array.end(),f,f+N);
+    return true;
+  }
+
+  static inline bool parseInt(const char *&p, const char *end, int &i)
+  {
+    const std::from_chars_result result = std::from_chars(p,end,i);
+    if (result.ec != std::errc()) return false;
+    p = result.ptr;
+    return true;
+  }
+
+  /*! OBJ indices are 1-based if positive, and relative to the number
+      of elements so far if negative; zero is invalid */
+  static inline bool fixIndex(int objIndex, size_t numSoFar, int flag,
+                              int &index, uint8_t &relative)
+  {
+    if (objIndex > 0) {
+      index = objIndex-1;
+    } else if (objIndex < 0) {
+      index = int(numSoFar) + objIndex;
+      relative |= flag;
+    } else
+      return false;
+    return true;
+  }
+
+  /*! parse one 'v', 'v/t', 'v//n' or 'v/t/n' face corner */
+  static bool parseCorner(const char *&p, const char *end,
+                          const ObjChunk &chunk,
+                          tinyobj::index_t &idx, uint8_t &relative)
+  {
+    idx = { -1, -1, -1 };
+    relative = 0;
+    int i;
+    if (!parseInt(p,end,i)
+        || !fixIndex(i,chunk.vertices.size()/3,RELATIVE_VERTEX,
+                     idx.vertex_index,relative))
+      return false;
+    if (p == end || *p != '/') return true;
+    p++;
+    if (p < end && *p != '/') {
+      if (!parseInt(p,end,i)
+          || !fixIndex(i,chunk.texcoords.size()/2,RELATIVE_TEXCOORD,
+                       idx.texcoord_index,relative))
+        return false;
+    }
+    if (p == end || *p != '/') return true;
+    p++;
+    return parseInt(p,end,i)
+      && fixIndex(i,chunk.normals.size()/3,RELATIVE_NORMAL,
+                  idx.normal_index,relative);
+  }
+
+  /*! parse all lines of the chunk; stops at the first error */
+  static void parseChunk(ObjChunk &chunk, const char *fileBegin)
+  {
+    std::vector<tinyobj::index_t> polygon;
+    std::vector<uint8_t>          polygonRelative;
+    int material = -1;
+
+    for (const char *line=chunk.begin;line<chunk.end;) {
+      const char *eol = (const char *)memchr(line,'\n',chunk.end-line);
+      if (!eol) eol = chunk.end;
+      const char *next = eol+1;
+      if (eol > line && eol[-1] == '\r') eol--;
+
+      const char *p = skipSpace(line,eol);
+      bool ok = true;
+      if (p == eol || *p == '#') {
+        // empty line or comment
+      } else if (keyword(p,eol,"v",1)) {
+        ok = parseFloats<3>(p,eol,chunk.vertices);
+      } else if (keyword(p,eol,"vn",2)) {
+        ok = parseFloats<3>(p,eol,chunk.normals);
+      } else if (keyword(p,eol,"vt",2)) {
+        ok = parseFloats<2>(p,eol,chunk.texcoords);
+      } else if (keyword(p,eol,"f",1)) {
+        polygon.clear();
+        polygonRelative.clear();
+        for (p=skipSpace(p,eol);ok && p<eol;p=skipSpace(p,eol)) {
+          tinyobj::index_t idx;
+          uint8_t relative;
+          ok = parseCorner(p,eol,chunk,idx,relative)
+            && (p == eol || isSpace(*p));
+          polygon.push_back(idx);
+          polygonRelative.push_back(relative);
+        }
+        ok = ok && polygon.size() >= 3;
+        if (ok && polygon.size() > 3)
+          chunk.polygons.push_back({chunk.faceMaterials.size(),
+                                    int(polygon.size())});
+        for (size_t i=1;ok && i+1<polygon.size();i++) {
+          const size_t fan[3] = { 0, i, i+1 };
+          for (size_t c : fan) {
+            chunk.corners.push_back(polygon[c]);
+            chunk.relative.push_back(polygonRelative[c]);
+          }
+          chunk.faceMaterials.push_back(material);
+        }
+      } else if (keyword(p,eol,"usemtl",6)) {
+        const std::string name = restOfLine(p,eol);
+        auto it = std::find(chunk.materialNames.begin(),
+                            chunk.materialNames.end(),name);
+        material = int(it - chunk.materialNames.begin());
+        if (it == chunk.materialNames.end())
+          chunk.materialNames.push_back(name);
+        chunk.lastMaterial = material;
+      } else if (keyword(p,eol,"mtllib",6)) {
+        chunk.mtlLibs.push_back(restOfLine(p,eol));
+      } else if (keyword(p,eol,"g",1)) {
+        // multiple group names get joined with single spaces
+        std::string name;
+        for (p=skipSpace(p,eol);p<eol;p=skipSpace(p,eol)) {
+          const char *word = p;
+          while (p < eol && !isSpace(*p)) p++;
+          if (!name.empty()) name += ' ';
+          name.append(word,p);
+        }
+        chunk.groups.push_back({chunk.faceMaterials.size(),name});
+      } else if (keyword(p,eol,"o",1)) {
+        chunk.groups.push_back({chunk.faceMaterials.size(),
+                                restOfLine(p,eol)});
+      }
+      // anything else (lines, points, smoothing groups, tags, ...)
+      // gets ignored
+
+      if (!ok) {
+        chunk.err = "could not parse line at byte offset "
+          + std::to_string(line-fileBegin) + " : "
+          + std::string(line,eol);
+        return;
+      }
+      line = next;
+    }
+  }
+
+  /*! split the file into chunks at line boundaries */
+  static std::vector<ObjChunk> splitIntoChunks(const char *begin,
+                                               const char *end)
+  {
+    const size_t numThreads
+      = std::max(1u,std::thread::hardware_concurrency());
+    const size_t chunkSize
+      = std::clamp(size_t(end-begin)/(4*numThreads),
+                   MIN_CHUNK_SIZE,MAX_CHUNK_SIZE);
+
+    std::vector<ObjChunk> chunks;
+    while (begin < end) {
+      const char *chunkEnd = begin + std::min(chunkSize,size_t(end-begin));
+      const char *eol = (const char *)memchr(chunkEnd-1,'\n',end-(chunkEnd-1));
+      chunkEnd = eol ? eol+1 : end;
+      chunks.emplace_back();
+      chunks.back().begin = begin;
+      chunks.back().end   = chunkEnd;
+      begin = chunkEnd;
+    }
+    return chunks;
+  }
+
+  /*! read all materials of all 'mtllib' statements, in order. Like
+      tinyobj, each statement's file names are tried in turn until
+      one can be read; all names tried go into mtlFiles, if given */
+  static void loadMaterials(const std::vector<ObjChunk> &chunks,
+                            const std::string &mtlDir,
+                            std::vector<tinyobj::material_t> &materials,
+                            std::map<std::string,int> &materialMap,
+                            std::vector<std::string> *mtlFiles)
+  {
+    tinyobj::MaterialFileReader reader(mtlDir);
+    for (const ObjChunk &chunk : chunks)
+      for (const std::string &mtlLib : chunk.mtlLibs) {
+        const char *p = mtlLib.data(), *end = p + mtlLib.size();
+        for (p=skipSpace(p,end);p<end;p=skipSpace(p,end)) {
+          const char *name = p;
+          while (p < end && !isSpace(*p)) p++;
+          std::string warn, err;
+          if (mtlFiles)
+            // that's where tinyobj's reader looks for it
+            mtlFiles->push_back(mtlDir + std::string(name,p));
+          if (reader(std::string(name,p),&materials,&materialMap,&warn,&err))
+            break;
+        }
+      }
+  }
+
+  /*! re-triangulate the chunk's faces of more than three corners,
+      whose stitched vertices are in place by now: convex faces stay
+      fanned, concave ones get ear-clipped, like tinyobj does */
+  static void triangulatePolygons(const ObjChunk &chunk,
+                                  const std::vector<size_t> &shapeBegin,
+                                  const std::vector<tinyobj::real_t> &vertices,
+                                  std::vector<tinyobj::shape_t> &shapes)
+  {
+    if (chunk.polygons.empty()) return;
+
+    // recover each face's corners from its fan (0,i,i+1): the first
+    // triangle has corners 0, 1 and 2, each further one adds one more
+    std::vector<tinyobj::index_t *> faceTriangles;
+    std::vector<tinyobj::index_t>   corners;
+    std::vector<int>                faceVertexCounts, faceVertexIndices;
+    for (const ObjPolygon &polygon : chunk.polygons) {
+      const size_t faceID = chunk.faceBase + polygon.firstFace;
+      const size_t shapeID
+        = std::upper_bound(shapeBegin.begin(),shapeBegin.end(),faceID)
+        - shapeBegin.begin() - 1;
+      tinyobj::index_t *fan
+        = &shapes[shapeID].mesh.indices[3*(faceID-shapeBegin[shapeID])];
+      faceTriangles.push_back(fan);
+      faceVertexCounts.push_back(polygon.numCorners);
+      for (int i=0;i<polygon.numCorners;i++)
+        corners.push_back(i < 3 ? fan[i] : fan[3*(i-2)+2]);
+    }
+    for (const tinyobj::index_t &corner : corners)
+      faceVertexIndices.push_back(corner.vertex_index);
+
+    PolygonMesh mesh;
+    mesh.faceVertexCounts  = faceVertexCounts.data();
+    mesh.numFaces          = faceVertexCounts.size();
+    mesh.faceVertexIndices = faceVertexIndices.data();
+    mesh.numCorners        = faceVertexIndices.size();
+    mesh.points            = (const vec3f *)vertices.data();
+    mesh.numPoints         = vertices.size()/3;
+    // all indices got validated during stitching, so no face gets
+    // dropped, and each one's n-2 triangles replace its fan in place
+    std::vector<vec3i> triangles(maxTriangles(mesh));
+    triangulate(mesh,triangles.data(),nullptr,TRIANGULATE_CORNERS);
+
+    size_t triangleID = 0;
+    for (size_t f=0;f<faceTriangles.size();f++)
+      for (int i=0;i<faceVertexCounts[f]-2;i++,triangleID++)
+        for (int k=0;k<3;k++)
+          faceTriangles[f][3*i+k] = corners[triangles[triangleID][k]];
+  }
+
+  bool parseOBJ(const std::string &objFile,
+                const std::string &mtlDir,
+                tinyobj::attrib_t &attributes,
+                std::vector<tinyobj::shape_t> &shapes,
+                std::vector<tinyobj::material_t> &materials,
+                std::string &err,
+                std::vector<std::string> *mtlFiles)
+  {
+    attributes = tinyobj::attrib_t();
+    shapes.clear();
+    materials.clear();
+
+    MappedFile file;
+    if (!file.open(objFile)) {
+      err = "could not open " + objFile;
+      return false;
+    }
+
+    std::vector<ObjChunk> chunks
+      = splitIntoChunks(file.data,file.data+file.size);
+    const size_t numChunks = chunks.size();
+    tbb::parallel_for(size_t(0),numChunks,[&](size_t c) {
+        parseChunk(chunks[c],file.data);
+      });
+    for (const ObjChunk &chunk : chunks)
+      if (!chunk.err.empty()) {
+        err = chunk.err;
+        return false;
+      }
+
+    std::map<std::string,int> materialMap;
+    loadMaterials(chunks,mtlDir,materials,materialMap,mtlFiles);
+
+    // prefix sums of the chunks' element counts give each chunk's
+    // offsets into the stitched arrays; the material active at the
+    // start of each chunk is the last one set in any earlier chunk
+    size_t numVertices = 0, numNormals = 0, numTexcoords = 0, numFaces = 0;
+    int material = -1;
+    for (ObjChunk &chunk : chunks) {
+      chunk.vertexBase   = numVertices;
+      chunk.normalBase   = numNormals;
+      chunk.texcoordBase = numTexcoords;
+      chunk.faceBase     = numFaces;
+      numVertices  += chunk.vertices.size()/3;
+      numNormals   += chunk.normals.size()/3;
+      numTexcoords += chunk.texcoords.size()/2;
+      numFaces     += chunk.faceMaterials.size();
+
+      for (const std::string &name : chunk.materialNames) {
+        auto it = materialMap.find(name);
+        chunk.materialIDs.push_back(it == materialMap.end() ? -1 : it->second);
+      }
+      chunk.startMaterial = material;
+      if (chunk.lastMaterial >= 0)
+        material = chunk.materialIDs[chunk.lastMaterial];
+    }
+
+    // shapes are the non-empty runs of faces between 'g'/'o'
+    // statements, named after the statement that started them
+    std::vector<size_t> shapeBegin;
+    {
+      size_t begin = 0;
+      std::string name;
+      auto addShape = [&](size_t end) {
+        if (end == begin) return;
+        shapes.emplace_back();
+        shapes.back().name = name;
+        shapeBegin.push_back(begin);
+      };
+      for (const ObjChunk &chunk : chunks)
+        for (const GroupMarker &group : chunk.groups) {
+          const size_t first = chunk.faceBase+group.firstFace;
+          addShape(first);
+          begin = first;
+          name  = group.name;
+        }
+      addShape(numFaces);
+      shapeBegin.push_back(numFaces);
+    }
+    tbb::parallel_for(size_t(0),shapes.size(),[&](size_t s) {
+        tinyobj::mesh_t &mesh = shapes[s].mesh;
+        const size_t shapeFaces = shapeBegin[s+1]-shapeBegin[s];
+        mesh.indices.resize(3*shapeFaces);
+        mesh.num_face_vertices.assign(shapeFaces,3);
+        mesh.material_ids.resize(shapeFaces);
+        mesh.smoothing_group_ids.assign(shapeFaces,0);
+      });
+
+    attributes.vertices.resize(3*numVertices);
+    attributes.normals.resize(3*numNormals);
+    attributes.texcoords.resize(2*numTexcoords);
+
+    // stitch: copy each chunk's elements to its offsets, and its faces
+    // into the shapes they belong to, making all indices absolute
+    tbb::parallel_for(size_t(0),numChunks,[&](size_t c) {
+        ObjChunk &chunk = chunks[c];
+        std::copy(chunk.vertices.begin(),chunk.vertices.end(),
+                  attributes.vertices.begin()+3*chunk.vertexBase);
+        std::copy(chunk.normals.begin(),chunk.normals.end(),
+                  attributes.normals.begin()+3*chunk.normalBase);
+        std::copy(chunk.texcoords.begin(),chunk.texcoords.end(),
+                  attributes.texcoords.begin()+2*chunk.texcoordBase);
+
+        const size_t numChunkFaces = chunk.faceMaterials.size();
+        if (numChunkFaces == 0) return;
+        size_t shapeID
+          = std::upper_bound(shapeBegin.begin(),shapeBegin.end(),chunk.faceBase)
+          - shapeBegin.begin() - 1;
+        for (size_t i=0;i<numChunkFaces;i++) {
+          const size_t faceID = chunk.faceBase+i;
+          while (faceID >= shapeBegin[shapeID+1]) shapeID++;
+          tinyobj::mesh_t &mesh = shapes[shapeID].mesh;
+          const size_t shapeFace = faceID - shapeBegin[shapeID];
+
+          const int slot = chunk.faceMaterials[i];
+          mesh.material_ids[shapeFace]
+            = slot < 0 ? chunk.startMaterial : chunk.materialIDs[slot];
+
+          for (int k=0;k<3;k++) {
+            tinyobj::index_t idx = chunk.corners[3*i+k];
+            const uint8_t relative = chunk.relative[3*i+k];
+            if (relative & RELATIVE_VERTEX)   idx.vertex_index   += int(chunk.vertexBase);
+            if (relative & RELATIVE_NORMAL)   idx.normal_index   += int(chunk.normalBase);
+            if (relative & RELATIVE_TEXCOORD) idx.texcoord_index += int(chunk.texcoordBase);
+            // -1 means 'none' for normals and texcoords, but a relative
+            // index that ends up negative points before the file start
+            const bool badNormal
+              = idx.normal_index >= int(numNormals)
+              || ((relative & RELATIVE_NORMAL) && idx.normal_index < 0);
+            const bool badTexcoord
+              = idx.texcoord_index >= int(numTexcoords)
+              || ((relative & RELATIVE_TEXCOORD) && idx.texcoord_index < 0);
+            if (idx.vertex_index < 0 || size_t(idx.vertex_index) >= numVertices
+                || badNormal || badTexcoord)
+              chunk.err = "face references a vertex, normal or texcoord that doesn't exist";
+            mesh.indices[3*shapeFace+k] = idx;
+          }
+        }
+      });
+    for (const ObjChunk &chunk : chunks)
+      if (!chunk.err.empty()) {
+        err = chunk.err;
+        return false;
+      }
+
+    tbb::parallel_for(size_t(0),numChunks,[&](size_t c) {
+        triangulatePolygons(chunks[c],shapeBegin,attributes.vertices,shapes);
+      });
+    return true;
+  }
+
+} // ::osc
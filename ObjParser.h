@@ -0,0 +1,57 @@
+// ======================================================================== //
+// Copyright 2018-2024 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "3rdParty/tiny_obj_loader.h"
+//std
+#include <string>
+#include <vector>
+
+/*! \namespace osc - Optix Siggraph Course */
+namespace osc {
+
+  /*! parse the given OBJ file into the same structures that
+      tinyobj::LoadObj (with triangulation) produces, so it can
+      replace it.
+
+      The file gets memory-mapped and cut into chunks at line
+      boundaries; the chunks get parsed in parallel, each into its own
+      attribute and face arrays, which then get stitched together with
+      prefix sums over the chunks' element counts. Relative (negative)
+      indices and 'usemtl' / 'g' / 'o' statements that affect faces in
+      later chunks get resolved during stitching. Materials come from
+      the 'mtllib' files, looked up in mtlDir.
+
+      Faces with more than three corners get triangulated once all
+      vertices are known: convex ones get fanned, concave ones
+      ear-clipped (see triangulate()). Lines, points, smoothing groups
+      and tags are ignored. An empty file is a valid, empty model.
+      Returns false (with a message in err) if the file can't be read
+      or references an element that doesn't exist.
+
+      mtlFiles, if given, receives every material library file that
+      got looked at, whether it could be read or not (eg, for telling
+      when a cache of the model is out of date) */
+  bool parseOBJ(const std::string &objFile,
+                const std::string &mtlDir,
+                tinyobj::attrib_t &attributes,
+                std::vector<tinyobj::shape_t> &shapes,
+                std::vector<tinyobj::material_t> &materials,
+                std::string &err,
+                std::vector<std::string> *mtlFiles = nullptr);
+
+} // ::osc
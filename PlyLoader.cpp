@@ -0,0 +1,408 @@
+// ======================================================================== //
+// Copyright 2018-2024 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "Model.h"
+#include "MappedFile.h"
+//std
+#include <atomic>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+/*! \namespace osc - Optix Siggraph Course */
+namespace osc {
+
+  enum PlyType {
+    PLY_INVALID,
+    PLY_INT8,  PLY_UINT8,
+    PLY_INT16, PLY_UINT16,
+    PLY_INT32, PLY_UINT32,
+    PLY_FLOAT32, PLY_FLOAT64
+  };
+
+  static PlyType plyType(const std::string &name)
+  {
+    if (name == "char"   || name == "int8")    return PLY_INT8;
+    if (name == "uchar"  || name == "uint8")   return PLY_UINT8;
+    if (name == "short"  || name == "int16")   return PLY_INT16;
+    if (name == "ushort" || name == "uint16")  return PLY_UINT16;
+    if (name == "int"    || name == "int32")   return PLY_INT32;
+    if (name == "uint"   || name == "uint32")  return PLY_UINT32;
+    if (name == "float"  || name == "float32") return PLY_FLOAT32;
+    if (name == "double" || name == "float64") return PLY_FLOAT64;
+    return PLY_INVALID;
+  }
+
+  static size_t plyTypeSize(PlyType type)
+  {
+    switch (type) {
+    case PLY_INT8:    case PLY_UINT8:  return 1;
+    case PLY_INT16:   case PLY_UINT16: return 2;
+    case PLY_INT32:   case PLY_UINT32: case PLY_FLOAT32: return 4;
+    case PLY_FLOAT64: return 8;
+    default: return 0;
+    }
+  }
+
+  /*! read a (possibly unaligned) little-endian value of the given
+      type, converted to T */
+  template<typename T>
+  static inline T readPly(const char *p, PlyType type)
+  {
+    switch (type) {
+    case PLY_INT8:    return T(*(const int8_t  *)p);
+    case PLY_UINT8:   return T(*(const uint8_t *)p);
+    case PLY_INT16:   { int16_t  v; memcpy(&v,p,2); return T(v); }
+    case PLY_UINT16:  { uint16_t v; memcpy(&v,p,2); return T(v); }
+    case PLY_INT32:   { int32_t  v; memcpy(&v,p,4); return T(v); }
+    case PLY_UINT32:  { uint32_t v; memcpy(&v,p,4); return T(v); }
+    case PLY_FLOAT32: { float    v; memcpy(&v,p,4); return T(v); }
+    case PLY_FLOAT64: { double   v; memcpy(&v,p,8); return T(v); }
+    default: return T(0);
+    }
+  }
+
+  struct PlyProperty {
+    std::string name;
+    PlyType     type;
+    /*! for list properties: the type of the element count (type is
+        that of the list's entries) */
+    bool        isList    { false };
+    PlyType     countType { PLY_INVALID };
+    /*! byte offset within a row; only valid up to the first list */
+    size_t      offset    { 0 };
+  };
+
+  struct PlyElement {
+    std::string              name;
+    size_t                   count { 0 };
+    std::vector<PlyProperty> properties;
+    /*! whether all rows have the same size, ie, there are no lists */
+    bool                     fixedSize { true };
+    /*! size of a row, if fixedSize; otherwise the size of the
+        properties before the first list */
+    size_t                   rowSize { 0 };
+    /*! where the element's rows start and end in the file */
+    const char              *begin { nullptr };
+    const char              *end   { nullptr };
+
+    const PlyProperty *find(const std::string &propertyName) const
+    {
+      for (auto &prop : properties)
+        if (prop.name == propertyName) return &prop;
+      return nullptr;
+    }
+  };
+
+  /*! parse the header at the start of the file into its elements;
+      returns the start of the binary data */
+  static const char *parsePlyHeader(const MappedFile &file,
+                                    std::vector<PlyElement> &elements,
+                                    const std::string &plyFile)
+  {
+    const char *end = file.data + file.size;
+    const char *headerEnd = nullptr;
+    static const char END_HEADER[] = "end_header";
+    for (const char *p=file.data;p<end;) {
+      const char *eol = (const char *)memchr(p,'\n',end-p);
+      if (!eol) break;
+      if (size_t(eol-p) >= sizeof(END_HEADER)-1
+          && memcmp(p,END_HEADER,sizeof(END_HEADER)-1) == 0) {
+        headerEnd = eol+1;
+        break;
+      }
+      p = eol+1;
+    }
+    if (!headerEnd || file.size < 4 || memcmp(file.data,"ply",3) != 0)
+      throw std::runtime_error("not a PLY file: "+plyFile);
+
+    std::istringstream header(std::string((const char *)file.data,headerEnd));
+    std::string line;
+    std::getline(header,line);
+    while (std::getline(header,line)) {
+      std::istringstream tokens(line);
+      std::string keyword;
+      tokens >> keyword;
+      if (keyword == "format") {
+        std::string format;
+        tokens >> format;
+        if (format != "binary_little_endian")
+          throw std::runtime_error("PLY format '"+format+"' not supported"
+                                   " (only binary_little_endian is): "+plyFile);
+      } else if (keyword == "element") {
+        elements.emplace_back();
+        tokens >> elements.back().name >> elements.back().count;
+      } else if (keyword == "property") {
+        if (elements.empty())
+          throw std::runtime_error("PLY property outside of element: "+plyFile);
+        PlyElement &element = elements.back();
+        PlyProperty prop;
+        std::string typeName;
+        tokens >> typeName;
+        if (typeName == "list") {
+          std::string countTypeName;
+          tokens >> countTypeName >> typeName;
+          prop.isList    = true;
+          prop.countType = plyType(countTypeName);
+        }
+        tokens >> prop.name;
+        prop.type = plyType(typeName);
+        if (prop.type == PLY_INVALID
+            || (prop.isList && prop.countType == PLY_INVALID))
+          throw std::runtime_error("invalid PLY property '"+line+"': "+plyFile);
+        if (element.fixedSize) {
+          prop.offset = element.rowSize;
+          if (prop.isList)
+            element.fixedSize = false;
+          else
+            element.rowSize += plyTypeSize(prop.type);
+        }
+        element.properties.push_back(prop);
+      }
+      // comment, obj_info, and end_header need no handling
+    }
+    return headerEnd;
+  }
+
+  /*! size of the variable-size row at p, or 0 if it doesn't fit */
+  static size_t plyRowSize(const PlyElement &element,
+                           const char *p, const char *end)
+  {
+    size_t size = 0;
+    for (auto &prop : element.properties) {
+      if (!prop.isList) {
+        size += plyTypeSize(prop.type);
+        continue;
+      }
+      const size_t countSize = plyTypeSize(prop.countType);
+      if (size_t(end-p) < size+countSize) return 0;
+      const int64_t count = readPly<int64_t>(p+size,prop.countType);
+      if (count < 0) return 0;
+      size += countSize + size_t(count)*plyTypeSize(prop.type);
+    }
+    return size_t(end-p) < size ? 0 : size;
+  }
+
+  /*! find where each element's rows start and end */
+  static void locatePlyElements(std::vector<PlyElement> &elements,
+                                const char *p, const char *end,
+                                const std::string &plyFile)
+  {
+    for (PlyElement &element : elements) {
+      element.begin = p;
+      if (element.fixedSize) {
+        if (element.rowSize && element.count > size_t(end-p) / element.rowSize)
+          throw std::runtime_error("truncated PLY file: "+plyFile);
+        p += element.count * element.rowSize;
+      } else {
+        for (size_t i=0;i<element.count;i++) {
+          const size_t rowSize = plyRowSize(element,p,end);
+          if (!rowSize)
+            throw std::runtime_error("truncated PLY file: "+plyFile);
+          p += rowSize;
+        }
+      }
+      element.end = p;
+    }
+  }
+
+  /*! copy the vertex element's positions, and normals and texture
+      coordinates if present, converting to float as required */
+  static void readPlyVertices(const PlyElement &element, TriangleMesh &mesh,
+                              const std::string &plyFile)
+  {
+    auto findAny = [&](std::initializer_list<const char *> names) {
+      for (const char *name : names)
+        if (const PlyProperty *prop = element.find(name)) return prop;
+      return (const PlyProperty *)nullptr;
+    };
+    const PlyProperty *x = element.find("x");
+    const PlyProperty *y = element.find("y");
+    const PlyProperty *z = element.find("z");
+    const PlyProperty *nx = element.find("nx");
+    const PlyProperty *ny = element.find("ny");
+    const PlyProperty *nz = element.find("nz");
+    const PlyProperty *u = findAny({"u","s","texture_u","texture_s"});
+    const PlyProperty *v = findAny({"v","t","texture_v","texture_t"});
+    if (!element.fixedSize || !x || !y || !z)
+      throw std::runtime_error("PLY vertices need x/y/z and no lists: "+plyFile);
+    const bool hasNormals   = nx && ny && nz;
+    const bool hasTexcoords = u && v;
+
+    const size_t numVertices = element.count;
+    const size_t rowSize     = element.rowSize;
+    mesh.vertex.resize(numVertices);
+    if (hasNormals)   mesh.normal.resize(numVertices);
+    if (hasTexcoords) mesh.texcoord.resize(numVertices);
+
+    // the common case of nothing but float x/y/z is a straight copy
+    if (rowSize == sizeof(vec3f) && x->offset == 0 && y->offset == 4
+        && z->offset == 8 && x->type == PLY_FLOAT32
+        && y->type == PLY_FLOAT32 && z->type == PLY_FLOAT32) {
+      memcpy((void *)mesh.vertex.data(),element.begin,numVertices*sizeof(vec3f));
+      return;
+    }
+
+    vec3f *vertex   = mesh.vertex.data();
+    vec3f *normal   = mesh.normal.data();
+    vec2f *texcoord = mesh.texcoord.data();
+    tbb::parallel_for(tbb::blocked_range<size_t>(0,numVertices,4096),
+                      [&](const tbb::blocked_range<size_t> &range) {
+      for (size_t i=range.begin();i<range.end();i++) {
+        const char *row = element.begin + i*rowSize;
+        vertex[i] = vec3f(readPly<float>(row+x->offset,x->type),
+                          readPly<float>(row+y->offset,y->type),
+                          readPly<float>(row+z->offset,z->type));
+        if (hasNormals)
+          normal[i] = vec3f(readPly<float>(row+nx->offset,nx->type),
+                            readPly<float>(row+ny->offset,ny->type),
+                            readPly<float>(row+nz->offset,nz->type));
+        if (hasTexcoords)
+          texcoord[i] = vec2f(readPly<float>(row+u->offset,u->type),
+                              readPly<float>(row+v->offset,v->type));
+      }
+    });
+  }
+
+  /*! read the face element's vertex index lists, fan-triangulating
+      polygons. Meshes of nothing but triangles - where all rows have
+      the same size - get read in parallel */
+  static void readPlyFaces(const PlyElement &element, TriangleMesh &mesh,
+                           const std::string &plyFile)
+  {
+    const PlyProperty *indices = element.find("vertex_indices");
+    if (!indices) indices = element.find("vertex_index");
+    if (!indices || !indices->isList)
+      throw std::runtime_error("PLY faces need a vertex_indices list: "+plyFile);
+    const int numVertices = (int)mesh.vertex.size();
+    const size_t numFaces = element.count;
+
+    size_t listOffset = 0, triangleRowSize = 0;
+    for (auto &prop : element.properties) {
+      if (&prop == indices) {
+        listOffset = triangleRowSize;
+        triangleRowSize += plyTypeSize(prop.countType) + 3*plyTypeSize(prop.type);
+      } else if (prop.isList) {
+        triangleRowSize = 0;
+        break;
+      } else
+        triangleRowSize += plyTypeSize(prop.type);
+    }
+    const size_t countSize = plyTypeSize(indices->countType);
+    const size_t indexSize = plyTypeSize(indices->type);
+
+    if (triangleRowSize
+        && numFaces*triangleRowSize == size_t(element.end-element.begin)) {
+      std::atomic<bool> allTriangles { true }, validIndices { true };
+      mesh.index.resize(numFaces);
+      vec3i *index = mesh.index.data();
+      tbb::parallel_for(tbb::blocked_range<size_t>(0,numFaces,4096),
+                        [&](const tbb::blocked_range<size_t> &range) {
+        bool triangles = true, valid = true;
+        for (size_t i=range.begin();i<range.end();i++) {
+          const char *list = element.begin + i*triangleRowSize + listOffset;
+          triangles &= (readPly<int64_t>(list,indices->countType) == 3);
+          const char *idx = list + countSize;
+          index[i] = vec3i(readPly<int>(idx,            indices->type),
+                           readPly<int>(idx+indexSize,  indices->type),
+                           readPly<int>(idx+2*indexSize,indices->type));
+          for (int k=0;k<3;k++)
+            valid &= (index[i][k] >= 0 && index[i][k] < numVertices);
+        }
+        if (!triangles) allTriangles = false;
+        if (!valid)     validIndices = false;
+      });
+      if (allTriangles && !validIndices)
+        throw std::runtime_error("PLY face references missing vertex: "+plyFile);
+      if (allTriangles)
+        return;
+      // the rows only happened to add up - fall back to reading them
+      // one by one
+      mesh.index.clear();
+    }
+
+    // general case: rows of varying size, so walk them twice - once to
+    // count triangles, once to read them
+    size_t numTriangles = 0;
+    for (const char *row=element.begin;row<element.end;
+         row+=plyRowSize(element,row,element.end)) {
+      const int64_t n = readPly<int64_t>(row+indices->offset,indices->countType);
+      numTriangles += n >= 3 ? size_t(n-2) : 0;
+    }
+    mesh.index.resize(numTriangles);
+    vec3i *index = mesh.index.data();
+    for (const char *row=element.begin;row<element.end;
+         row+=plyRowSize(element,row,element.end)) {
+      // indices may only be read at its offset if it's the first list
+      size_t offset = 0;
+      for (auto &prop : element.properties) {
+        if (&prop == indices) break;
+        offset += prop.isList
+          ? plyTypeSize(prop.countType)
+          + size_t(readPly<int64_t>(row+offset,prop.countType))*plyTypeSize(prop.type)
+          : plyTypeSize(prop.type);
+      }
+      const int64_t n = readPly<int64_t>(row+offset,indices->countType);
+      const char *idx = row + offset + countSize;
+      for (int64_t i=0;i<n;i++) {
+        const int vertexID = readPly<int>(idx+i*indexSize,indices->type);
+        if (vertexID < 0 || vertexID >= numVertices)
+          throw std::runtime_error("PLY face references missing vertex: "+plyFile);
+      }
+      for (int64_t i=1;i+1<n;i++)
+        *index++ = vec3i(readPly<int>(idx,                 indices->type),
+                         readPly<int>(idx+i*indexSize,     indices->type),
+                         readPly<int>(idx+(i+1)*indexSize, indices->type));
+    }
+  }
+
+  Model *loadPLY(const std::string &plyFile)
+  {
+    MappedFile file;
+    if (!file.open(plyFile))
+      throw std::runtime_error("Could not read PLY model from "+plyFile);
+
+    std::vector<PlyElement> elements;
+    const char *data = parsePlyHeader(file,elements,plyFile);
+    locatePlyElements(elements,data,file.data+file.size,plyFile);
+
+    const PlyElement *vertices = nullptr, *faces = nullptr;
+    for (auto &element : elements) {
+      if (element.name == "vertex") vertices = &element;
+      if (element.name == "face")   faces    = &element;
+    }
+    if (!vertices)
+      throw std::runtime_error("PLY file has no vertices: "+plyFile);
+
+    std::unique_ptr<TriangleMesh> mesh(new TriangleMesh);
+    mesh->diffuse = vec3f(.8f);
+    readPlyVertices(*vertices,*mesh,plyFile);
+    if (faces)
+      readPlyFaces(*faces,*mesh,plyFile);
+
+    Model *model = new Model;
+    model->meshes.push_back(mesh.release());
+    computeBounds(model);
+
+    std::cout << "loaded PLY file - " << model->meshes[0]->vertex.size()
+              << " vertices, " << model->meshes[0]->index.size()
+              << " triangles" << std::endl;
+    return model;
+  }
+
+} // ::osc
@@ -18,6 +18,11 @@
 #include "LaunchParams.h"
 // this include may only appear in a single source file:
 #include <optix_function_table_definition.h>
+//std
+#include <memory>
+#include <thread>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_pipeline.h>
 
 /*! \namespace osc - Optix Siggraph Course */
 namespace osc {
@@ -92,57 +97,106 @@ namespace osc {
     std::cout << GDT_TERMINAL_DEFAULT;
   }
 
+  /*! one texture's finest level, on its way to the device */
+  struct TexturePixels {
+    int                   textureID;
+    bool                  valid;
+    vec2i                 resolution;
+    std::vector<uint32_t> pixels;
+  };
+
   void SampleRenderer::createTextures()
   {
-    int numTextures = (int)model->textures.size();
+    int numTextures = (int)model->textures->size();
 
     textureArrays.resize(numTextures);
     textureObjects.resize(numTextures);
     
-    for (int textureID=0;textureID<numTextures;textureID++) {
-      auto texture = model->textures[textureID];
-      
-      cudaResourceDesc res_desc = {};
-      
-      cudaChannelFormatDesc channel_desc;
-      int32_t width  = texture->resolution.x;
-      int32_t height = texture->resolution.y;
-      int32_t numComponents = 4;
-      int32_t pitch  = width*numComponents*sizeof(uint8_t);
-      channel_desc = cudaCreateChannelDesc<uchar4>();
-      
-      cudaArray_t   &pixelArray = textureArrays[textureID];
-      CUDA_CHECK(MallocArray(&pixelArray,
-                             &channel_desc,
-                             width,height));
-      
-      CUDA_CHECK(Memcpy2DToArray(pixelArray,
-                                 /* offset */0,0,
-                                 texture->pixel,
-                                 pitch,pitch,height,
-                                 cudaMemcpyHostToDevice));
-      
-      res_desc.resType          = cudaResourceTypeArray;
-      res_desc.res.array.array  = pixelArray;
-      
-      cudaTextureDesc tex_desc     = {};
-      tex_desc.addressMode[0]      = cudaAddressModeWrap;
-      tex_desc.addressMode[1]      = cudaAddressModeWrap;
-      tex_desc.filterMode          = cudaFilterModeLinear;
-      tex_desc.readMode            = cudaReadModeNormalizedFloat;
-      tex_desc.normalizedCoords    = 1;
-      tex_desc.maxAnisotropy       = 1;
-      tex_desc.maxMipmapLevelClamp = 99;
-      tex_desc.minMipmapLevelClamp = 0;
-      tex_desc.mipmapFilterMode    = cudaFilterModePoint;
-      tex_desc.borderColor[0]      = 1.0f;
-      tex_desc.sRGB                = 0;
-      
-      // Create texture object
-      cudaTextureObject_t cuda_tex = 0;
-      CUDA_CHECK(CreateTextureObject(&cuda_tex, &res_desc, &tex_desc, nullptr));
-      textureObjects[textureID] = cuda_tex;
+    // the device needs the whole textures; read them from the
+    // (host-side) texture cache - decoding them, if needed - in
+    // parallel, and upload each one as soon as it's there. Only as
+    // many textures as there are threads are on the host at a time
+    int nextTexture = 0;
+    tbb::parallel_pipeline
+      (std::max(1u,std::thread::hardware_concurrency()),
+       tbb::make_filter<void,int>
+       (tbb::filter_mode::serial_in_order,
+        [&](tbb::flow_control &control) {
+          if (nextTexture == numTextures) {
+            control.stop();
+            return -1;
+          }
+          return nextTexture++;
+        })
+       & tbb::make_filter<int,std::shared_ptr<TexturePixels>>
+       (tbb::filter_mode::parallel,
+        [&](int textureID) {
+          auto texture = std::make_shared<TexturePixels>();
+          texture->textureID = textureID;
+          texture->valid
+            = model->textures->readLevel(textureID,0,
+                                         texture->pixels,
+                                         texture->resolution);
+          return texture;
+        })
+       & tbb::make_filter<std::shared_ptr<TexturePixels>,void>
+       (tbb::filter_mode::serial_out_of_order,
+        [&](std::shared_ptr<TexturePixels> texture) {
+          uploadTexture(texture->textureID,texture->valid,
+                        texture->pixels,texture->resolution);
+        }));
+  }
+
+  void SampleRenderer::uploadTexture(int textureID, bool valid,
+                                     const std::vector<uint32_t> &pixels,
+                                     const vec2i &resolution)
+  {
+    if (!valid) {
+      textureArrays[textureID]  = 0;
+      textureObjects[textureID] = 0;
+      return;
     }
+    
+    cudaResourceDesc res_desc = {};
+    
+    cudaChannelFormatDesc channel_desc;
+    int32_t width  = resolution.x;
+    int32_t height = resolution.y;
+    int32_t numComponents = 4;
+    int32_t pitch  = width*numComponents*sizeof(uint8_t);
+    channel_desc = cudaCreateChannelDesc<uchar4>();
+    
+    cudaArray_t   &pixelArray = textureArrays[textureID];
+    CUDA_CHECK(MallocArray(&pixelArray,
+                           &channel_desc,
+                           width,height));
+    
+    CUDA_CHECK(Memcpy2DToArray(pixelArray,
+                               /* offset */0,0,
+                               pixels.data(),
+                               pitch,pitch,height,
+                               cudaMemcpyHostToDevice));
+    
+    res_desc.resType          = cudaResourceTypeArray;
+    res_desc.res.array.array  = pixelArray;
+    
+    cudaTextureDesc tex_desc     = {};
+    tex_desc.addressMode[0]      = cudaAddressModeWrap;
+    tex_desc.addressMode[1]      = cudaAddressModeWrap;
+    tex_desc.filterMode          = cudaFilterModeLinear;
+    tex_desc.readMode            = cudaReadModeNormalizedFloat;
+    tex_desc.normalizedCoords    = 1;
+    tex_desc.maxAnisotropy       = 1;
+    tex_desc.maxMipmapLevelClamp = 99;
+    tex_desc.minMipmapLevelClamp = 0;
+    tex_desc.mipmapFilterMode    = cudaFilterModePoint;
+    tex_desc.borderColor[0]      = 1.0f;
+    tex_desc.sRGB                = 0;
+    
+    // Create texture object
+    cudaTextureObject_t cuda_tex = 0;
+    CUDA_CHECK(CreateTextureObject(&cuda_tex, &res_desc, &tex_desc, nullptr));
+    textureObjects[textureID] = cuda_tex;
   }
   
   OptixTraversableHandle SampleRenderer::buildAccel()
@@ -166,12 +220,12 @@ namespace osc {
     for (int meshID=0;meshID<numMeshes;meshID++) {
       // upload the model to the device: the builder
       TriangleMesh &mesh = *model->meshes[meshID];
-      vertexBuffer[meshID].alloc_and_upload(mesh.vertex);
-      indexBuffer[meshID].alloc_and_upload(mesh.index);
+      vertexBuffer[meshID].alloc_and_upload(mesh.vertex.data(),mesh.vertex.size());
+      indexBuffer[meshID].alloc_and_upload(mesh.index.data(),mesh.index.size());
       if (!mesh.normal.empty())
-        normalBuffer[meshID].alloc_and_upload(mesh.normal);
+        normalBuffer[meshID].alloc_and_upload(mesh.normal.data(),mesh.normal.size());
       if (!mesh.texcoord.empty())
-        texcoordBuffer[meshID].alloc_and_upload(mesh.texcoord);
+        texcoordBuffer[meshID].alloc_and_upload(mesh.texcoord.data(),mesh.texcoord.size());
 
       triangleInput[meshID] = {};
       triangleInput[meshID].type
@@ -591,7 +645,8 @@ namespace osc {
         HitgroupRecord rec;
         OPTIX_CHECK(optixSbtRecordPackHeader(hitgroupPGs[rayID],&rec));
         rec.data.color   = mesh->diffuse;
-        if (mesh->diffuseTextureID >= 0) {
+        if (mesh->diffuseTextureID >= 0
+            && textureObjects[mesh->diffuseTextureID]) {
           rec.data.hasTexture = true;
           rec.data.texture    = textureObjects[mesh->diffuseTextureID];
         } else {
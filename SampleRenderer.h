@@ -96,6 +96,12 @@ namespace osc {
 
     /*! upload textures, and create cuda texture objects for them */
     void createTextures();
+
+    /*! upload one texture's pixels, and create its texture object (or
+        a null one, if it couldn't be read) */
+    void uploadTexture(int textureID, bool valid,
+                       const std::vector<uint32_t> &pixels,
+                       const vec2i &resolution);
   protected:
     /*! @{ CUDA device context and stream that optix pipeline will run
         on, as well as device properties for this device */
@@ -0,0 +1,332 @@
+// ======================================================================== //
+// Copyright 2018-2024 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "Scene.h"
+//std
+#include <algorithm>
+
+/*! \namespace osc - Optix Siggraph Course */
+namespace osc {
+
+  static_assert(sizeof(Instance) == 64,
+                "instances should stay at 64 bytes each");
+
+  void Geometry::build()
+  {
+    std::vector<box3f> primBounds(mesh.index.size());
+    for (size_t i=0;i<mesh.index.size();i++) {
+      const vec3i idx = mesh.index[i];
+      primBounds[i] = box3f(mesh.vertex[idx.x])
+        .extend(mesh.vertex[idx.y])
+        .extend(mesh.vertex[idx.z]);
+    }
+    bvh.build(primBounds);
+    // the BLAS already reduced the triangles' bounds
+    mesh.bounds = bvh.bounds;
+  }
+
+  size_t Geometry::memoryUsage() const
+  {
+    return bvh.memoryUsage()
+      + mesh.vertex.size()   * sizeof(vec3f)
+      + mesh.normal.size()   * sizeof(vec3f)
+      + mesh.texcoord.size() * sizeof(vec2f)
+      + mesh.index.size()    * sizeof(vec3i)
+      + triangleFaces.size() * sizeof(int);
+  }
+
+  static_assert(sizeof(PackedMaterial) == 32,
+                "material records should stay at 32 bytes each");
+
+  Scene::Scene()
+  {
+    materials.push_back(PackedMaterial());
+    materialTextureIDs.push_back(-1);
+  }
+
+  uint32_t Scene::addMesh()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!freeMeshIDs.empty()) {
+      const uint32_t meshID = freeMeshIDs.back();
+      freeMeshIDs.pop_back();
+      return meshID;
+    }
+    meshes.push_back(MeshSlot());
+    meshMaterialIDs.push_back(DEFAULT_MATERIAL);
+    meshPrimIDs.push_back(-1);
+    return (uint32_t)meshes.size()-1;
+  }
+
+  void Scene::setMesh(uint32_t meshID,
+                      const std::shared_ptr<const Geometry> &geometry,
+                      const std::vector<affine3f> &transforms)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    eraseInstances(meshID);
+    MeshSlot &slot = meshes[meshID];
+    slot.geometry = geometry;
+    if (geometry && !geometry->bvh.empty()) {
+      slot.numInstances = (uint32_t)transforms.size();
+      for (uint32_t i=0;i<slot.numInstances;i++) {
+        Instance inst;
+        inst.worldToObject = rcp(transforms[i]);
+        inst.geometry      = geometry.get();
+        inst.meshID        = meshID;
+        inst.instanceID    = i;
+        instances.push_back(inst);
+      }
+    }
+    dirty = true;
+    version++;
+  }
+
+  void Scene::eraseInstances(uint32_t meshID)
+  {
+    // at load time every mesh gets set exactly once, and has nothing
+    // to erase yet; later edits pay one pass over the instances, which
+    // the TLAS re-build they trigger costs anyway
+    if (meshes[meshID].numInstances == 0) return;
+    instances.erase(std::remove_if(instances.begin(),instances.end(),
+                                   [&](const Instance &inst) {
+                                     return inst.meshID == meshID;
+                                   }),
+                    instances.end());
+    meshes[meshID].numInstances = 0;
+  }
+
+  void Scene::removeMesh(uint32_t meshID)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    eraseInstances(meshID);
+    meshes[meshID] = MeshSlot();
+    meshMaterialIDs[meshID] = DEFAULT_MATERIAL;
+    meshPrimIDs[meshID] = -1;
+    freeMeshIDs.push_back(meshID);
+    dirty = true;
+    version++;
+  }
+
+  void Scene::setMeshMaterial(uint32_t meshID, uint16_t materialID)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    meshMaterialIDs[meshID] = materialID;
+    version++;
+  }
+
+  void Scene::setMeshPrimID(uint32_t meshID, int primID)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    meshPrimIDs[meshID] = primID;
+  }
+
+  uint16_t Scene::addMaterial()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!freeMaterialIDs.empty()) {
+      const uint16_t materialID = freeMaterialIDs.back();
+      freeMaterialIDs.pop_back();
+      materials[materialID] = PackedMaterial();
+      materialTextureIDs[materialID] = -1;
+      return materialID;
+    }
+    if (materials.size() > UINT16_MAX) {
+      std::cout << GDT_TERMINAL_RED
+                << "#osc: out of material IDs, using default material"
+                << GDT_TERMINAL_DEFAULT << std::endl;
+      return DEFAULT_MATERIAL;
+    }
+    materials.push_back(PackedMaterial());
+    materialTextureIDs.push_back(-1);
+    return (uint16_t)(materials.size()-1);
+  }
+
+  void Scene::setMaterial(uint16_t materialID, const PackedMaterial &material,
+                          int diffuseTextureID)
+  {
+    // the default material is shared by everything that has no
+    // material of its own, so it never gets overwritten
+    if (materialID == DEFAULT_MATERIAL) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    materials[materialID] = material;
+    materialTextureIDs[materialID] = diffuseTextureID;
+    version++;
+  }
+
+  void Scene::removeMaterial(uint16_t materialID)
+  {
+    if (materialID == DEFAULT_MATERIAL) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    materials[materialID] = PackedMaterial();
+    materialTextureIDs[materialID] = -1;
+    // meshes still pointing at this ID fall back to the default
+    // material, rather than silently picking up whatever material
+    // gets this ID next
+    for (auto &meshMaterialID : meshMaterialIDs)
+      if (meshMaterialID == materialID)
+        meshMaterialID = DEFAULT_MATERIAL;
+    freeMaterialIDs.push_back(materialID);
+    version++;
+  }
+
+  int Scene::addTexture(const std::string &fileName)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = textureIDs.find(fileName);
+    if (it != textureIDs.end())
+      return it->second;
+    const int textureID = textures.addTexture(fileName);
+    textureIDs[fileName] = textureID;
+    return textureID;
+  }
+
+  /*! a light that doesn't emit anything, for unused light slots */
+  static Light blackLight()
+  {
+    Light light;
+    light.radiance = vec3f(0.f);
+    return light;
+  }
+
+  uint32_t Scene::addLight()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    lightsDirty = true;
+    if (!freeLightIDs.empty()) {
+      const uint32_t lightID = freeLightIDs.back();
+      freeLightIDs.pop_back();
+      return lightID;
+    }
+    lights.push_back(blackLight());
+    return (uint32_t)lights.size()-1;
+  }
+
+  void Scene::setLight(uint32_t lightID, const Light &light)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    lights[lightID] = light;
+    lightsDirty = true;
+    version++;
+  }
+
+  void Scene::removeLight(uint32_t lightID)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    // black lights get zero probability, so the slot just sits there
+    // until re-used
+    lights[lightID] = blackLight();
+    freeLightIDs.push_back(lightID);
+    lightsDirty = true;
+    version++;
+  }
+
+  void Scene::commit()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!dirty && !lightsDirty) return;
+    if (dirty) buildTLAS();
+    // distant and dome lights are weighted by the scene's size, so
+    // geometry changes re-weight those, too
+    lightSampler.build(lights,tlas.bounds);
+    dirty       = false;
+    lightsDirty = false;
+  }
+
+  void Scene::buildTLAS()
+  {
+    std::vector<box3f> instBounds(instances.size());
+    for (size_t instID=0;instID<instances.size();instID++) {
+      const Instance &inst = instances[instID];
+      const box3f &objBounds = inst.geometry->bvh.bounds;
+      // the object-to-world transform is only kept as its inverse
+      const affine3f xfm = rcp(inst.worldToObject);
+      box3f worldBounds;
+      for (int c=0;c<8;c++) {
+        const vec3f corner((c&1) ? objBounds.upper.x : objBounds.lower.x,
+                           (c&2) ? objBounds.upper.y : objBounds.lower.y,
+                           (c&4) ? objBounds.upper.z : objBounds.lower.z);
+        worldBounds.extend(xfmPoint(xfm,corner));
+      }
+      // inverting twice isn't exact; pad a little, so the bounds stay
+      // conservative
+      const float pad = 1e-5f * reduce_max(max(abs(worldBounds.lower),
+                                               abs(worldBounds.upper)));
+      worldBounds.lower -= vec3f(pad);
+      worldBounds.upper += vec3f(pad);
+      instBounds[instID] = worldBounds;
+    }
+    tlas.build(instBounds);
+  }
+
+  bool Scene::intersect(Ray &ray, Hit &hit) const
+  {
+    return tlas.traverse(ray,[&](uint32_t instID, Ray &ray) {
+        const Instance &inst = instances[instID];
+        const TriangleMesh &mesh = inst.geometry->mesh;
+        Ray objRay;
+        objRay.org  = xfmPoint(inst.worldToObject,ray.org);
+        objRay.dir  = xfmVector(inst.worldToObject,ray.dir);
+        objRay.tmin = ray.tmin;
+        objRay.tmax = ray.tmax;
+        const bool found
+          = inst.geometry->bvh.traverse(objRay,[&](uint32_t primID, Ray &objRay) {
+              const vec3i idx = mesh.index[primID];
+              float t, u, v;
+              if (!intersectTriangle(objRay,
+                                     mesh.vertex[idx.x],
+                                     mesh.vertex[idx.y],
+                                     mesh.vertex[idx.z],
+                                     t,u,v))
+                return false;
+              objRay.tmax = t;
+              hit.t       = t;
+              hit.u       = u;
+              hit.v       = v;
+              hit.primID  = primID;
+              hit.instID  = instID;
+              return true;
+            });
+        // object-space direction is not re-normalized, so t carries
+        // over to world space unchanged
+        if (found) ray.tmax = objRay.tmax;
+        return found;
+      });
+  }
+
+  bool Scene::occluded(const Ray &worldRay) const
+  {
+    Ray ray = worldRay;
+    return tlas.traverse<true>(ray,[&](uint32_t instID, Ray &ray) {
+        const Instance &inst = instances[instID];
+        const TriangleMesh &mesh = inst.geometry->mesh;
+        Ray objRay;
+        objRay.org  = xfmPoint(inst.worldToObject,ray.org);
+        objRay.dir  = xfmVector(inst.worldToObject,ray.dir);
+        objRay.tmin = ray.tmin;
+        objRay.tmax = ray.tmax;
+        return inst.geometry->bvh.traverse<true>(objRay,[&](uint32_t primID, Ray &objRay) {
+            const vec3i idx = mesh.index[primID];
+            float t, u, v;
+            return intersectTriangle(objRay,
+                                     mesh.vertex[idx.x],
+                                     mesh.vertex[idx.y],
+                                     mesh.vertex[idx.z],
+                                     t,u,v);
+          });
+      });
+  }
+
+} // ::osc
@@ -0,0 +1,243 @@
+// ======================================================================== //
+// Copyright 2018-2024 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "Model.h"
+#include "BVH.h"
+#include "Lights.h"
+#include "TextureCache.h"
+//std
+#include <map>
+#include <memory>
+#include <mutex>
+
+/*! \namespace osc - Optix Siggraph Course */
+namespace osc {
+
+  /*! a triangle mesh plus the bottom-level BVH over its triangles;
+      this is what gets shared between all instances of the same
+      geometry */
+  struct Geometry {
+    /*! (re-)build the BLAS over mesh.index */
+    void build();
+
+    size_t memoryUsage() const;
+
+    /*! the polygon a hit's primID lies in, if known (see
+        triangleFaces); otherwise, the triangle itself */
+    int faceOf(uint32_t primID) const
+    { return triangleFaces.empty() ? int(primID) : triangleFaces[primID]; }
+
+    TriangleMesh     mesh;
+    WideBVH          bvh;
+    /*! per triangle of mesh.index, the polygon of the source mesh it got
+        triangulated from - also if optimizeMesh re-ordered the
+        triangles since; empty if not known, in which case triangles
+        count as faces of their own */
+    std::vector<int> triangleFaces;
+  };
+
+  /*! one placement of a geometry in the scene. Only the world-to-object
+      transform is kept (that's what traversal needs); the forward
+      transform only gets reconstructed for the hit that's finally
+      shaded. Exactly 64 bytes, no matter how big the geometry */
+  struct Instance {
+    affine3f        worldToObject;
+    const Geometry *geometry;
+    /*! scene mesh this instance belongs to, and which of that mesh's
+        instances it is */
+    uint32_t        meshID;
+    uint32_t        instanceID;
+  };
+
+  /*! a surface material, packed into 32 bytes so the whole material
+      table stays small and two records share a cache line. Shading
+      finds it through a 16-bit material ID per mesh */
+  struct PackedMaterial {
+    vec3f    diffuse   { .8f };
+    float    opacity   { 1.f };
+    vec3f    emissive  { 0.f };
+    /*! roughness and metallic, quantized to [0..255] */
+    uint8_t  roughness { 128 };
+    uint8_t  metallic  { 0 };
+    uint16_t flags     { 0 };
+  };
+
+  /*! closest-hit information, in world space */
+  struct Hit {
+    float    t { 1e20f };
+    float    u, v;
+    uint32_t primID;
+    /*! index into Scene::instances */
+    uint32_t instID;
+  };
+
+  /*! a two-level scene: any number of meshes, each of which has a
+      shared geometry and any number of instances of it. Instances are
+      stored flat, 64 bytes each and nothing else per instance; commit()
+      builds the top-level BVH over them, referencing each geometry's
+      BLAS */
+  class Scene {
+  public:
+    /*! material ID every mesh uses until told otherwise; always valid */
+    enum { DEFAULT_MATERIAL = 0 };
+
+    Scene();
+
+    /*! allocate a new mesh slot, and return its ID */
+    uint32_t addMesh();
+
+    /*! set geometry and (object-to-world) instance transforms of a
+        mesh; thread-safe, so it can get called from Hydra's Sync. This
+        replaces the mesh's instances right away, so - like commit() -
+        it must not run concurrently with traversal, and the scene must
+        get committed before it is traversed again */
+    void setMesh(uint32_t meshID,
+                 const std::shared_ptr<const Geometry> &geometry,
+                 const std::vector<affine3f> &transforms);
+
+    /*! release the given mesh slot */
+    void removeMesh(uint32_t meshID);
+
+    /*! set which material the given mesh uses; does not require
+        re-building anything */
+    void setMeshMaterial(uint32_t meshID, uint16_t materialID);
+
+    /*! set the ID the given mesh is known by outside of the scene (eg,
+        Hydra's prim ID), which hits report for picking; -1 until set */
+    void setMeshPrimID(uint32_t meshID, int primID);
+
+    /*! allocate a new material record (initialized to the default
+        material), and return its ID */
+    uint16_t addMaterial();
+
+    /*! update a single material record in place, and the texture (as
+        returned by addTexture, or -1 for none) that modulates its
+        diffuse color */
+    void setMaterial(uint16_t materialID, const PackedMaterial &material,
+                     int diffuseTextureID = -1);
+
+    /*! release the given material record; meshes that still use it
+        go back to DEFAULT_MATERIAL */
+    void removeMaterial(uint16_t materialID);
+
+    /*! register the given image file with the scene's texture cache,
+        and return its texture ID; the file is only read once something
+        samples it, and registering it again returns the same ID */
+    int addTexture(const std::string &fileName);
+
+    /*! allocate a new light (that doesn't emit anything yet), and
+        return its ID */
+    uint32_t addLight();
+
+    /*! update a single light; takes effect with the next commit */
+    void setLight(uint32_t lightID, const Light &light);
+
+    /*! release the given light */
+    void removeLight(uint32_t lightID);
+
+    /*! rebuild the top-level BVH and light sampler if anything changed
+        since the last commit; must not run concurrently with traversal */
+    void commit();
+
+    /*! find closest hit along ray; shrinks ray.tmax */
+    bool intersect(Ray &ray, Hit &hit) const;
+
+    /*! test if anything lies within [ray.tmin,ray.tmax) */
+    bool occluded(const Ray &ray) const;
+
+    /*! pick one light (proportional to its power) and a point on it,
+        as seen from surface point P with normal N; see LightSampler */
+    bool sampleLight(const vec3f &P, const vec3f &N,
+                     float u0, float u1, float u2,
+                     LightSample &ls) const
+    { return lightSampler.sample(lights,P,N,u0,u1,u2,ls); }
+
+    /*! whether any light emits anything, as of the last commit */
+    bool hasLights() const { return !lightSampler.empty(); }
+
+    const Instance &getInstance(uint32_t instID) const
+    { return instances[instID]; }
+
+    const PackedMaterial &getMaterial(const Instance &inst) const
+    { return materials[meshMaterialIDs[inst.meshID]]; }
+
+    /*! the instance's mesh's ID, as given to setMeshPrimID */
+    int getPrimID(const Instance &inst) const
+    { return meshPrimIDs[inst.meshID]; }
+
+    /*! texture ID of the diffuse texture of the instance's material,
+        or -1 if it has none */
+    int getDiffuseTexture(const Instance &inst) const
+    { return materialTextureIDs[meshMaterialIDs[inst.meshID]]; }
+
+    /*! filtered texture lookup at uv, through the texture cache */
+    vec4f sampleTexture(int textureID, const vec2f &uv) const
+    { return textures.sample(textureID,uv); }
+
+    //! bounds of all instances, as of the last commit
+    box3f bounds() const { return tlas.bounds; }
+
+    /*! counts every change that can alter the rendered image (meshes,
+        materials, lights), so progressive renderers can tell when they
+        have to start over */
+    uint64_t getVersion() const { return version; }
+
+  private:
+    /*! build the TLAS over all instances */
+    void buildTLAS();
+
+    /*! drop the given mesh's instances; caller holds the mutex */
+    void eraseInstances(uint32_t meshID);
+
+    /*! the transforms only live in the mesh's instances */
+    struct MeshSlot {
+      std::shared_ptr<const Geometry> geometry;
+      uint32_t                        numInstances { 0 };
+    };
+
+    std::mutex            mutex;
+    std::vector<MeshSlot> meshes;
+    std::vector<uint32_t> freeMeshIDs;
+    bool                  dirty { false };
+    uint64_t              version { 0 };
+
+    /*! material ID per mesh slot, kept apart from the slots so shading
+        only touches this and the material table */
+    std::vector<uint16_t>       meshMaterialIDs;
+    std::vector<int>            meshPrimIDs;
+    std::vector<PackedMaterial> materials;
+    std::vector<uint16_t>       freeMaterialIDs;
+    /*! diffuse texture per material record, or -1; kept apart so the
+        records stay at 32 bytes */
+    std::vector<int>            materialTextureIDs;
+
+    /*! all textures materials refer to, and their IDs by file name.
+        Sampling fills the cache, hence mutable */
+    mutable TextureCache       textures;
+    std::map<std::string,int>  textureIDs;
+
+    std::vector<Light>    lights;
+    std::vector<uint32_t> freeLightIDs;
+    bool                  lightsDirty { false };
+    LightSampler          lightSampler;
+
+    std::vector<Instance> instances;
+    WideBVH               tlas;
+  };
+
+} // ::osc
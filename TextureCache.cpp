@@ -0,0 +1,552 @@
+// ======================================================================== //
+// Copyright 2018-2024 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "TextureCache.h"
+// the implementation lives in Model.cpp
+#include "3rdParty/stb_image.h"
+//std
+#include <algorithm>
+#include <cstring>
+
+/*! \namespace osc - Optix Siggraph Course */
+namespace osc {
+
+  static const uint32_t OPAQUE_WHITE = 0xffffffffu;
+
+  static const size_t TILE_TEXELS
+  = TextureCache::TILE_SIZE * TextureCache::TILE_SIZE;
+  static const size_t TILE_BYTES = TILE_TEXELS * sizeof(uint32_t);
+
+  /*! which tile a slot holds: texture ID and the tile's index among
+      all tiles of all levels of that texture */
+  inline uint64_t tileKey(int textureID, size_t tileID)
+  {
+    return (uint64_t(textureID) << 32) | uint64_t(tileID);
+  }
+
+  /*! seek to the given offset, which can be beyond what fseek's long
+      can address */
+  static bool seekTo(FILE *file, uint64_t offset)
+  {
+#ifdef _WIN32
+    return _fseeki64(file,(__int64)offset,SEEK_SET) == 0;
+#else
+    return fseeko(file,(off_t)offset,SEEK_SET) == 0;
+#endif
+  }
+
+  /*! 2x2 box filter of the given level; odd texels at the border get
+      clamped */
+  static void downsample(const uint32_t *in, const vec2i &inRes,
+                         std::vector<uint32_t> &out, const vec2i &outRes)
+  {
+    out.resize(size_t(outRes.x)*outRes.y);
+    for (int y=0;y<outRes.y;y++)
+      for (int x=0;x<outRes.x;x++) {
+        const int x0 = std::min(2*x,inRes.x-1), x1 = std::min(2*x+1,inRes.x-1);
+        const int y0 = std::min(2*y,inRes.y-1), y1 = std::min(2*y+1,inRes.y-1);
+        const uint32_t t[4] = {
+          in[size_t(y0)*inRes.x+x0], in[size_t(y0)*inRes.x+x1],
+          in[size_t(y1)*inRes.x+x0], in[size_t(y1)*inRes.x+x1]
+        };
+        uint32_t result = 0;
+        for (int c=0;c<32;c+=8) {
+          const uint32_t sum
+            = ((t[0]>>c)&0xff) + ((t[1]>>c)&0xff)
+            + ((t[2]>>c)&0xff) + ((t[3]>>c)&0xff);
+          result |= ((sum+2)/4) << c;
+        }
+        out[size_t(y)*outRes.x+x] = result;
+      }
+  }
+
+  inline int wrap(int i, int n)
+  {
+    i %= n;
+    return i < 0 ? i+n : i;
+  }
+
+  inline vec4f unpack(uint32_t texel)
+  {
+    return vec4f((texel      ) & 0xff,
+                 (texel >>  8) & 0xff,
+                 (texel >> 16) & 0xff,
+                 (texel >> 24)       ) * (1.f/255.f);
+  }
+
+  TextureCache::TextureCache(size_t memoryBudget)
+    : memoryBudget(memoryBudget)
+  {}
+
+  TextureCache::~TextureCache()
+  {
+    prefetches.wait();
+    if (spillFile) fclose(spillFile);
+    for (auto chunk : textureChunks)
+      delete[] chunk;
+  }
+
+  int TextureCache::addTexture(const std::string &fileName)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    const size_t textureID = numTextures.load(std::memory_order_relaxed);
+    if (textureID >= size_t(MAX_TEXTURE_CHUNKS)*TEXTURES_PER_CHUNK) {
+      std::cout << GDT_TERMINAL_RED
+                << "#osc: out of texture IDs, ignoring " << fileName
+                << GDT_TERMINAL_DEFAULT << std::endl;
+      return -1;
+    }
+    std::unique_ptr<TextureInfo> *&chunk
+      = textureChunks[textureID/TEXTURES_PER_CHUNK];
+    if (!chunk)
+      chunk = new std::unique_ptr<TextureInfo>[TEXTURES_PER_CHUNK];
+    chunk[textureID%TEXTURES_PER_CHUNK].reset(new TextureInfo);
+    chunk[textureID%TEXTURES_PER_CHUNK]->fileName = fileName;
+    // readers find the texture once they see the new count
+    numTextures.store(textureID+1,std::memory_order_release);
+    return (int)textureID;
+  }
+
+  size_t TextureCache::size() const
+  {
+    return numTextures.load(std::memory_order_acquire);
+  }
+
+  std::string TextureCache::fileName(int textureID) const
+  {
+    const TextureInfo *texture = getTexture(textureID);
+    return texture ? texture->fileName : "";
+  }
+
+  void TextureCache::setMemoryBudget(size_t memoryBudget)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->memoryBudget = memoryBudget;
+    // nobody's looking up texels right now, so the slots can actually
+    // get freed rather than just re-used
+    while (slots.size() > 1
+           && slots.size()*TILE_BYTES + decodingBytes > memoryBudget) {
+      TileSlot *slot = evictTile();
+      for (size_t i=0;i<slots.size();i++)
+        if (slots[i].get() == slot) {
+          slots.erase(slots.begin()+i);
+          break;
+        }
+      clockHand = clockHand % slots.size();
+    }
+    decodeDone.notify_all();
+  }
+
+  size_t TextureCache::memoryUsage() const
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return residentBytes;
+  }
+
+  TextureCache::TextureInfo *TextureCache::getTexture(int textureID) const
+  {
+    if (textureID < 0
+        || size_t(textureID) >= numTextures.load(std::memory_order_acquire))
+      return nullptr;
+    return textureChunks[textureID/TEXTURES_PER_CHUNK]
+      [textureID%TEXTURES_PER_CHUNK].get();
+  }
+
+  bool TextureCache::ensureInfo(TextureInfo &texture)
+  {
+    if (texture.hasInfo.load(std::memory_order_acquire))
+      return !texture.levels.empty();
+
+    std::lock_guard<std::mutex> loadLock(texture.loadMutex);
+    if (texture.hasInfo.load(std::memory_order_relaxed))
+      return !texture.levels.empty();
+
+    vec2i res;
+    int   comp;
+    if (stbi_info(texture.fileName.c_str(),&res.x,&res.y,&comp)
+        && res.x > 0 && res.y > 0) {
+      size_t numTiles = 0;
+      while (true) {
+        Level level;
+        level.res       = res;
+        level.numTiles  = (res + vec2i(TILE_SIZE-1)) / vec2i(TILE_SIZE);
+        level.firstTile = numTiles;
+        numTiles += size_t(level.numTiles.x)*level.numTiles.y;
+        texture.levels.push_back(level);
+        if (res.x == 1 && res.y == 1) break;
+        res = vec2i(std::max(res.x/2,1),std::max(res.y/2,1));
+      }
+      texture.numTiles = numTiles;
+      texture.tiles.reset(new std::atomic<TileSlot *>[numTiles]);
+      for (size_t i=0;i<numTiles;i++)
+        texture.tiles[i].store(nullptr,std::memory_order_relaxed);
+    } else {
+      std::cout << GDT_TERMINAL_RED
+                << "Could not read texture " << texture.fileName << "!"
+                << GDT_TERMINAL_DEFAULT << std::endl;
+    }
+    texture.hasInfo.store(true,std::memory_order_release);
+    return !texture.levels.empty();
+  }
+
+  void TextureCache::reserveDecode(size_t bytes)
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    // a decode that doesn't fit next to the resident tiles still has
+    // to happen eventually; it just gets to run on its own
+    decodeDone.wait(lock,[&]() {
+        return decodingBytes == 0
+          || slots.size()*TILE_BYTES + decodingBytes + bytes <= memoryBudget;
+      });
+    decodingBytes += bytes;
+  }
+
+  void TextureCache::releaseDecode(size_t bytes)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      decodingBytes -= bytes;
+    }
+    decodeDone.notify_all();
+  }
+
+  bool TextureCache::ensurePyramid(TextureInfo &texture)
+  {
+    if (texture.hasPyramid.load(std::memory_order_acquire))
+      return true;
+    if (!ensureInfo(texture))
+      return false;
+
+    std::lock_guard<std::mutex> loadLock(texture.loadMutex);
+    if (texture.hasPyramid.load(std::memory_order_relaxed))
+      return true;
+    if (texture.pyramidFailed)
+      return false;
+    texture.pyramidFailed = true;
+
+    {
+      std::lock_guard<std::mutex> spillLock(spillMutex);
+      if (!spillFile && !(spillFile = std::tmpfile())) {
+        std::cout << GDT_TERMINAL_RED
+                  << "#osc: could not create texture spill file"
+                  << GDT_TERMINAL_DEFAULT << std::endl;
+        return false;
+      }
+      texture.spillOffset = spillSize;
+      spillSize += texture.numTiles*TILE_BYTES;
+    }
+
+    // the decoded image, the level below it, and a row of tiles on
+    // their way to the spill file
+    const Level &finest = texture.levels[0];
+    const size_t decodeBytes
+      = size_t(finest.res.x)*finest.res.y*sizeof(uint32_t)*5/4
+      + size_t(finest.numTiles.x)*TILE_BYTES;
+    reserveDecode(decodeBytes);
+
+    vec2i res;
+    int   comp;
+    unsigned char *image = stbi_load(texture.fileName.c_str(),
+                                     &res.x, &res.y, &comp, STBI_rgb_alpha);
+    if (!image || res != finest.res) {
+      // unreadable, or changed on disk since we read the header
+      std::cout << GDT_TERMINAL_RED
+                << "Could not load texture from " << texture.fileName << "!"
+                << GDT_TERMINAL_DEFAULT << std::endl;
+      if (image) stbi_image_free(image);
+      releaseDecode(decodeBytes);
+      return false;
+    }
+    // stbi loads the pictures mirrored along the y axis - mirror them
+    // in place
+    std::vector<uint32_t> row(res.x);
+    uint32_t *finestPixels = (uint32_t *)image;
+    for (int y=0;y<res.y/2;y++) {
+      uint32_t *a = finestPixels + size_t(y)*res.x;
+      uint32_t *b = finestPixels + size_t(res.y-1-y)*res.x;
+      memcpy(row.data(),a,res.x*sizeof(uint32_t));
+      memcpy(a,b,res.x*sizeof(uint32_t));
+      memcpy(b,row.data(),res.x*sizeof(uint32_t));
+    }
+
+    bool ok = true;
+    const uint32_t *pixels = finestPixels;
+    std::vector<uint32_t> level, coarser;
+    std::vector<uint32_t> tileRow;
+    for (size_t l=0;l<texture.levels.size() && ok;l++) {
+      const Level &L = texture.levels[l];
+      if (l > 0) {
+        downsample(pixels,texture.levels[l-1].res,coarser,L.res);
+        level.swap(coarser);
+        pixels = level.data();
+        if (l == 1) {
+          stbi_image_free(image);
+          image = nullptr;
+        }
+      }
+      // one row of tiles at a time, each padded to full size
+      tileRow.resize(size_t(L.numTiles.x)*TILE_TEXELS);
+      for (int ty=0;ty<L.numTiles.y && ok;ty++) {
+        std::fill(tileRow.begin(),tileRow.end(),0u);
+        for (int tx=0;tx<L.numTiles.x;tx++) {
+          uint32_t *tile = tileRow.data() + size_t(tx)*TILE_TEXELS;
+          const int x0 = tx*TILE_SIZE, x1 = std::min(x0+TILE_SIZE,L.res.x);
+          const int y0 = ty*TILE_SIZE, y1 = std::min(y0+TILE_SIZE,L.res.y);
+          for (int iy=y0;iy<y1;iy++)
+            memcpy(tile + (iy-y0)*TILE_SIZE,
+                   pixels + size_t(iy)*L.res.x + x0,
+                   (x1-x0)*sizeof(uint32_t));
+        }
+        const size_t firstTile = L.firstTile + size_t(ty)*L.numTiles.x;
+        std::lock_guard<std::mutex> spillLock(spillMutex);
+        ok = seekTo(spillFile,texture.spillOffset + firstTile*TILE_BYTES)
+          && fwrite(tileRow.data(),TILE_BYTES,L.numTiles.x,spillFile)
+          == size_t(L.numTiles.x);
+      }
+    }
+    if (image) stbi_image_free(image);
+    releaseDecode(decodeBytes);
+    if (!ok) {
+      std::cout << GDT_TERMINAL_RED
+                << "#osc: could not write " << texture.fileName
+                << " to the texture spill file"
+                << GDT_TERMINAL_DEFAULT << std::endl;
+      return false;
+    }
+
+    texture.pyramidFailed = false;
+    texture.hasPyramid.store(true,std::memory_order_release);
+    return true;
+  }
+
+  vec2i TextureCache::resolution(int textureID)
+  {
+    TextureInfo *texture = getTexture(textureID);
+    if (!texture || !ensureInfo(*texture))
+      return vec2i(0);
+    return texture->levels[0].res;
+  }
+
+  int TextureCache::numLevels(int textureID)
+  {
+    TextureInfo *texture = getTexture(textureID);
+    if (!texture || !ensureInfo(*texture))
+      return 0;
+    return (int)texture->levels.size();
+  }
+
+  bool TextureCache::lookup(TextureInfo &texture, int textureID,
+                            int level, int x, int y, uint32_t &texel) const
+  {
+    const Level &L = texture.levels[level];
+    const size_t tileID = L.firstTile
+      + size_t(y/TILE_SIZE)*L.numTiles.x + (x/TILE_SIZE);
+
+    TileSlot *slot = texture.tiles[tileID].load(std::memory_order_acquire);
+    if (!slot)
+      return false;
+    // the slot may get re-filled with another tile while we read it;
+    // if so, the sequence number tells, and it's a miss
+    const uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+    if ((sequence & 1)
+        || slot->owner.load(std::memory_order_relaxed) != tileKey(textureID,tileID))
+      return false;
+    texel = slot->texels[(y%TILE_SIZE)*TILE_SIZE + (x%TILE_SIZE)];
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot->sequence.load(std::memory_order_relaxed) != sequence)
+      return false;
+    // only write if needed, so hot tiles' cache lines stay shared
+    if (!slot->referenced.load(std::memory_order_relaxed))
+      slot->referenced.store(1,std::memory_order_relaxed);
+    return true;
+  }
+
+  void TextureCache::readTile(const TextureInfo &texture, size_t tileID,
+                              uint32_t *texels)
+  {
+    std::lock_guard<std::mutex> spillLock(spillMutex);
+    if (!seekTo(spillFile,texture.spillOffset + tileID*TILE_BYTES)
+        || fread(texels,TILE_BYTES,1,spillFile) != 1)
+      std::fill(texels,texels+TILE_TEXELS,OPAQUE_WHITE);
+  }
+
+  TextureCache::TileSlot *TextureCache::allocateSlot(bool mayEvict)
+  {
+    if (slots.empty()
+        || (slots.size()+1)*TILE_BYTES + decodingBytes <= memoryBudget) {
+      slots.emplace_back(new TileSlot);
+      return slots.back().get();
+    }
+    return mayEvict ? evictTile() : nullptr;
+  }
+
+  TextureCache::TileSlot *TextureCache::evictTile()
+  {
+    // the "clock" approximation of LRU: sweep over all slots, clearing
+    // reference bits, and take the first one that had none. After one
+    // full sweep, all bits are clear, so this always finds one
+    TileSlot *slot = nullptr;
+    for (size_t i=0;i<=slots.size();i++) {
+      slot = slots[clockHand].get();
+      clockHand = (clockHand+1) % slots.size();
+      if (!slot->referenced.load(std::memory_order_relaxed))
+        break;
+      slot->referenced.store(0,std::memory_order_relaxed);
+    }
+
+    const uint64_t owner = slot->owner.load(std::memory_order_relaxed);
+    if (owner != NO_OWNER) {
+      // lookups that still find the slot through the old tile will see
+      // the owner or sequence number change once it gets re-filled
+      TextureInfo *texture = getTexture(int(owner >> 32));
+      texture->tiles[owner & 0xffffffffu].store(nullptr,std::memory_order_relaxed);
+      residentBytes -= TILE_BYTES;
+    }
+    return slot;
+  }
+
+  uint32_t TextureCache::loadTile(TextureInfo &texture, int textureID,
+                                  int level, int x, int y)
+  {
+    if (!ensurePyramid(texture))
+      return OPAQUE_WHITE;
+
+    const Level &L = texture.levels[level];
+    const size_t tileID = L.firstTile
+      + size_t(y/TILE_SIZE)*L.numTiles.x + (x/TILE_SIZE);
+    std::vector<uint32_t> texels(TILE_TEXELS);
+    readTile(texture,tileID,texels.data());
+
+    std::lock_guard<std::mutex> lock(mutex);
+    insertTile(texture,textureID,tileID,texels.data(),true);
+    return texels[(y%TILE_SIZE)*TILE_SIZE + (x%TILE_SIZE)];
+  }
+
+  bool TextureCache::insertTile(TextureInfo &texture, int textureID,
+                                size_t tileID, const uint32_t *texels,
+                                bool mayEvict)
+  {
+    const uint64_t key = tileKey(textureID,tileID);
+    // somebody else may have brought it in meanwhile
+    TileSlot *resident = texture.tiles[tileID].load(std::memory_order_relaxed);
+    if (resident && resident->owner.load(std::memory_order_relaxed) == key)
+      return true;
+
+    TileSlot *slot = allocateSlot(mayEvict);
+    if (!slot)
+      return false;
+    const uint64_t sequence = slot->sequence.load(std::memory_order_relaxed);
+    slot->sequence.store(sequence+1,std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(slot->texels,texels,TILE_BYTES);
+    slot->owner.store(key,std::memory_order_relaxed);
+    slot->referenced.store(1,std::memory_order_relaxed);
+    slot->sequence.store(sequence+2,std::memory_order_release);
+    texture.tiles[tileID].store(slot,std::memory_order_release);
+    residentBytes += TILE_BYTES;
+    return true;
+  }
+
+  uint32_t TextureCache::fetch(int textureID, int level, int x, int y)
+  {
+    TextureInfo *texture = getTexture(textureID);
+    if (!texture || !ensureInfo(*texture))
+      return OPAQUE_WHITE;
+    level = std::max(0,std::min(level,(int)texture->levels.size()-1));
+    const vec2i res = texture->levels[level].res;
+    x = wrap(x,res.x);
+    y = wrap(y,res.y);
+
+    uint32_t texel;
+    if (lookup(*texture,textureID,level,x,y,texel))
+      return texel;
+    return loadTile(*texture,textureID,level,x,y);
+  }
+
+  vec4f TextureCache::sample(int textureID, const vec2f &uv, float lod)
+  {
+    TextureInfo *texture = getTexture(textureID);
+    if (!texture || !ensureInfo(*texture))
+      return vec4f(1.f);
+    const int   levels = (int)texture->levels.size();
+    const int   level  = std::max(0,std::min(int(lod+.5f),levels-1));
+    const vec2i res    = texture->levels[level].res;
+
+    const float fx = uv.x*res.x - .5f;
+    const float fy = uv.y*res.y - .5f;
+    const int   x0 = (int)floorf(fx);
+    const int   y0 = (int)floorf(fy);
+    const float wx = fx - x0;
+    const float wy = fy - y0;
+    const vec4f t00 = unpack(fetch(textureID,level,x0  ,y0  ));
+    const vec4f t10 = unpack(fetch(textureID,level,x0+1,y0  ));
+    const vec4f t01 = unpack(fetch(textureID,level,x0  ,y0+1));
+    const vec4f t11 = unpack(fetch(textureID,level,x0+1,y0+1));
+    return (1.f-wy)*((1.f-wx)*t00 + wx*t10)
+      +         wy *((1.f-wx)*t01 + wx*t11);
+  }
+
+  void TextureCache::prefetch(int textureID)
+  {
+    prefetches.run([this,textureID]() {
+        TextureInfo *texture = getTexture(textureID);
+        if (!texture || !ensurePyramid(*texture))
+          return;
+        // only into memory nobody uses yet: prefetches of many textures
+        // at once would otherwise just evict each other's tiles
+        const Level &L = texture->levels[0];
+        const size_t numTiles = size_t(L.numTiles.x)*L.numTiles.y;
+        std::vector<uint32_t> texels(TILE_TEXELS);
+        for (size_t tileID=L.firstTile;tileID<L.firstTile+numTiles;tileID++) {
+          readTile(*texture,tileID,texels.data());
+          std::lock_guard<std::mutex> lock(mutex);
+          if (!insertTile(*texture,textureID,tileID,texels.data(),false))
+            return;
+        }
+      });
+  }
+
+  void TextureCache::waitForPrefetches()
+  {
+    prefetches.wait();
+  }
+
+  bool TextureCache::readLevel(int textureID, int level,
+                               std::vector<uint32_t> &pixels, vec2i &res)
+  {
+    TextureInfo *texture = getTexture(textureID);
+    if (!texture || !ensurePyramid(*texture))
+      return false;
+    level = std::max(0,std::min(level,(int)texture->levels.size()-1));
+    const Level &L = texture->levels[level];
+    res = L.res;
+    pixels.resize(size_t(res.x)*res.y);
+    std::vector<uint32_t> texels(TILE_TEXELS);
+    for (int ty=0;ty<L.numTiles.y;ty++)
+      for (int tx=0;tx<L.numTiles.x;tx++) {
+        readTile(*texture,L.firstTile + size_t(ty)*L.numTiles.x + tx,
+                 texels.data());
+        const int x0 = tx*TILE_SIZE, x1 = std::min(x0+TILE_SIZE,res.x);
+        const int y0 = ty*TILE_SIZE, y1 = std::min(y0+TILE_SIZE,res.y);
+        for (int iy=y0;iy<y1;iy++)
+          memcpy(&pixels[size_t(iy)*res.x+x0],
+                 &texels[(iy-y0)*TILE_SIZE],
+                 (x1-x0)*sizeof(uint32_t));
+      }
+    return true;
+  }
+
+} // ::osc
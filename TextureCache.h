@@ -0,0 +1,220 @@
+// ======================================================================== //
+// Copyright 2018-2024 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "gdt/math/vec.h"
+//std
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <tbb/task_group.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*! \namespace osc - Optix Siggraph Course */
+namespace osc {
+  using namespace gdt;
+
+  /*! all textures of a model, loaded lazily and kept in a memory-bounded
+      cache of tiles.
+
+      Registering a texture does no I/O at all. The first access to
+      one of its texels decodes the image file, builds the whole mip
+      pyramid, and writes it, cut into TILE_SIZE^2 tiles, to a spill
+      file; that's the only time the file ever gets decoded. From
+      then on a miss reads just the one tile it needs back from the
+      spill file into the cache. Once the resident tiles fill the
+      memory budget, new ones replace the least recently used ones
+      (approximately; see evictTile()).
+
+      Looking up a resident texel takes no lock: tiles live in slots
+      guarded by a sequence number, and a reader that races with its
+      slot getting re-used just sees a miss. Decoding needs the whole
+      image in memory for a moment; that memory gets reserved against
+      the budget before decoding, too.
+
+      Textures that are known to be needed soon can be prefetched,
+      which builds their pyramids on a background thread, so that
+      many textures get decoded in parallel rather than one by one on
+      first access. Concurrent decodes share the budget: each reserves
+      its memory up front, and waits for others to finish if it
+      doesn't fit.
+
+      Texels are RGBA8, with row 0 at the bottom (ie, flipped with
+      respect to the image file, which happens while decoding). All
+      methods are thread-safe, except for setMemoryBudget(). */
+  class TextureCache {
+  public:
+    enum { TILE_SIZE = 64 };
+
+    /*! memoryBudget is the maximum number of bytes of resident tiles
+        plus images being decoded */
+    TextureCache(size_t memoryBudget = size_t(512) << 20);
+    /*! waits for outstanding prefetches */
+    ~TextureCache();
+
+    /*! register the given image file, and return its texture ID; does
+        not touch the file */
+    int addTexture(const std::string &fileName);
+
+    /*! number of registered textures */
+    size_t size() const;
+
+    /*! the file the given texture was registered with */
+    std::string fileName(int textureID) const;
+
+    /*! change the memory budget, releasing tiles if required. Must not
+        run concurrently with fetch() or sample(), since those may be
+        reading the tiles that get released */
+    void setMemoryBudget(size_t memoryBudget);
+
+    /*! bytes currently used by resident tiles */
+    size_t memoryUsage() const;
+
+    /*! resolution of the texture's finest level, or (0,0) if the file
+        can't be read. Only reads the image header */
+    vec2i resolution(int textureID);
+
+    /*! number of mip levels, or 0 if the file can't be read */
+    int numLevels(int textureID);
+
+    /*! texel of the given level, with wrap-around addressing; opaque
+        white if the texture can't be read */
+    uint32_t fetch(int textureID, int level, int x, int y);
+
+    /*! bilinearly filtered, wrapped lookup at uv in the mip level
+        closest to lod (0 = finest); RGBA in [0,1] */
+    vec4f sample(int textureID, const vec2f &uv, float lod = 0.f);
+
+    /*! start building the texture's pyramid in the background, and
+        bring in as much of its finest level as fits into the budget
+        without evicting any other tile */
+    void prefetch(int textureID);
+
+    /*! block until all prefetches started so far are done */
+    void waitForPrefetches();
+
+    /*! the given level in full, eg for uploading the texture somewhere
+        else; read from the spill file, without caching it */
+    bool readLevel(int textureID, int level,
+                   std::vector<uint32_t> &pixels, vec2i &res);
+
+  private:
+    struct Level {
+      vec2i  res;
+      vec2i  numTiles;
+      /*! index of this level's first tile in TextureInfo::tiles */
+      size_t firstTile;
+    };
+
+    /*! TileSlot::owner of a slot that holds no tile */
+    static constexpr uint64_t NO_OWNER = ~uint64_t(0);
+
+    /*! storage for one resident tile. sequence is odd while the slot
+        gets (re-)filled, and owner says which tile it holds */
+    struct TileSlot {
+      std::atomic<uint64_t> sequence   { 0 };
+      std::atomic<uint64_t> owner      { NO_OWNER };
+      /*! set by every lookup, cleared by the eviction clock */
+      std::atomic<uint8_t>  referenced { 0 };
+      uint32_t              texels[TILE_SIZE*TILE_SIZE];
+    };
+    struct TextureInfo {
+      std::string        fileName;
+      /*! serializes reading the header and building the pyramid, so
+          that the same file never gets decoded by two threads */
+      std::mutex         loadMutex;
+      std::atomic<bool>  hasInfo    { false };
+      std::atomic<bool>  hasPyramid { false };
+      bool               pyramidFailed { false };
+      std::vector<Level> levels;
+      /*! offset of the texture's first tile in the spill file */
+      uint64_t           spillOffset { 0 };
+      size_t             numTiles    { 0 };
+      /*! slot per tile of all levels; null if not resident (but a
+          non-null slot may hold some other tile by now) */
+      std::unique_ptr<std::atomic<TileSlot *>[]> tiles;
+    };
+
+    enum { TEXTURES_PER_CHUNK = 1024, MAX_TEXTURE_CHUNKS = 4096 };
+
+    /*! the given texture, or null if the ID is invalid */
+    TextureInfo *getTexture(int textureID) const;
+
+    /*! read the header and set up the level/tile layout, if not done
+        yet; returns false if the file can't be read */
+    bool ensureInfo(TextureInfo &texture);
+
+    /*! decode the file and write its pyramid to the spill file, if
+        not done yet; returns false if the file can't be read */
+    bool ensurePyramid(TextureInfo &texture);
+
+    /*! the texel, if its tile is resident; marks the tile as used */
+    bool lookup(TextureInfo &texture, int textureID,
+                int level, int x, int y, uint32_t &texel) const;
+
+    /*! read the given tile from the spill file */
+    void readTile(const TextureInfo &texture, size_t tileID,
+                  uint32_t *texels);
+
+    /*! make the given tile resident, and return its texel */
+    uint32_t loadTile(TextureInfo &texture, int textureID,
+                      int level, int x, int y);
+
+    /*! put the tile's texels into a slot, unless it is resident
+        already; returns false if that would take evicting another tile
+        and mayEvict isn't set. Must be called with mutex held */
+    bool insertTile(TextureInfo &texture, int textureID, size_t tileID,
+                    const uint32_t *texels, bool mayEvict);
+
+    /*! a slot to put a new tile into: a fresh one while within
+        budget, otherwise the one the eviction clock picks (or null, if
+        not mayEvict); must be called with mutex held */
+    TileSlot *allocateSlot(bool mayEvict);
+
+    /*! pick a resident tile that hasn't been used since the clock
+        last passed it, and evict it; must be called with mutex held */
+    TileSlot *evictTile();
+
+    /*! block until the given number of bytes for decoding fit into
+        the budget next to the resident tiles, or nothing else is
+        being decoded; and reserve them */
+    void reserveDecode(size_t bytes);
+    void releaseDecode(size_t bytes);
+
+    mutable std::mutex                        mutex;
+    std::condition_variable                   decodeDone;
+    std::unique_ptr<TextureInfo>              *textureChunks[MAX_TEXTURE_CHUNKS] = {};
+    std::atomic<size_t>                       numTextures { 0 };
+    /*! all tile slots, in the order the eviction clock visits them */
+    std::vector<std::unique_ptr<TileSlot>>    slots;
+    size_t                                    clockHand { 0 };
+    size_t                                    memoryBudget;
+    size_t                                    residentBytes { 0 };
+    size_t                                    decodingBytes { 0 };
+
+    /*! all textures' pyramids, one after the other */
+    std::mutex                                spillMutex;
+    FILE                                     *spillFile { nullptr };
+    uint64_t                                  spillSize { 0 };
+
+    tbb::task_group                           prefetches;
+  };
+
+} // ::osc
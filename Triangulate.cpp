@@ -0,0 +1,245 @@
+// ======================================================================== //
+// Copyright 2018-2024 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "Triangulate.h"
+//std
+#include <algorithm>
+#include <cmath>
+#include <tbb/parallel_for.h>
+#include <vector>
+
+/*! \namespace osc - Optix Siggraph Course */
+namespace osc {
+
+  /*! faces per parallel work item */
+  static const size_t FACES_PER_CHUNK = 8192;
+
+  /*! a run of consecutive faces, and where its corners and triangles
+      start */
+  struct FaceChunk {
+    size_t firstFace;
+    size_t firstCorner;
+    size_t firstTriangle;
+    /*! triangles actually written, which is fewer than reserved if
+        some faces were invalid */
+    size_t numWritten;
+  };
+
+  /*! split the mesh's faces into chunks, with their first corner and
+      first triangle; returns the total number of triangles */
+  static size_t makeChunks(const PolygonMesh &mesh,
+                           std::vector<FaceChunk> &chunks)
+  {
+    chunks.resize((mesh.numFaces + FACES_PER_CHUNK - 1) / FACES_PER_CHUNK);
+    // sizes first, in parallel, then turned into offsets
+    tbb::parallel_for(size_t(0),chunks.size(),[&](size_t chunkID) {
+        FaceChunk &chunk = chunks[chunkID];
+        chunk.firstFace = chunkID * FACES_PER_CHUNK;
+        const size_t end
+          = std::min(chunk.firstFace + FACES_PER_CHUNK,mesh.numFaces);
+        size_t numCorners = 0, numTriangles = 0;
+        for (size_t f=chunk.firstFace;f<end;f++) {
+          const int count = std::max(mesh.faceVertexCounts[f],0);
+          numCorners   += count;
+          numTriangles += std::max(count-2,0);
+        }
+        chunk.firstCorner   = numCorners;
+        chunk.firstTriangle = numTriangles;
+      });
+    size_t corner = 0, triangle = 0;
+    for (FaceChunk &chunk : chunks) {
+      std::swap(corner,  chunk.firstCorner);
+      std::swap(triangle,chunk.firstTriangle);
+      corner   += chunk.firstCorner;
+      triangle += chunk.firstTriangle;
+    }
+    return triangle;
+  }
+
+  size_t maxTriangles(const PolygonMesh &mesh)
+  {
+    std::vector<FaceChunk> chunks;
+    return makeChunks(mesh,chunks);
+  }
+
+  /*! twice the signed area of triangle abc; positive if it's
+      counter-clockwise */
+  inline float orient2D(const vec2f &a, const vec2f &b, const vec2f &c)
+  {
+    return (b.x-a.x)*(c.y-a.y) - (b.y-a.y)*(c.x-a.x);
+  }
+
+  /*! per-thread buffers for ear clipping, which only ever grow */
+  struct EarScratch {
+    std::vector<vec2f> p;
+    std::vector<int>   prev, next;
+  };
+
+  /*! writes the triangles of one face, and returns how many; 0 if the
+      face is invalid */
+  static int triangulateFace(const PolygonMesh &mesh,
+                             size_t firstCorner, int count,
+                             int flags, vec3i *out)
+  {
+    if (count < 3 || firstCorner + count > mesh.numCorners)
+      return 0;
+    const int *pointIDs = mesh.faceVertexIndices + firstCorner;
+    for (int i=0;i<count;i++)
+      if (pointIDs[i] < 0 || size_t(pointIDs[i]) >= mesh.numPoints)
+        return 0;
+
+    int numTriangles = 0;
+    // a, b and c are numbers of corners within the face
+    auto emit = [&](int a, int b, int c) {
+      vec3i t = (flags & TRIANGULATE_CORNERS)
+        ? vec3i(int(firstCorner)+a,int(firstCorner)+b,int(firstCorner)+c)
+        : vec3i(pointIDs[a],pointIDs[b],pointIDs[c]);
+      if (flags & TRIANGULATE_FLIP) std::swap(t.y,t.z);
+      out[numTriangles++] = t;
+    };
+    auto fan = [&]() {
+      for (int i=1;i+1<count;i++) emit(0,i,i+1);
+      return numTriangles;
+    };
+    if (count == 3) return fan();
+
+    // project into the plane of the Newell normal, by dropping its
+    // dominant axis; mirrored if need be, so the face is
+    // counter-clockwise in 2D
+    vec3f n(0.f);
+    for (int i=0;i<count;i++) {
+      const vec3f &a = mesh.points[pointIDs[i]];
+      const vec3f &b = mesh.points[pointIDs[(i+1) % count]];
+      n.x += (a.y-b.y)*(a.z+b.z);
+      n.y += (a.z-b.z)*(a.x+b.x);
+      n.z += (a.x-b.x)*(a.y+b.y);
+    }
+    const vec3f absN(fabsf(n.x),fabsf(n.y),fabsf(n.z));
+    const int axis = (absN.x >= absN.y)
+      ? (absN.x >= absN.z ? 0 : 2)
+      : (absN.y >= absN.z ? 1 : 2);
+    // degenerate faces have no inside to clip ears from
+    if (n[axis] == 0.f) return fan();
+    const int   u = (axis+1) % 3, v = (axis+2) % 3;
+    const float mirror = n[axis] < 0.f ? -1.f : 1.f;
+
+    static thread_local EarScratch scratch;
+    if (scratch.p.size() < size_t(count)) {
+      scratch.p.resize(count);
+      scratch.prev.resize(count);
+      scratch.next.resize(count);
+    }
+    vec2f *p    = scratch.p.data();
+    int   *prev = scratch.prev.data();
+    int   *next = scratch.next.data();
+    for (int i=0;i<count;i++) {
+      const vec3f &q = mesh.points[pointIDs[i]];
+      p[i]    = vec2f(q[u],mirror*q[v]);
+      prev[i] = (i+count-1) % count;
+      next[i] = (i+1) % count;
+    }
+
+    bool convex = true;
+    for (int i=0;convex && i<count;i++)
+      convex = orient2D(p[prev[i]],p[i],p[next[i]]) >= 0.f;
+    if (convex) return fan();
+
+    // corner i is an ear if it's convex, and no other remaining corner
+    // lies within (or on) the triangle it'd cut off. Corners at the
+    // same position as the ear's, as in faces with holes cut in via
+    // a bridge edge, don't count
+    auto isEar = [&](int i) {
+      const int a = prev[i], c = next[i];
+      if (orient2D(p[a],p[i],p[c]) <= 0.f) return false;
+      for (int j=next[c];j!=a;j=next[j]) {
+        const vec2f &q = p[j];
+        if (q == p[a] || q == p[i] || q == p[c]) continue;
+        if (orient2D(p[a],p[i],q) >= 0.f
+            && orient2D(p[i],p[c],q) >= 0.f
+            && orient2D(p[c],p[a],q) >= 0.f)
+          return false;
+      }
+      return true;
+    };
+
+    int remaining = count, i = 0, sinceLastEar = 0;
+    while (remaining > 3) {
+      // self-intersecting or numerically degenerate faces may have
+      // no ear left; clip anyway, so every face still gets n-2
+      // triangles
+      if (isEar(i) || sinceLastEar >= remaining) {
+        const int a = prev[i], c = next[i];
+        emit(a,i,c);
+        next[a] = c;
+        prev[c] = a;
+        --remaining;
+        sinceLastEar = 0;
+        // a's the corner whose ear-ness changed the most
+        i = a;
+      } else {
+        i = next[i];
+        ++sinceLastEar;
+      }
+    }
+    emit(prev[i],i,next[i]);
+    return numTriangles;
+  }
+
+  size_t triangulate(const PolygonMesh &mesh,
+                     vec3i *triangles,
+                     int   *triangleFaces,
+                     int    flags)
+  {
+    std::vector<FaceChunk> chunks;
+    makeChunks(mesh,chunks);
+
+    tbb::parallel_for(size_t(0),chunks.size(),[&](size_t chunkID) {
+        FaceChunk &chunk = chunks[chunkID];
+        const size_t end
+          = std::min(chunk.firstFace + FACES_PER_CHUNK,mesh.numFaces);
+        size_t corner = chunk.firstCorner, written = 0;
+        for (size_t f=chunk.firstFace;f<end;f++) {
+          const int count = std::max(mesh.faceVertexCounts[f],0);
+          const size_t begin = chunk.firstTriangle + written;
+          const int n = triangulateFace(mesh,corner,count,flags,
+                                        triangles + begin);
+          if (triangleFaces)
+            std::fill(triangleFaces + begin,triangleFaces + begin + n,int(f));
+          written += n;
+          corner  += count;
+        }
+        chunk.numWritten = written;
+      });
+
+    // dropped faces leave gaps at the ends of their chunks; close them
+    size_t numTriangles = 0;
+    for (const FaceChunk &chunk : chunks) {
+      // moves are towards the front, so copying forward is safe
+      if (chunk.firstTriangle != numTriangles) {
+        std::copy(triangles + chunk.firstTriangle,
+                  triangles + chunk.firstTriangle + chunk.numWritten,
+                  triangles + numTriangles);
+        if (triangleFaces)
+          std::copy(triangleFaces + chunk.firstTriangle,
+                    triangleFaces + chunk.firstTriangle + chunk.numWritten,
+                    triangleFaces + numTriangles);
+      }
+      numTriangles += chunk.numWritten;
+    }
+    return numTriangles;
+  }
+
+} // ::osc
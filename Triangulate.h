@@ -0,0 +1,72 @@
+// ======================================================================== //
+// Copyright 2018-2024 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#pragma once
+
+#include "gdt/math/vec.h"
+//std
+#include <cstddef>
+
+/*! \namespace osc - Optix Siggraph Course */
+namespace osc {
+  using namespace gdt;
+
+  /*! polygons in USD's (and most other formats') layout: face f has
+      faceVertexCounts[f] corners, whose point indices follow each
+      other in faceVertexIndices. Only points' positions are looked
+      at, to tell convex faces from concave ones */
+  struct PolygonMesh {
+    const int   *faceVertexCounts  { nullptr };
+    size_t       numFaces          { 0 };
+    const int   *faceVertexIndices { nullptr };
+    size_t       numCorners        { 0 };
+    const vec3f *points            { nullptr };
+    size_t       numPoints         { 0 };
+  };
+
+  enum {
+    /*! emit triangles with reversed winding, eg for leftHanded meshes */
+    TRIANGULATE_FLIP    = 1,
+    /*! emit corner indices (positions in faceVertexIndices) rather
+        than point indices, for face-varying data */
+    TRIANGULATE_CORNERS = 2
+  };
+
+  /*! number of triangles triangulate() emits at most, ie, the size
+      its output arrays need to have */
+  size_t maxTriangles(const PolygonMesh &mesh);
+
+  /*! triangulate all faces of the mesh into the given, preallocated
+      arrays (of maxTriangles() entries), and return the number of
+      triangles written. triangleFaces, if given, receives the face
+      each triangle came from.
+
+      Convex faces get fanned; concave ones get ear-clipped in the
+      plane of their (Newell) normal, so they don't fold over
+      themselves. Either way, a face of n corners becomes n-2
+      triangles of the face's winding (or the reverse, with
+      TRIANGULATE_FLIP). Faces with fewer than three corners, or with
+      point indices out of range, are dropped.
+
+      Faces get triangulated in parallel chunks; nothing gets
+      allocated per face, except when ear-clipping a face larger than
+      any seen before on that thread. */
+  size_t triangulate(const PolygonMesh &mesh,
+                     vec3i *triangles,
+                     int   *triangleFaces = nullptr,
+                     int    flags = 0);
+
+} // ::osc
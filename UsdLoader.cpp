@@ -0,0 +1,304 @@
+// ======================================================================== //
+// Copyright 2018-2024 Ingo Wald                                            //
+//                                                                          //
+// Licensed under the Apache License, Version 2.0 (the "License");          //
+// you may not use this file except in compliance with the License.         //
+// You may obtain a copy of the License at                                  //
+//                                                                          //
+//     http://www.apache.org/licenses/LICENSE-2.0                           //
+//                                                                          //
+// Unless required by applicable law or agreed to in writing, software      //
+// distributed under the License is distributed on an "AS IS" BASIS,        //
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. //
+// See the License for the specific language governing permissions and      //
+// limitations under the License.                                           //
+// ======================================================================== //
+
+#include "Model.h"
+#include "MeshArena.h"
+#include "Triangulate.h"
+
+#include "pxr/usd/usd/primRange.h"
+#include "pxr/usd/usd/stage.h"
+#include "pxr/usd/usdGeom/mesh.h"
+#include "pxr/usd/usdGeom/primvarsAPI.h"
+#include "pxr/usd/usdGeom/tokens.h"
+#include "pxr/usd/usdGeom/xformCache.h"
+#include "pxr/usd/usdShade/materialBindingAPI.h"
+#include "pxr/usd/usdShade/shader.h"
+#include "pxr/usd/sdf/assetPath.h"
+#include "pxr/base/tf/staticTokens.h"
+//std
+#include <map>
+#include <stdexcept>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+
+PXR_NAMESPACE_USING_DIRECTIVE
+
+TF_DEFINE_PRIVATE_TOKENS(
+  usdTokens,
+  (UsdPreviewSurface)
+  (UsdUVTexture)
+  (diffuseColor)
+  (file)
+  (normals)
+  (st)
+);
+
+/*! \namespace osc - Optix Siggraph Course */
+namespace osc {
+
+  /*! what a mesh's UsdPreviewSurface says about its diffuse color */
+  struct UsdDiffuse {
+    vec3f       color { .8f };
+    /*! resolved path of the diffuse texture, if any */
+    std::string textureFile;
+  };
+
+  /*! diffuse color and texture of the material bound to the prim, if
+      that's a UsdPreviewSurface; the prim's displayColor otherwise */
+  static UsdDiffuse readDiffuse(const UsdGeomMesh &mesh)
+  {
+    UsdDiffuse diffuse;
+    VtVec3fArray displayColor;
+    if (mesh.GetDisplayColorPrimvar().Get(&displayColor)
+        && !displayColor.empty())
+      diffuse.color = (const vec3f &)displayColor[0];
+
+    const UsdShadeMaterial material
+      = UsdShadeMaterialBindingAPI(mesh.GetPrim()).ComputeBoundMaterial();
+    if (!material) return diffuse;
+    const UsdShadeShader surface = material.ComputeSurfaceSource();
+    TfToken shaderID;
+    if (!surface || !surface.GetShaderId(&shaderID)
+        || shaderID != usdTokens->UsdPreviewSurface)
+      return diffuse;
+
+    const UsdShadeInput input = surface.GetInput(usdTokens->diffuseColor);
+    if (!input) return diffuse;
+    const UsdShadeSourceInfoVector sources
+      = input.GetConnectedSources();
+    if (!sources.empty()) {
+      const UsdShadeShader texture(sources[0].source.GetPrim());
+      const UsdShadeInput  fileInput
+        = texture ? texture.GetInput(usdTokens->file) : UsdShadeInput();
+      SdfAssetPath file;
+      if (fileInput && texture.GetShaderId(&shaderID)
+          && shaderID == usdTokens->UsdUVTexture
+          && fileInput.Get(&file)) {
+        diffuse.textureFile = file.GetResolvedPath().empty()
+          ? file.GetAssetPath() : file.GetResolvedPath();
+        diffuse.color = vec3f(1.f);
+      }
+    } else {
+      GfVec3f color;
+      if (input.Get(&color))
+        diffuse.color = vec3f(color[0],color[1],color[2]);
+    }
+    return diffuse;
+  }
+
+  /*! a primvar's values and interpolation, with indexed primvars
+      flattened; false if there isn't one of the expected type */
+  template<typename ArrayT>
+  static bool readPrimvar(const UsdGeomPrimvar &primvar,
+                          ArrayT &values, TfToken &interpolation)
+  {
+    if (!primvar || !primvar.HasValue()
+        || !primvar.ComputeFlattened(&values) || values.empty())
+      return false;
+    interpolation = primvar.GetInterpolation();
+    return true;
+  }
+
+  /*! whether per-point or per-corner values are usable for numPoints
+      points and numCorners corners */
+  static bool validInterpolation(const TfToken &interpolation,
+                                 size_t numValues,
+                                 size_t numPoints, size_t numCorners)
+  {
+    if (interpolation == UsdGeomTokens->vertex
+        || interpolation == UsdGeomTokens->varying)
+      return numValues == numPoints;
+    if (interpolation == UsdGeomTokens->faceVarying)
+      return numValues == numCorners;
+    return false;
+  }
+
+  /*! convert one UsdGeomMesh into scratch, triangulating its faces
+      and baking its world transform into points and normals. If any
+      attribute is face-varying, every face corner becomes a vertex of
+      its own; otherwise, the mesh's points are the vertices */
+  static void convertMesh(const UsdGeomMesh &usdMesh,
+                          const GfMatrix4d &xfm,
+                          TriangleMesh &mesh)
+  {
+    mesh.vertex.clear();
+    mesh.normal.clear();
+    mesh.texcoord.clear();
+    mesh.index.clear();
+
+    VtVec3fArray points;
+    VtIntArray   faceVertexCounts, faceVertexIndices;
+    if (!usdMesh.GetPointsAttr().Get(&points)
+        || !usdMesh.GetFaceVertexCountsAttr().Get(&faceVertexCounts)
+        || !usdMesh.GetFaceVertexIndicesAttr().Get(&faceVertexIndices)
+        || points.empty())
+      return;
+    const size_t numPoints  = points.size();
+    const size_t numCorners = faceVertexIndices.size();
+
+    // normals: the primvar wins over the attribute, as per the schema
+    VtVec3fArray normals;
+    TfToken      normalInterpolation;
+    const UsdGeomPrimvarsAPI primvars(usdMesh.GetPrim());
+    if (!readPrimvar(primvars.GetPrimvar(usdTokens->normals),
+                     normals,normalInterpolation)) {
+      usdMesh.GetNormalsAttr().Get(&normals);
+      normalInterpolation = usdMesh.GetNormalsInterpolation();
+    }
+    if (!validInterpolation(normalInterpolation,normals.size(),
+                            numPoints,numCorners))
+      normals.clear();
+
+    VtVec2fArray st;
+    TfToken      stInterpolation;
+    if (!readPrimvar(primvars.GetPrimvar(usdTokens->st),st,stInterpolation)
+        || !validInterpolation(stInterpolation,st.size(),numPoints,numCorners))
+      st.clear();
+
+    const bool perCorner
+      = (!normals.empty() && normalInterpolation == UsdGeomTokens->faceVarying)
+      || (!st.empty()     && stInterpolation     == UsdGeomTokens->faceVarying);
+    TfToken orientation;
+    usdMesh.GetOrientationAttr().Get(&orientation);
+    const bool flip = (orientation == UsdGeomTokens->leftHanded);
+
+    // triangulate, in corner indices
+    const PolygonMesh polygons = {
+      faceVertexCounts.cdata(),  faceVertexCounts.size(),
+      faceVertexIndices.cdata(), numCorners,
+      (const vec3f *)points.cdata(), numPoints
+    };
+    std::vector<vec3i> corners(maxTriangles(polygons));
+    corners.resize(triangulate(polygons,corners.data(),nullptr,
+                               TRIANGULATE_CORNERS
+                               | (flip ? TRIANGULATE_FLIP : 0)));
+
+    const GfMatrix4d normalXfm = xfm.GetInverse().GetTranspose();
+    auto xfmPoint = [&](const GfVec3f &p) {
+      const GfVec3d w = xfm.Transform(GfVec3d(p));
+      return vec3f(float(w[0]),float(w[1]),float(w[2]));
+    };
+    auto xfmNormal = [&](const GfVec3f &n) {
+      const GfVec3d w = normalXfm.TransformDir(GfVec3d(n));
+      return normalize(vec3f(float(w[0]),float(w[1]),float(w[2])));
+    };
+    // the value for the given corner, from per-point or per-corner data
+    auto pick = [&](const auto &values, const TfToken &interpolation,
+                    size_t cornerID) -> const auto & {
+      return interpolation == UsdGeomTokens->faceVarying
+        ? values[cornerID]
+        : values[faceVertexIndices[cornerID]];
+    };
+
+    if (perCorner) {
+      mesh.vertex.resize(numCorners);
+      if (!normals.empty()) mesh.normal.resize(numCorners);
+      if (!st.empty())      mesh.texcoord.resize(numCorners);
+      for (size_t c=0;c<numCorners;c++) {
+        const int pointID = faceVertexIndices[c];
+        if (pointID < 0 || size_t(pointID) >= numPoints) continue;
+        mesh.vertex[c] = xfmPoint(points[pointID]);
+        if (!normals.empty())
+          mesh.normal[c] = xfmNormal(pick(normals,normalInterpolation,c));
+        if (!st.empty())
+          mesh.texcoord[c] = (const vec2f &)pick(st,stInterpolation,c);
+      }
+      mesh.index.assign(corners.begin(),corners.end());
+    } else {
+      mesh.vertex.resize(numPoints);
+      for (size_t p=0;p<numPoints;p++)
+        mesh.vertex[p] = xfmPoint(points[p]);
+      if (!normals.empty()) {
+        mesh.normal.resize(numPoints);
+        for (size_t p=0;p<numPoints;p++)
+          mesh.normal[p] = xfmNormal(normals[p]);
+      }
+      if (!st.empty())
+        mesh.texcoord.assign((const vec2f *)st.cdata(),
+                             (const vec2f *)st.cdata()+numPoints);
+      mesh.index.resize(corners.size());
+      for (size_t i=0;i<corners.size();i++)
+        mesh.index[i] = vec3i(faceVertexIndices[corners[i].x],
+                              faceVertexIndices[corners[i].y],
+                              faceVertexIndices[corners[i].z]);
+    }
+  }
+
+  Model *loadUSD(const std::string &usdFile)
+  {
+    const UsdStageRefPtr stage = UsdStage::Open(usdFile);
+    if (!stage)
+      throw std::runtime_error("Could not open USD stage "+usdFile);
+
+    // find all visible meshes (including those in instances) first;
+    // that's cheap, the conversion is what gets parallelized
+    std::vector<UsdGeomMesh> usdMeshes;
+    for (const UsdPrim &prim
+           : UsdPrimRange::Stage(stage,UsdTraverseInstanceProxies())) {
+      if (!prim.IsA<UsdGeomMesh>()) continue;
+      const UsdGeomMesh usdMesh(prim);
+      if (usdMesh.ComputeVisibility() == UsdGeomTokens->invisible)
+        continue;
+      usdMeshes.push_back(usdMesh);
+    }
+
+    std::unique_ptr<Model> model(new Model);
+    model->arena = std::make_shared<MeshArena>();
+
+    // xform caches aren't thread-safe, but are worth keeping per thread
+    tbb::enumerable_thread_specific<UsdGeomXformCache> xformCaches;
+    tbb::enumerable_thread_specific<TriangleMesh>      scratchMeshes;
+    std::vector<TriangleMesh *> meshes(usdMeshes.size(),nullptr);
+    std::vector<UsdDiffuse>     diffuse(usdMeshes.size());
+    tbb::parallel_for(size_t(0),usdMeshes.size(),[&](size_t meshID) {
+        const UsdGeomMesh &usdMesh = usdMeshes[meshID];
+        TriangleMesh &scratch = scratchMeshes.local();
+        convertMesh(usdMesh,
+                    xformCaches.local().GetLocalToWorldTransform(usdMesh.GetPrim()),
+                    scratch);
+        if (scratch.index.empty()) return;
+        meshes[meshID]  = model->arena->packMesh(scratch);
+        diffuse[meshID] = readDiffuse(usdMesh);
+      });
+
+    // register textures serially, in prim order, so IDs are stable
+    std::map<std::string,int> knownTextures;
+    for (size_t meshID=0;meshID<meshes.size();meshID++) {
+      TriangleMesh *mesh = meshes[meshID];
+      if (!mesh) continue;
+      mesh->diffuse = diffuse[meshID].color;
+      const std::string &textureFile = diffuse[meshID].textureFile;
+      if (!textureFile.empty()) {
+        auto it = knownTextures.find(textureFile);
+        if (it == knownTextures.end()) {
+          it = knownTextures.insert({textureFile,
+                                     model->textures->addTexture(textureFile)}).first;
+          model->textures->prefetch(it->second);
+        }
+        mesh->diffuseTextureID = it->second;
+      }
+      model->meshes.push_back(mesh);
+    }
+    computeBounds(model.get());
+    model->textures->waitForPrefetches();
+
+    std::cout << "loaded USD stage " << usdFile << " - "
+              << model->meshes.size() << " meshes, "
+              << model->textures->size() << " textures" << std::endl;
+    return model.release();
+  }
+
+} // ::osc
@@ -0,0 +1,39 @@
+// ============================================================================
+// 仿真状态检查点环
+// ============================================================================
+#include "checkpointRing.h"
+
+void CheckpointRing::Reset(const mjModel* m, int capacity)
+{
+    this->capacity = capacity > 0 ? capacity : 0;
+    stateSize = mj_stateSize(m, STATE);
+    states.assign(size_t(stateSize) * this->capacity, 0);
+    steps.assign(this->capacity, 0);
+    head = 0;
+    count = 0;
+}
+
+void CheckpointRing::Save(const mjModel* m, const mjData* d, uint64_t step)
+{
+    if (capacity == 0)
+        return;
+    mj_getState(m, d, states.data() + size_t(head) * stateSize, STATE);
+    steps[head] = step;
+    head = (head + 1) % capacity;
+    if (count < capacity)
+        ++count;
+}
+
+bool CheckpointRing::Restore(const mjModel* m, mjData* d, int back, uint64_t* step)
+{
+    if (back < 0 || back >= count || mj_stateSize(m, STATE) != stateSize)
+        return false;
+    const int index = Index(back);
+    mj_setState(m, d, states.data() + size_t(index) * stateSize, STATE);
+    // 恢复出来的状态本身留着，可以反复回到同一点
+    head = (index + 1) % capacity;
+    count -= back;
+    if (step)
+        *step = steps[index];
+    return true;
+}
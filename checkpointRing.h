@@ -0,0 +1,45 @@
+// ============================================================================
+// 仿真状态检查点环：定期保存 mjData 的状态向量，随时回退
+// ============================================================================
+#pragma once
+
+#include <mujoco/mujoco.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 只保存 mj_getState(mjSTATE_INTEGRATION) 的状态向量（时间、qpos、qvel、
+// act、warmstart、控制和外力等），不拷整个 mjData。存储在 Reset 时一次
+// 分配好，之后 Save 只是一次 mj_getState，满了覆盖最旧的。
+//
+// mjSTATE_INTEGRATION 包含了积分需要的全部输入，从检查点恢复后继续步进
+// 和当初的结果逐位一致。
+class CheckpointRing {
+public:
+    static constexpr int STATE = mjSTATE_INTEGRATION;
+
+    // 按模型的状态大小分配 capacity 个检查点，并清空
+    void Reset(const mjModel* m, int capacity);
+    void Clear() { count = 0; }
+
+    void Save(const mjModel* m, const mjData* d, uint64_t step);
+    // 恢复到倒数第 back 个检查点（0 是最近的），比它新的检查点作废，
+    // 因为之后的历史可能会不一样
+    bool Restore(const mjModel* m, mjData* d, int back, uint64_t* step);
+
+    int Size() const { return count; }
+    // 最近一个检查点的步数
+    uint64_t LatestStep() const { return count ? steps[Index(0)] : 0; }
+    int Capacity() const { return capacity; }
+
+private:
+    int Index(int back) const { return (head + capacity - 1 - back) % capacity; }
+
+    std::vector<mjtNum> states;
+    std::vector<uint64_t> steps;
+    int stateSize = 0;
+    int capacity = 0;
+    // 下一个要写的位置，和已有的检查点数
+    int head = 0;
+    int count = 0;
+};
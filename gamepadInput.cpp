@@ -0,0 +1,294 @@
+// ============================================================================
+// 手柄输入线程
+// ============================================================================
+#include "gamepadInput.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <linux/input.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+static double Now()
+{
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static double EventTime(const input_event& ev)
+{
+    return double(ev.input_event_sec) + 1e-6 * double(ev.input_event_usec);
+}
+
+// 摇杆的微小抖动不算变化，免得每个报告都推一个事件
+static bool Changed(const GLFWgamepadstate& a, const GLFWgamepadstate& b)
+{
+    if (std::memcmp(a.buttons, b.buttons, sizeof(a.buttons)) != 0)
+        return true;
+    for (int i = 0; i <= GLFW_GAMEPAD_AXIS_LAST; ++i)
+        if (std::fabs(a.axes[i] - b.axes[i]) > 1e-3f)
+            return true;
+    return false;
+}
+
+static bool TestBit(const unsigned long* bits, int bit)
+{
+    const int width = 8 * sizeof(unsigned long);
+    return (bits[bit / width] >> (bit % width)) & 1;
+}
+
+// evdev 按键 → GLFW 手柄按钮，不认识的返回 -1
+static int ButtonIndex(int code)
+{
+    switch (code)
+    {
+    case BTN_SOUTH: return GLFW_GAMEPAD_BUTTON_A;
+    case BTN_EAST: return GLFW_GAMEPAD_BUTTON_B;
+    case BTN_X: return GLFW_GAMEPAD_BUTTON_X;
+    case BTN_Y: return GLFW_GAMEPAD_BUTTON_Y;
+    case BTN_TL: return GLFW_GAMEPAD_BUTTON_LEFT_BUMPER;
+    case BTN_TR: return GLFW_GAMEPAD_BUTTON_RIGHT_BUMPER;
+    case BTN_SELECT: return GLFW_GAMEPAD_BUTTON_BACK;
+    case BTN_START: return GLFW_GAMEPAD_BUTTON_START;
+    case BTN_MODE: return GLFW_GAMEPAD_BUTTON_GUIDE;
+    case BTN_THUMBL: return GLFW_GAMEPAD_BUTTON_LEFT_THUMB;
+    case BTN_THUMBR: return GLFW_GAMEPAD_BUTTON_RIGHT_THUMB;
+    case BTN_DPAD_UP: return GLFW_GAMEPAD_BUTTON_DPAD_UP;
+    case BTN_DPAD_RIGHT: return GLFW_GAMEPAD_BUTTON_DPAD_RIGHT;
+    case BTN_DPAD_DOWN: return GLFW_GAMEPAD_BUTTON_DPAD_DOWN;
+    case BTN_DPAD_LEFT: return GLFW_GAMEPAD_BUTTON_DPAD_LEFT;
+    default: return -1;
+    }
+}
+
+// evdev 绝对轴 → GLFW 手柄轴，不认识的返回 -1（方向键的 HAT 另外处理）
+static int AxisIndex(int code)
+{
+    switch (code)
+    {
+    case ABS_X: return GLFW_GAMEPAD_AXIS_LEFT_X;
+    case ABS_Y: return GLFW_GAMEPAD_AXIS_LEFT_Y;
+    case ABS_RX: return GLFW_GAMEPAD_AXIS_RIGHT_X;
+    case ABS_RY: return GLFW_GAMEPAD_AXIS_RIGHT_Y;
+    case ABS_Z: return GLFW_GAMEPAD_AXIS_LEFT_TRIGGER;
+    case ABS_RZ: return GLFW_GAMEPAD_AXIS_RIGHT_TRIGGER;
+    default: return -1;
+    }
+}
+
+// 打开的手柄：文件描述符和各轴的取值范围
+struct GamepadDevice {
+    int fd = -1;
+    input_absinfo abs[ABS_CNT] = {};
+};
+
+static void SetKey(const GamepadDevice& pad, GLFWgamepadstate& state, int code, int value)
+{
+    const unsigned char action = value ? GLFW_PRESS : GLFW_RELEASE;
+    const int button = ButtonIndex(code);
+    if (button >= 0)
+        state.buttons[button] = action;
+    // 只有按键没有轴的扳机，按下算 1
+    else if (code == BTN_TL2 && pad.abs[ABS_Z].maximum == pad.abs[ABS_Z].minimum)
+        state.axes[GLFW_GAMEPAD_AXIS_LEFT_TRIGGER] = value ? 1.f : -1.f;
+    else if (code == BTN_TR2 && pad.abs[ABS_RZ].maximum == pad.abs[ABS_RZ].minimum)
+        state.axes[GLFW_GAMEPAD_AXIS_RIGHT_TRIGGER] = value ? 1.f : -1.f;
+}
+
+static void SetAbs(const GamepadDevice& pad, GLFWgamepadstate& state, int code, int value)
+{
+    if (code == ABS_HAT0X)
+    {
+        state.buttons[GLFW_GAMEPAD_BUTTON_DPAD_LEFT] = value < 0 ? GLFW_PRESS : GLFW_RELEASE;
+        state.buttons[GLFW_GAMEPAD_BUTTON_DPAD_RIGHT] = value > 0 ? GLFW_PRESS : GLFW_RELEASE;
+        return;
+    }
+    if (code == ABS_HAT0Y)
+    {
+        state.buttons[GLFW_GAMEPAD_BUTTON_DPAD_UP] = value < 0 ? GLFW_PRESS : GLFW_RELEASE;
+        state.buttons[GLFW_GAMEPAD_BUTTON_DPAD_DOWN] = value > 0 ? GLFW_PRESS : GLFW_RELEASE;
+        return;
+    }
+    const int axis = AxisIndex(code);
+    const input_absinfo& info = pad.abs[code];
+    if (axis < 0 || info.maximum == info.minimum)
+        return;
+    // [minimum, maximum] 映射到 [-1, 1]，和 GLFW 一样
+    const float t = float(value - info.minimum) / float(info.maximum - info.minimum);
+    state.axes[axis] = std::min(1.f, std::max(-1.f, 2.f * t - 1.f));
+}
+
+// 从设备读出当前的全部状态：刚打开时，以及内核丢了事件（SYN_DROPPED）之后
+static void ReadState(GamepadDevice& pad, GLFWgamepadstate& state)
+{
+    state = {};
+    state.axes[GLFW_GAMEPAD_AXIS_LEFT_TRIGGER] = -1.f;
+    state.axes[GLFW_GAMEPAD_AXIS_RIGHT_TRIGGER] = -1.f;
+
+    // 先读轴的范围：只有按键的扳机要靠它判断
+    for (int code : {ABS_X, ABS_Y, ABS_Z, ABS_RX, ABS_RY, ABS_RZ, ABS_HAT0X, ABS_HAT0Y})
+    {
+        if (ioctl(pad.fd, EVIOCGABS(code), &pad.abs[code]) < 0)
+            pad.abs[code] = {};
+        else
+            SetAbs(pad, state, code, pad.abs[code].value);
+    }
+
+    unsigned long keys[KEY_CNT / (8 * sizeof(unsigned long)) + 1] = {};
+    ioctl(pad.fd, EVIOCGKEY(sizeof(keys)), keys);
+    for (int code = BTN_GAMEPAD; code <= BTN_THUMBR; ++code)
+        SetKey(pad, state, code, TestBit(keys, code));
+    for (int code = BTN_DPAD_UP; code <= BTN_DPAD_RIGHT; ++code)
+        SetKey(pad, state, code, TestBit(keys, code));
+}
+
+// 打开一个有手柄按键（BTN_GAMEPAD）的 evdev 设备，时间戳改成单调时钟
+static bool OpenGamepad(const std::string& path, GamepadDevice& pad)
+{
+    const int fd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    unsigned long keys[KEY_CNT / (8 * sizeof(unsigned long)) + 1] = {};
+    int clock = CLOCK_MONOTONIC;
+    if (ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keys)), keys) < 0 || !TestBit(keys, BTN_GAMEPAD)
+        || ioctl(fd, EVIOCSCLOCKID, &clock) < 0)
+    {
+        close(fd);
+        return false;
+    }
+    char name[256] = "";
+    ioctl(fd, EVIOCGNAME(sizeof(name)), name);
+    std::cout << "Joystick/Gamepad found: " << name << " (" << path << ")" << std::endl;
+    pad = GamepadDevice();
+    pad.fd = fd;
+    return true;
+}
+
+static bool FindGamepad(const std::string& device, GamepadDevice& pad)
+{
+    if (!device.empty())
+        return OpenGamepad(device, pad);
+    std::vector<std::string> paths;
+    if (DIR* dir = opendir("/dev/input"))
+    {
+        while (dirent* entry = readdir(dir))
+            if (std::strncmp(entry->d_name, "event", 5) == 0)
+                paths.push_back(std::string("/dev/input/") + entry->d_name);
+        closedir(dir);
+    }
+    // event0、event1 … 按编号顺序，编号小的通常先接上
+    std::sort(paths.begin(), paths.end(), [](const std::string& a, const std::string& b)
+    {
+        return a.size() != b.size() ? a.size() < b.size() : a < b;
+    });
+    for (const std::string& path : paths)
+        if (OpenGamepad(path, pad))
+            return true;
+    return false;
+}
+
+GamepadInput::GamepadInput(const std::string& device)
+    : device(device)
+{
+    thread = std::thread(&GamepadInput::Run, this);
+}
+
+GamepadInput::~GamepadInput()
+{
+    running = false;
+    thread.join();
+}
+
+bool GamepadInput::Push(const GamepadEvent& event)
+{
+    if (queue.Push(event))
+        return true;
+    dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void GamepadInput::Run()
+{
+    GamepadDevice pad;
+    // current 是读到的最新状态，last 是最后推出去的
+    GamepadEvent current, last;
+    // 内核丢了事件（SYN_DROPPED）：到下一个 SYN_REPORT 之前的事件都不完整，
+    // 丢掉，到时候直接从设备读全部状态
+    bool dropping = false;
+    input_event events[64];
+    while (running.load(std::memory_order_relaxed))
+    {
+        if (pad.fd < 0)
+        {
+            if (!FindGamepad(device, pad))
+            {
+                // 分成小段睡，析构时不用等满一秒
+                for (int i = 0; i < 10 && running.load(std::memory_order_relaxed); ++i)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                continue;
+            }
+            current.connected = true;
+            current.time = Now();
+            dropping = false;
+            ReadState(pad, current.state);
+            if (Push(current))
+                last = current;
+        }
+
+        // 超时只是为了能及时退出
+        pollfd request = {pad.fd, POLLIN, 0};
+        if (poll(&request, 1, 100) <= 0)
+            continue;
+        const ssize_t size = read(pad.fd, events, sizeof(events));
+        if (size < 0)
+        {
+            if (errno == EAGAIN || errno == EINTR)
+                continue;
+            // 手柄拔掉了（ENODEV）
+            close(pad.fd);
+            pad.fd = -1;
+            current.connected = false;
+            current.time = Now();
+            if (Push(current))
+                last = current;
+            continue;
+        }
+
+        for (size_t i = 0; i < size_t(size) / sizeof(input_event); ++i)
+        {
+            const input_event& ev = events[i];
+            if (ev.type == EV_SYN && ev.code == SYN_DROPPED)
+                dropping = true;
+            else if (ev.type == EV_SYN && ev.code == SYN_REPORT)
+            {
+                if (dropping)
+                {
+                    ReadState(pad, current.state);
+                    dropping = false;
+                }
+                if (Changed(current.state, last.state) || !last.connected)
+                {
+                    current.time = EventTime(ev);
+                    if (Push(current))
+                        last = current;
+                }
+            }
+            else if (dropping)
+                continue;
+            else if (ev.type == EV_KEY)
+                SetKey(pad, current.state, ev.code, ev.value);
+            else if (ev.type == EV_ABS && ev.code < ABS_CNT)
+                SetAbs(pad, current.state, ev.code, ev.value);
+        }
+    }
+    if (pad.fd >= 0)
+        close(pad.fd);
+}
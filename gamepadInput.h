@@ -0,0 +1,51 @@
+// ============================================================================
+// 手柄输入线程：直接读 evdev 设备，带内核时间戳的事件放进无锁队列
+// ============================================================================
+#pragma once
+
+#include <GLFW/glfw3.h>
+#include "spscQueue.h"
+#include <atomic>
+#include <string>
+#include <thread>
+
+struct GamepadEvent {
+    // steady_clock 秒数，内核收到这次输入的时刻
+    double time = 0.0;
+    bool connected = false;
+    // GLFW 的手柄布局：按钮 GLFW_PRESS/GLFW_RELEASE，摇杆和扳机都在 [-1, 1]，
+    // 扳机松开时是 -1
+    GLFWgamepadstate state = {};
+};
+
+// 输入不跟渲染帧走：输入线程阻塞在手柄的 evdev 设备上，每个 SYN_REPORT 之后
+// 状态有变化（或连接状态变化）就推一个事件。时间戳用内核的（设成
+// CLOCK_MONOTONIC，和 steady_clock 是同一个时钟），不是线程读到它的时刻。
+// 消费者（主循环）每次物理步进前把队列取空，按时间顺序处理。
+//
+// 这个线程不调用任何 GLFW 函数：GLFW 的手柄函数只能在主线程调用，Linux 上
+// 主线程的 glfwPollEvents 还会在手柄插拔时打开、关闭设备，别的线程调用会和
+// 它竞争。这里自己打开 evdev 设备（evdev 允许多个读者），只借用 GLFW 的按钮、
+// 轴编号和 GLFWgamepadstate。按钮按 Linux 手柄驱动的标准编号映射（BTN_SOUTH
+// 是 A，BTN_EAST 是 B，BTN_X/BTN_Y 是 X/Y，xpad 等 Xbox 兼容手柄都这样报）。
+class GamepadInput {
+public:
+    // device 是 evdev 设备路径；为空时扫描 /dev/input/event*，用第一个手柄。
+    // 没有手柄或手柄断开时每秒重新找一次
+    explicit GamepadInput(const std::string& device = "");
+    ~GamepadInput();
+
+    bool Pop(GamepadEvent& event) { return queue.Pop(event); }
+    // 队列满时丢掉的事件数
+    size_t Dropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    void Run();
+    bool Push(const GamepadEvent& event);
+
+    const std::string device;
+    SpscQueue<GamepadEvent, 1024> queue;
+    std::atomic<size_t> dropped{0};
+    std::atomic<bool> running{true};
+    std::thread thread;
+};
@@ -0,0 +1,182 @@
+//
+// Copyright 2020 Pixar
+//
+// Licensed under the terms set forth in the LICENSE.txt file available at
+// https://openusd.org/license.
+//
+#include "instancer.h"
+
+#include "pxr/imaging/hd/perfLog.h"
+#include "pxr/imaging/hd/sceneDelegate.h"
+#include "pxr/imaging/hd/tokens.h"
+#include "pxr/imaging/hf/perfLog.h"
+#include "pxr/base/gf/quatd.h"
+#include "pxr/base/gf/quath.h"
+#include "pxr/base/gf/quatf.h"
+#include "pxr/base/gf/rotation.h"
+#include "pxr/base/gf/vec3f.h"
+#include "pxr/base/vt/types.h"
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+HdTinyInstancer::HdTinyInstancer(HdSceneDelegate* delegate,
+                                 SdfPath const& id)
+    : HdInstancer(delegate, id)
+{
+}
+
+HdTinyInstancer::~HdTinyInstancer() = default;
+
+void
+HdTinyInstancer::Sync(HdSceneDelegate *sceneDelegate,
+                      HdRenderParam   *renderParam,
+                      HdDirtyBits     *dirtyBits)
+{
+    _UpdateInstancer(sceneDelegate, dirtyBits);
+
+    if (HdChangeTracker::IsAnyPrimvarDirty(*dirtyBits, GetId())) {
+        _SyncPrimvars(sceneDelegate, *dirtyBits);
+    }
+}
+
+void
+HdTinyInstancer::_SyncPrimvars(HdSceneDelegate *delegate,
+                               HdDirtyBits dirtyBits)
+{
+    HD_TRACE_FUNCTION();
+    HF_MALLOC_TAG_FUNCTION();
+
+    SdfPath const& id = GetId();
+
+    HdPrimvarDescriptorVector primvars =
+        delegate->GetPrimvarDescriptors(id, HdInterpolationInstance);
+
+    for (HdPrimvarDescriptor const& pv: primvars) {
+        if (HdChangeTracker::IsPrimvarDirty(dirtyBits, id, pv.name)) {
+            VtValue value = delegate->Get(id, pv.name);
+            if (value.IsEmpty()) {
+                _primvarMap.erase(pv.name);
+            } else {
+                _primvarMap[pv.name] = value;
+            }
+        }
+    }
+}
+
+VtMatrix4dArray
+HdTinyInstancer::ComputeInstanceTransforms(SdfPath const &prototypeId)
+{
+    HD_TRACE_FUNCTION();
+    HF_MALLOC_TAG_FUNCTION();
+
+    // The transforms for this level of instancer are computed by:
+    // foreach(index : indices) {
+    //     instanceTransform(index) * scale(index) * rotate(index) *
+    //     translate(index) * instancerTransform
+    // }
+    // (in USD's row-vector convention).
+    GfMatrix4d instancerTransform =
+        GetDelegate()->GetInstancerTransform(GetId());
+    VtIntArray instanceIndices =
+        GetDelegate()->GetInstanceIndices(GetId(), prototypeId);
+
+    VtMatrix4dArray transforms(instanceIndices.size());
+    for (size_t i = 0; i < instanceIndices.size(); ++i) {
+        transforms[i] = instancerTransform;
+    }
+
+    auto primvar = [this](TfToken const& name) -> VtValue const* {
+        auto it = _primvarMap.find(name);
+        return it == _primvarMap.end() ? nullptr : &it->second;
+    };
+
+    if (VtValue const* value =
+            primvar(HdInstancerTokens->instanceTranslations)) {
+        if (value->IsHolding<VtVec3fArray>()) {
+            VtVec3fArray const& translates = value->UncheckedGet<VtVec3fArray>();
+            for (size_t i = 0; i < instanceIndices.size(); ++i) {
+                const size_t index = instanceIndices[i];
+                if (index >= translates.size()) continue;
+                GfMatrix4d translateMat(1);
+                translateMat.SetTranslate(GfVec3d(translates[index]));
+                transforms[i] = translateMat * transforms[i];
+            }
+        }
+    }
+
+    if (VtValue const* value =
+            primvar(HdInstancerTokens->instanceRotations)) {
+        for (size_t i = 0; i < instanceIndices.size(); ++i) {
+            const size_t index = instanceIndices[i];
+            GfQuatd quat;
+            if (value->IsHolding<VtQuathArray>()) {
+                VtQuathArray const& rotates = value->UncheckedGet<VtQuathArray>();
+                if (index >= rotates.size()) continue;
+                quat = GfQuatd(rotates[index]);
+            } else if (value->IsHolding<VtQuatfArray>()) {
+                VtQuatfArray const& rotates = value->UncheckedGet<VtQuatfArray>();
+                if (index >= rotates.size()) continue;
+                quat = GfQuatd(rotates[index]);
+            } else {
+                break;
+            }
+            GfMatrix4d rotateMat(1);
+            rotateMat.SetRotate(GfRotation(quat));
+            transforms[i] = rotateMat * transforms[i];
+        }
+    }
+
+    if (VtValue const* value =
+            primvar(HdInstancerTokens->instanceScales)) {
+        if (value->IsHolding<VtVec3fArray>()) {
+            VtVec3fArray const& scales = value->UncheckedGet<VtVec3fArray>();
+            for (size_t i = 0; i < instanceIndices.size(); ++i) {
+                const size_t index = instanceIndices[i];
+                if (index >= scales.size()) continue;
+                GfMatrix4d scaleMat(1);
+                scaleMat.SetScale(GfVec3d(scales[index]));
+                transforms[i] = scaleMat * transforms[i];
+            }
+        }
+    }
+
+    if (VtValue const* value =
+            primvar(HdInstancerTokens->instanceTransforms)) {
+        if (value->IsHolding<VtMatrix4dArray>()) {
+            VtMatrix4dArray const& instanceTransforms =
+                value->UncheckedGet<VtMatrix4dArray>();
+            for (size_t i = 0; i < instanceIndices.size(); ++i) {
+                const size_t index = instanceIndices[i];
+                if (index >= instanceTransforms.size()) continue;
+                transforms[i] = instanceTransforms[index] * transforms[i];
+            }
+        }
+    }
+
+    if (GetParentId().IsEmpty()) {
+        return transforms;
+    }
+
+    // Nested instancer: every instance of ours gets repeated for every
+    // instance of the parent instancer.
+    HdInstancer *parentInstancer =
+        GetDelegate()->GetRenderIndex().GetInstancer(GetParentId());
+    if (!TF_VERIFY(parentInstancer)) {
+        return transforms;
+    }
+
+    VtMatrix4dArray parentTransforms =
+        static_cast<HdTinyInstancer*>(parentInstancer)->
+            ComputeInstanceTransforms(GetId());
+
+    VtMatrix4dArray final(parentTransforms.size() * transforms.size());
+    for (size_t i = 0; i < parentTransforms.size(); ++i) {
+        for (size_t j = 0; j < transforms.size(); ++j) {
+            final[i * transforms.size() + j] = transforms[j] *
+                                               parentTransforms[i];
+        }
+    }
+    return final;
+}
+
+PXR_NAMESPACE_CLOSE_SCOPE
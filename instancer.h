@@ -0,0 +1,68 @@
+//
+// Copyright 2020 Pixar
+//
+// Licensed under the terms set forth in the LICENSE.txt file available at
+// https://openusd.org/license.
+//
+#ifndef EXTRAS_IMAGING_EXAMPLES_HD_TINY_INSTANCER_H
+#define EXTRAS_IMAGING_EXAMPLES_HD_TINY_INSTANCER_H
+
+#include "pxr/pxr.h"
+#include "pxr/imaging/hd/instancer.h"
+#include "pxr/base/gf/matrix4d.h"
+#include "pxr/base/tf/hashmap.h"
+#include "pxr/base/vt/array.h"
+#include "pxr/base/vt/value.h"
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+/// \class HdTinyInstancer
+///
+/// HdTiny implements instancing by adding prototype geometry to the
+/// top-level scene once, and adding one instance record per instance
+/// transform that references it. Nothing about the prototype gets copied.
+///
+/// The instancer's job is to resolve the per-instance primvars (translate,
+/// rotate, scale and instance transform) into flat transform lists. Nested
+/// instancers are flattened by multiplying in the transforms of the parent
+/// instancer for each instance of this one.
+///
+class HdTinyInstancer final : public HdInstancer
+{
+public:
+    /// Constructor.
+    ///   \param delegate The scene delegate backing this instancer's data.
+    ///   \param id The unique id of this instancer.
+    HdTinyInstancer(HdSceneDelegate* delegate, SdfPath const& id);
+
+    /// Destructor.
+    ~HdTinyInstancer() override;
+
+    /// Pull the instance primvars from the scene delegate; called (once)
+    /// from the Sync of the prims that are instanced by this instancer.
+    void Sync(HdSceneDelegate *sceneDelegate,
+              HdRenderParam   *renderParam,
+              HdDirtyBits     *dirtyBits) override;
+
+    /// Computes all instance transforms for the provided prototype id,
+    /// taking into account the scene delegate's instancerTransform and the
+    /// instance primvars. If this instancer is itself instanced, the result
+    /// contains one transform per instance of this instancer times one per
+    /// instance of the parent.
+    ///   \param prototypeId The prototype to compute transforms for.
+    ///   \return One transform per instance, to apply in rendering.
+    VtMatrix4dArray ComputeInstanceTransforms(SdfPath const &prototypeId);
+
+private:
+    // Updates the cached primvars in _primvarMap based on scene delegate
+    // data.
+    void _SyncPrimvars(HdSceneDelegate *delegate, HdDirtyBits dirtyBits);
+
+    // Map of the latest primvar data for this instancer, keyed by
+    // primvar name.
+    TfHashMap<TfToken, VtValue, TfToken::HashFunctor> _primvarMap;
+};
+
+PXR_NAMESPACE_CLOSE_SCOPE
+
+#endif // EXTRAS_IMAGING_EXAMPLES_HD_TINY_INSTANCER_H
@@ -0,0 +1,151 @@
+//
+// Copyright 2020 Pixar
+//
+// Licensed under the terms set forth in the LICENSE.txt file available at
+// https://openusd.org/license.
+//
+#include "light.h"
+#include "renderParam.h"
+
+#include "pxr/imaging/hd/perfLog.h"
+#include "pxr/imaging/hd/sceneDelegate.h"
+#include "pxr/imaging/hd/tokens.h"
+#include "pxr/base/gf/matrix4d.h"
+#include "pxr/base/gf/vec3f.h"
+
+#include <cmath>
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+// Light parameter, or the given fallback if it isn't authored (with the
+// expected type).
+template <typename T>
+static T
+_GetParam(HdSceneDelegate *sceneDelegate, SdfPath const& id,
+          TfToken const& name, T const& fallback)
+{
+    const VtValue value = sceneDelegate->GetLightParamValue(id, name);
+    return value.IsHolding<T>() ? value.UncheckedGet<T>() : fallback;
+}
+
+static osc::vec3f
+_ToVec3f(GfVec3d const& v)
+{
+    return osc::vec3f(float(v[0]), float(v[1]), float(v[2]));
+}
+
+HdTinyLight::HdTinyLight(SdfPath const& id, TfToken const& lightType)
+    : HdLight(id)
+    , _lightType(lightType)
+    , _lightID(-1)
+{
+}
+
+HdTinyLight::~HdTinyLight() = default;
+
+HdDirtyBits
+HdTinyLight::GetInitialDirtyBitsMask() const
+{
+    return HdLight::DirtyTransform | HdLight::DirtyParams;
+}
+
+void
+HdTinyLight::Sync(HdSceneDelegate *sceneDelegate,
+                  HdRenderParam   *renderParam,
+                  HdDirtyBits     *dirtyBits)
+{
+    HD_TRACE_FUNCTION();
+
+    SdfPath const& id = GetId();
+    osc::Scene *scene =
+        static_cast<HdTinyRenderParam*>(renderParam)->GetScene();
+
+    if (_lightID < 0) {
+        _lightID = int(scene->addLight());
+    }
+
+    if (!(*dirtyBits & (HdLight::DirtyTransform | HdLight::DirtyParams))) {
+        *dirtyBits = HdLight::Clean;
+        return;
+    }
+
+    const GfMatrix4d xfm = sceneDelegate->GetTransform(id);
+
+    const float intensity = _GetParam(sceneDelegate, id,
+        HdLightTokens->intensity, 1.f);
+    const float exposure = _GetParam(sceneDelegate, id,
+        HdLightTokens->exposure, 0.f);
+    const GfVec3f color = _GetParam(sceneDelegate, id,
+        HdLightTokens->color, GfVec3f(1.f));
+    const bool normalizePower = _GetParam(sceneDelegate, id,
+        HdLightTokens->normalize, false);
+
+    osc::Light light;
+    light.radiance = osc::vec3f(color[0], color[1], color[2])
+        * (intensity * std::exp2(exposure));
+    light.position = _ToVec3f(xfm.ExtractTranslation());
+
+    if (_lightType == HdPrimTypeTokens->distantLight) {
+        // The intensity is taken as irradiance, the way Storm does.
+        light.type = osc::Light::DISTANT;
+        light.direction =
+            osc::normalize(_ToVec3f(xfm.TransformDir(GfVec3d(0, 0, -1))));
+        light.angle = .5f * float(M_PI/180.) * _GetParam(sceneDelegate, id,
+            HdLightTokens->angle, .53f);
+    } else if (_lightType == HdPrimTypeTokens->sphereLight) {
+        light.type = osc::Light::SPHERE;
+        const float scale =
+            float(xfm.TransformDir(GfVec3d(1, 0, 0)).GetLength());
+        const float radius = scale * _GetParam(sceneDelegate, id,
+            HdLightTokens->radius, .5f);
+        const bool treatAsPoint = _GetParam(sceneDelegate, id,
+            HdLightTokens->treatAsPoint, false);
+        if (treatAsPoint || radius <= 0.f) {
+            // a point light emits the same power as the sphere would
+            if (!normalizePower && radius > 0.f) {
+                light.radiance *= float(M_PI) * radius * radius;
+            }
+            light.radius = 0.f;
+        } else {
+            if (normalizePower) {
+                light.radiance *= 1.f / (float(M_PI) * radius * radius);
+            }
+            light.radius = radius;
+        }
+    } else if (_lightType == HdPrimTypeTokens->rectLight) {
+        light.type = osc::Light::RECT;
+        const float width = _GetParam(sceneDelegate, id,
+            HdLightTokens->width, 1.f);
+        const float height = _GetParam(sceneDelegate, id,
+            HdLightTokens->height, 1.f);
+        light.edgeU = _ToVec3f(xfm.TransformDir(GfVec3d(.5*width, 0, 0)));
+        light.edgeV = _ToVec3f(xfm.TransformDir(GfVec3d(0, .5*height, 0)));
+        const float area =
+            4.f * osc::length(osc::cross(light.edgeU, light.edgeV));
+        if (normalizePower && area > 0.f) {
+            light.radiance *= 1.f / area;
+        }
+    } else if (_lightType == HdPrimTypeTokens->domeLight) {
+        light.type = osc::Light::DOME;
+    }
+
+    if (!sceneDelegate->GetVisible(id)) {
+        light.radiance = osc::vec3f(0.f);
+    }
+
+    scene->setLight(uint32_t(_lightID), light);
+
+    *dirtyBits = HdLight::Clean;
+}
+
+void
+HdTinyLight::Finalize(HdRenderParam *renderParam)
+{
+    if (_lightID >= 0) {
+        static_cast<HdTinyRenderParam*>(renderParam)->GetScene()->
+            removeLight(uint32_t(_lightID));
+        _lightID = -1;
+    }
+}
+
+PXR_NAMESPACE_CLOSE_SCOPE
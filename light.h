@@ -0,0 +1,52 @@
+//
+// Copyright 2020 Pixar
+//
+// Licensed under the terms set forth in the LICENSE.txt file available at
+// https://openusd.org/license.
+//
+#ifndef EXTRAS_IMAGING_EXAMPLES_HD_TINY_LIGHT_H
+#define EXTRAS_IMAGING_EXAMPLES_HD_TINY_LIGHT_H
+
+#include "pxr/pxr.h"
+#include "pxr/imaging/hd/light.h"
+#include "Scene.h"
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+/// \class HdTinyLight
+///
+/// HdTiny's light Sprim, for distant, sphere, rect and dome lights. On Sync
+/// it converts the UsdLux parameters and transform into one world-space
+/// osc::Light in the scene. The scene picks a single light per shading
+/// point from a power-weighted alias table, so adding lights does not add
+/// shadow rays.
+///
+/// Dome lights only use their color; textures are not supported.
+///
+class HdTinyLight final : public HdLight
+{
+public:
+    HdTinyLight(SdfPath const& id, TfToken const& lightType);
+    ~HdTinyLight() override;
+
+    /// Pull the light's parameters and transform, and update its record.
+    void Sync(HdSceneDelegate *sceneDelegate,
+              HdRenderParam   *renderParam,
+              HdDirtyBits     *dirtyBits) override;
+
+    /// Remove the light from the scene.
+    void Finalize(HdRenderParam *renderParam) override;
+
+    HdDirtyBits GetInitialDirtyBitsMask() const override;
+
+private:
+    // One of the HdPrimTypeTokens light types.
+    TfToken _lightType;
+
+    // Slot of this light in the scene, or -1 before first Sync.
+    int _lightID;
+};
+
+PXR_NAMESPACE_CLOSE_SCOPE
+
+#endif // EXTRAS_IMAGING_EXAMPLES_HD_TINY_LIGHT_H
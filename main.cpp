@@ -8,7 +8,6 @@
 #include <pxr/usd/usdGeom/mesh.h>
 #include <pxr/usd/usdGeom/xformable.h>
 #include <pxr/usd/usdGeom/xform.h>
-#include <pxr/usd/usdGeom/xformCommonAPI.h>
 #include <pxr/usd/sdf/path.h>
 #include <pxr/base/gf/camera.h>
 #include <pxr/base/gf/vec3f.h>
@@ -16,17 +15,33 @@
 #include <pxr/imaging/glf/contextCaps.h>
 #include <pxr/usdImaging/usdImagingGL/engine.h>
 #include <mujoco/mujoco.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <iostream>
 #include <unordered_map>
+#include <tbb/parallel_for.h>
 #include <fstream>
 #include <iostream>
 #include <string>
-#include "tinyxml2.h"
+#include "mjUsdBridge.h"
+#include "physicsGeometry.h"
+#include "usdPicker.h"
+#include "gamepadInput.h"
 
 using namespace pxr;
-using namespace tinyxml2;
 
-bool ExportUsdStageToMjcf(UsdStageRefPtr stage, const std::string& outputDir, const std::string& xmlFile)
+// 一个待导出的网格：从 USD 读出的数据，以及由它算出的物理几何
+struct MjcfMesh {
+    std::string name;
+    VtVec3fArray points;
+    std::vector<osc::vec3i> triangles;
+    PhysicsGeometry physics;
+};
+
+bool ExportUsdStageToMjcf(UsdStageRefPtr stage, const std::string& outputDir,
+                          const std::string& xmlFile,
+                          const PhysicsGeometryOptions& options = PhysicsGeometryOptions())
 {
     // 2. 打开 XML 文件
     std::ofstream xml(xmlFile);
@@ -35,11 +50,8 @@ bool ExportUsdStageToMjcf(UsdStageRefPtr stage, const std::string& outputDir, co
         return false;
     }
 
-    xml << "<mujoco model=\"usd_scene\">\n  <asset>\n";
-
-    int meshCount = 0;
-
-    // 3. 遍历 Stage 所有 prim
+    // 3. 遍历 Stage 所有 prim，读出网格（串行，Stage 不保证线程安全）
+    std::vector<MjcfMesh> meshes;
     for (UsdPrim prim : stage->Traverse()) {
         UsdGeomMesh mesh(prim);
         if (!mesh)
@@ -53,62 +65,82 @@ bool ExportUsdStageToMjcf(UsdStageRefPtr stage, const std::string& outputDir, co
         if (size[2] < 1e-8)
             continue;
 
-        const char* Name = prim.GetName().GetText();
         const char* Path = prim.GetPath().GetText();
 
-        std::string meshName = "mesh_" + std::to_string(meshCount);
-        std::string objFile = outputDir + meshName + ".obj";
+        MjcfMesh out;
+        out.name = "mesh_" + std::to_string(meshes.size());
 
-        // 获取顶点
-        VtArray<GfVec3f> points;
-        mesh.GetPointsAttr().Get(&points);
+        // 获取顶点和面，任意多边形三角化（凸面扇形，凹面剪耳），不再丢弃 >4 边的面
+        if (!ReadMeshTriangles(mesh, out.points, out.triangles)) {
+            std::cerr << "Dropped invalid faces of " << Path << "\n";
+        }
+        meshes.push_back(std::move(out));
+    }
 
-        // 获取面
-        VtArray<int> faceCounts;
-        mesh.GetFaceVertexCountsAttr().Get(&faceCounts);
-        VtArray<int> faceIndices;
-        mesh.GetFaceVertexIndicesAttr().Get(&faceIndices);
+    // 4. 物理几何（简化 + 凸分解），各网格之间并行，缓存和 XML 放在一起
+    PhysicsGeometryOptions physicsOptions = options;
+    physicsOptions.cacheDir = outputDir;
+    tbb::parallel_for(size_t(0), meshes.size(), [&](size_t i) {
+        MjcfMesh& mesh = meshes[i];
+        BuildPhysicsGeometry(
+            reinterpret_cast<const osc::vec3f*>(mesh.points.cdata()),
+            mesh.points.size(), mesh.triangles.data(), mesh.triangles.size(),
+            physicsOptions, mesh.physics);
+    });
+
+    // 5. 写 XML <mesh>
+    xml << "<mujoco model=\"usd_scene\">\n  <asset>\n";
+    std::vector<std::vector<std::string>> meshGeoms(meshes.size());
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        const MjcfMesh& mesh = meshes[i];
+        const PhysicsGeometry& physics = mesh.physics;
+        if (!physics.hulls.empty()) {
+            // 每个凸包一个 <mesh>，顶点直接内联
+            for (size_t h = 0; h < physics.hulls.size(); ++h) {
+                const std::string hullName =
+                    mesh.name + "_hull_" + std::to_string(h);
+                xml << "    <mesh name=\"" << hullName << "\" vertex=\"";
+                for (const osc::vec3f& v : physics.hulls[h].vertex) {
+                    xml << v.x << " " << v.y << " " << v.z << " ";
+                }
+                xml << "\"/>\n";
+                meshGeoms[i].push_back(hullName);
+            }
+            continue;
+        }
 
-        // 写 OBJ 文件
+        // 不做凸分解，或分解不出有体积的凸包（例如退化网格）时，导出物理 LOD
+        const std::string objFile = outputDir + mesh.name + ".obj";
         std::ofstream obj(objFile);
         if (!obj) {
             std::cerr << "Failed to write obj: " << objFile << std::endl;
             continue;
         }
-
-        for (const auto& p : points) {
-            obj << "v " << p[0] << " " << p[1] << " " << p[2] << "\n";
+        for (const osc::vec3f& p : physics.vertex) {
+            obj << "v " << p.x << " " << p.y << " " << p.z << "\n";
         }
-
-        size_t idx = 0;
-        for (size_t f = 0; f < faceCounts.size(); ++f) {
-            int c = faceCounts[f];
-            if (c == 3) {
-                obj << "f " << faceIndices[idx]+1 << " " << faceIndices[idx+1]+1 << " " << faceIndices[idx+2]+1 << "\n";
-            } else if (c == 4) {
-                obj << "f " << faceIndices[idx]+1 << " " << faceIndices[idx+1]+1 << " " << faceIndices[idx+2]+1 << "\n";
-                obj << "f " << faceIndices[idx]+1 << " " << faceIndices[idx+2]+1 << " " << faceIndices[idx+3]+1 << "\n";
-            } else {
-                std::cerr << "Skipping polygon with " << c << " vertices\n";
-            }
-            idx += c;
+        for (const osc::vec3i& t : physics.index) {
+            obj << "f " << t.x+1 << " " << t.y+1 << " " << t.z+1 << "\n";
         }
         obj.close();
 
-        // 写 XML <mesh>
-        xml << "    <mesh name=\"" << meshName << "\" file=\"" << objFile << "\"/>\n";
-
-        ++meshCount;
+        xml << "    <mesh name=\"" << mesh.name << "\" file=\"" << objFile << "\"/>\n";
+        meshGeoms[i].push_back(mesh.name);
     }
 
     xml << "  </asset>\n  <worldbody>\n";
 
-    // 为每个 mesh 生成一个 <body><geom>
-    for (int i = 0; i < meshCount; ++i) {
-        std::string meshName = "mesh_" + std::to_string(i);
-        xml << "    <body name=\"" << meshName << "_body\" pos=\"0 0 0\">\n"
-            << "      <geom type=\"mesh\" mesh=\"" << meshName << "\" />\n"
-            << "    </body>\n";
+    // 为每个 mesh 生成一个 <body>，每个凸包一个 <geom>
+    int meshCount = 0;
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        if (meshGeoms[i].empty())
+            continue;
+        xml << "    <body name=\"" << meshes[i].name << "_body\" pos=\"0 0 0\">\n";
+        for (const std::string& geomMesh : meshGeoms[i]) {
+            xml << "      <geom type=\"mesh\" mesh=\"" << geomMesh << "\" />\n";
+        }
+        xml << "    </body>\n";
+        ++meshCount;
     }
 
     xml << "  </worldbody>\n</mujoco>\n";
@@ -118,87 +150,12 @@ bool ExportUsdStageToMjcf(UsdStageRefPtr stage, const std::string& outputDir, co
     return true;
 }
 
-// 简单桥接：MuJoCo → USD
-class MjUsdBridge {
-public:
-    MjUsdBridge(const std::string& usd_path)
-    {
-        stage = UsdStage::Open(usd_path);
-
-        XMLDocument doc;
-        XMLElement* mujoco = doc.NewElement("mujoco");
-        doc.InsertFirstChild(mujoco);
-        XMLElement* worldbody = doc.NewElement("worldbody");
-        mujoco->InsertEndChild(worldbody);
-        worldbody->InsertEndChild(Export(stage->GetPrimAtPath(SdfPath("/")), doc));
-        XMLError eResult = doc.SaveFile("scene.xml");
-        if (eResult != XML_SUCCESS)
-            std::cerr << "Error saving XML\n";
-
-        // 2. 初始化 MuJoCo 模型
-        model = mj_loadXML("scene.xml", nullptr, nullptr, 0);
-        data = mj_makeData(model);
-
-        //bodyNames = {"mesh_0_body", "mesh_1_body"};
-        //primPaths = {SdfPath("/World/mesh_0"), SdfPath("/World/mesh_1")};
-    }
-
-    ~MjUsdBridge()
-    {
-        if (data)
-            mj_deleteData(data);
-        if (model)
-            mj_deleteModel(model);
-    }
-
-    XMLElement* Export(const UsdPrim prim, XMLDocument& doc)
-    {
-        XMLElement* elem = doc.NewElement("body");
-        for (UsdPrim child : prim.GetChildren())
-        {
-            XMLElement* child_elem = Export(child, doc);
-            elem->InsertEndChild(child_elem);
-        }
-        return elem;
-    }
-
-    UsdStageRefPtr GetStage() { return stage; }
-
-    void StepAndSync(double time, int frame)
-    {
-        mj_step(model, data);
-        
-        if(bodyNames.size() != primPaths.size())
-        {
-            std::cerr << "bodyNames and primPaths size mismatch!" << std::endl;
-            return;
-        }
-        for(size_t i=0; i<bodyNames.size(); ++i)
-        {
-            int id = mj_name2id(model, mjOBJ_BODY, bodyNames[i].c_str());
-            if(id < 0)
-                continue;
-            const double* pos = data->xpos + 3*id;
-            const double* quat = data->xquat + 4*id; // w x y z
-            GfMatrix4d mat;
-            GfQuatd q(quat[0], quat[1], quat[2], quat[3]);
-            mat.SetRotate(q);
-            mat.SetTranslateOnly(GfVec3d(pos[0], pos[1], pos[2]));
-            UsdGeomXform x = UsdGeomXform::Get(stage, primPaths[i]);
-            if (!x.GetTransformOp())
-                x.AddTransformOp();
-            x.GetTransformOp().Set(mat, time);
-        }
-    }
+static double Now()
+{
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
 
-private:
-    mjModel* model = nullptr;
-    mjData* data = nullptr;
-    std::vector<std::string> bodyNames;
-    std::vector<SdfPath> primPaths;
-    UsdStageRefPtr stage;
-    UsdGeomXform rootX;
-};
 #define WIDTH 1024
 #define HEIGHT 768
 
@@ -223,8 +180,6 @@ int totalCubes = 0;
 
 bool fullscreen = false;
 
-int recentButton = GLFW_GAMEPAD_BUTTON_LAST;
-
 bool showHelp = true;
 bool highlight = true;
 
@@ -235,6 +190,11 @@ float positionMultiplier = 5.0f;
 float rotationMultiplier = 0.2f;
 float heightMultiplier = 2.0f;
 float distanceMultiplier = 3.0f;
+// 手柄的 evdev 设备（/dev/input/eventN），空表示自动找第一个手柄
+std::string gamepadDevice = "";
+// 每多少步存一个仿真检查点，保留多少个（手柄 B 键回退）
+int checkpointInterval = 100;
+int checkpointCapacity = 256;
 int main(int argc, char** argv)
 {
 	if (!glfwInit())
@@ -268,8 +228,16 @@ int main(int argc, char** argv)
 
     pxr::UsdImagingGLRenderParams renderParams;
 
-    MjUsdBridge bridge(argv[1]);
+    // 物理 LOD 和凸包缓存在当前目录（和 scene.xml 一起），再次启动时直接复用
+    PhysicsGeometryOptions physicsOptions;
+    physicsOptions.cacheDir = "physics_cache/";
+    MjUsdBridge bridge(argv[1], physicsOptions);
+    bridge.EnableCheckpoints(checkpointInterval, checkpointCapacity);
+    // 可选的共享内存通道：MjUsdHydra scene.usd [shm 名字 [lockstep]]
+    if (argc > 2 && !bridge.OpenChannel(argv[2], argc > 3 && std::string(argv[3]) == "lockstep"))
+        std::cerr << "Failed to open shared memory channel " << argv[2] << std::endl;
     UsdStageRefPtr stage = bridge.GetStage();
+    UsdPicker picker(stage);
 
     pxr::SdfPathVector excludedPaths;
     engine.reset(new pxr::UsdImagingGLEngine(
@@ -291,154 +259,147 @@ int main(int argc, char** argv)
 
     pxr::GfVec4f clearColor(0.18f, 0.18f, 0.18f, 1.0f);
 
+    // 摇杆和扳机的零位，手柄接上时记下
     pxr::GfVec2f joystickZeroLeft;
     pxr::GfVec2f joystickZeroRight;
     float joystickTriggerLeft = 0.0f;
     float joystickTriggerRight = 0.0f;
-    if (glfwJoystickIsGamepad(GLFW_JOYSTICK_1))
+
+    // 手柄只由输入线程读（evdev），主线程不调用 GLFW 的手柄函数
+    GamepadInput gamepad(gamepadDevice);
+    GamepadEvent gamepadEvent;
+    GLFWgamepadstate gamepadState = {};
+    bool gamepadConnected = false;
+    // 手柄输入已经处理到的时刻
+    double gamepadTime = Now();
+
+    pxr::SdfPath selectedPrimPath;
+    pxr::GfVec3d selectionHitPoint;
+    bool delegateSelectionMode = false;
+    bool primLocked = false;
+
+    // 按键：按住的状态，以及按下的那一刻（和 previous 比较）触发的动作
+    auto applyGamepadButtons = [&](const GLFWgamepadstate& state, const GLFWgamepadstate& previous)
     {
-        GLFWgamepadstate state;
-        if (glfwGetGamepadState(GLFW_JOYSTICK_1, &state))
+        auto pressed = [&](int button) { return state.buttons[button] == GLFW_PRESS; };
+        auto once = [&](int button) { return pressed(button) && previous.buttons[button] != GLFW_PRESS; };
+
+        primLocked = pressed(GLFW_GAMEPAD_BUTTON_X);
+        delegateSelectionMode = pressed(GLFW_GAMEPAD_BUTTON_Y);
+        // 按住 X 抓住准星下的物体，松开放手
+        if (primLocked && !bridge.IsDragging() && !selectedPrimPath.IsEmpty())
+            bridge.BeginDrag(selectedPrimPath, selectionHitPoint);
+        if (!primLocked && bridge.IsDragging())
+            bridge.EndDrag();
+        if (once(GLFW_GAMEPAD_BUTTON_B))
         {
-            std::cout << "Joystick/Gamepad found: " << glfwGetGamepadName(GLFW_JOYSTICK_1) << std::endl;
-            joystickZeroLeft = pxr::GfVec2f(state.axes[GLFW_GAMEPAD_AXIS_LEFT_X], state.axes[GLFW_GAMEPAD_AXIS_LEFT_Y]);
-            joystickZeroRight = pxr::GfVec2f(state.axes[GLFW_GAMEPAD_AXIS_RIGHT_X], state.axes[GLFW_GAMEPAD_AXIS_RIGHT_Y]);
-            joystickTriggerLeft = state.axes[GLFW_GAMEPAD_AXIS_LEFT_TRIGGER];
-            joystickTriggerRight = state.axes[GLFW_GAMEPAD_AXIS_RIGHT_TRIGGER];
+            // 回退到上一个检查点，连按继续往前
+            if (!bridge.Rewind())
+                std::cout << "No checkpoint to rewind to" << std::endl;
         }
-    }
+        if (once(GLFW_GAMEPAD_BUTTON_DPAD_UP) && delegateSelectionMode)
+            newDelegate = std::max(0, newDelegate - 1);
+        if (once(GLFW_GAMEPAD_BUTTON_DPAD_DOWN) && delegateSelectionMode)
+            newDelegate++;
+    };
+
+    // 摇杆、扳机、肩键和方向键左右是连续量：按住 seconds 秒的移动量，
+    // 各 multiplier 是 60 帧/秒时每帧的量
+    auto applyGamepadMotion = [&](const GLFWgamepadstate& state, double seconds)
+    {
+        const float frames = float(std::max(0.0, seconds) * 60.0);
+        if (frames <= 0.0f)
+            return;
+        pxr::GfVec2f stickLeft = pxr::GfVec2f(state.axes[GLFW_GAMEPAD_AXIS_LEFT_X], state.axes[GLFW_GAMEPAD_AXIS_LEFT_Y]);
+        pxr::GfVec2f stickRight = pxr::GfVec2f(state.axes[GLFW_GAMEPAD_AXIS_RIGHT_X], state.axes[GLFW_GAMEPAD_AXIS_RIGHT_Y]);
 
-    pxr::SdfPath selectedPrimPath;
+        if (state.buttons[GLFW_GAMEPAD_BUTTON_RIGHT_BUMPER] == GLFW_PRESS)
+        {
+            eyesHeight += heightMultiplier * frames;
+            cameraPivot = pxr::GfVec3d(cameraPivot[0], eyesHeight, cameraPivot[2]);
+        }
+        if (state.buttons[GLFW_GAMEPAD_BUTTON_LEFT_BUMPER] == GLFW_PRESS)
+        {
+            eyesHeight -= heightMultiplier * frames;
+            cameraPivot = pxr::GfVec3d(cameraPivot[0], eyesHeight, cameraPivot[2]);
+        }
+        if (state.buttons[GLFW_GAMEPAD_BUTTON_DPAD_LEFT] == GLFW_PRESS)
+            focalLength -= 0.2f * frames;
+        if (state.buttons[GLFW_GAMEPAD_BUTTON_DPAD_RIGHT] == GLFW_PRESS)
+            focalLength += 0.2f * frames;
+
+        if ((joystickZeroLeft - stickLeft).GetLength() > 0.08)
+        {
+            pxr::GfVec3d camDir = cameraTransform.ExtractTranslation() - cameraPivot;
+            camDir[1] = 0.0;
+            camDir.Normalize();
+            const double step = positionMultiplier * frames;
+            const pxr::GfVec3d move(
+                stickLeft[1] * camDir[0] * step + stickLeft[0] * camDir[2] * step,
+                0.0,
+                stickLeft[1] * camDir[2] * step + stickLeft[0] * (-camDir[0]) * step);
+            cameraPivot = pxr::GfVec3d(cameraPivot[0] + move[0], eyesHeight, cameraPivot[2] + move[2]);
+
+            // 锁定时把拖拽目标点跟着摇杆移动，由 MuJoCo 的弹簧力把物体拉过去
+            if (primLocked)
+                bridge.MoveDragTarget(move);
+        }
+        if ((joystickZeroRight - stickRight).GetLength() > 0.08)
+        {
+            pitch += stickRight[0] * rotationMultiplier * frames;
+            yaw += stickRight[1] * rotationMultiplier * frames;
+        }
+
+        if (std::abs(joystickTriggerLeft - state.axes[GLFW_GAMEPAD_AXIS_LEFT_TRIGGER]) > 0.05)
+            lookAtDistance -= (state.axes[GLFW_GAMEPAD_AXIS_LEFT_TRIGGER] + 1.0) * distanceMultiplier * frames;
+        if (std::abs(joystickTriggerRight - state.axes[GLFW_GAMEPAD_AXIS_RIGHT_TRIGGER]) > 0.05)
+            lookAtDistance += (state.axes[GLFW_GAMEPAD_AXIS_RIGHT_TRIGGER] + 1.0) * distanceMultiplier * frames;
+        lookAtDistance = std::max(0.1, lookAtDistance);
+    };
 
     while (!glfwWindowShouldClose(window))
     {
         if(animate)
             frame++;
-        // MuJoCo 推进一步并同步到 USD
-        bridge.StepAndSync(frame * 0.01, frame);
 
         glfwMakeContextCurrent(window);
 
         glfwPollEvents();
 
-        bool delegateSelectionMode = false;
-        bool primLocked = false;
-
-        if (glfwJoystickIsGamepad(GLFW_JOYSTICK_1))
+        // 手柄事件在物理步进之前处理，拖拽目标点在这一步就生效。每个事件之前
+        // 的状态一直保持到事件的时间戳，连续量按这段真实时间积分，移动量和
+        // 渲染帧率无关；两帧之间按下又松开的键也照样触发
+        const double inputTime = Now();
+        while (gamepad.Pop(gamepadEvent))
         {
-            GLFWgamepadstate state;
-            if (glfwGetGamepadState(GLFW_JOYSTICK_1, &state))
-            {
-                pxr::GfVec2f stickLeft = pxr::GfVec2f(state.axes[GLFW_GAMEPAD_AXIS_LEFT_X], state.axes[GLFW_GAMEPAD_AXIS_LEFT_Y]);
-                pxr::GfVec2f stickRight = pxr::GfVec2f(state.axes[GLFW_GAMEPAD_AXIS_RIGHT_X], state.axes[GLFW_GAMEPAD_AXIS_RIGHT_Y]);
-
-// marco to check if a gamepad button is pressed
-#define GAMEPAD_BUTTON_PRESSED(btn) state.buttons[btn] == GLFW_PRESS
-// macro to check if a gamepad button has been pressed once
-#define GAMEPAD_BUTTON_ONCE(btn) state.buttons[btn] == GLFW_PRESS && recentButton != btn
-
-                if (GAMEPAD_BUTTON_PRESSED(GLFW_GAMEPAD_BUTTON_X))
-                {
-                    primLocked = true;
-                }
-                if (GAMEPAD_BUTTON_PRESSED(GLFW_GAMEPAD_BUTTON_Y))
-                {
-                    delegateSelectionMode = true;
-                }
-                if (GAMEPAD_BUTTON_PRESSED(GLFW_GAMEPAD_BUTTON_RIGHT_BUMPER))
-                {
-                    eyesHeight += heightMultiplier;
-                    cameraPivot = pxr::GfVec3d(cameraPivot[0], eyesHeight, cameraPivot[2]);
-                }
-                if (GAMEPAD_BUTTON_PRESSED(GLFW_GAMEPAD_BUTTON_LEFT_BUMPER))
-                {
-                    eyesHeight -= heightMultiplier;
-                    cameraPivot = pxr::GfVec3d(cameraPivot[0], eyesHeight, cameraPivot[2]);
-                }
-                if (GAMEPAD_BUTTON_ONCE(GLFW_GAMEPAD_BUTTON_DPAD_UP))
-                {
-                    if(delegateSelectionMode)
-                        newDelegate = std::max(0, newDelegate - 1);
-                }
-                if (GAMEPAD_BUTTON_ONCE(GLFW_GAMEPAD_BUTTON_DPAD_DOWN))
-                {
-                    if(delegateSelectionMode)
-                        newDelegate++;
-                }
-
-                if (GAMEPAD_BUTTON_PRESSED(GLFW_GAMEPAD_BUTTON_DPAD_LEFT))
-                {
-                    focalLength -= 0.2f;
-                }
-                if (GAMEPAD_BUTTON_PRESSED(GLFW_GAMEPAD_BUTTON_DPAD_RIGHT))
-                {
-                    focalLength += 0.2f;
-                }
-
-                // set recent button
-                for (int bi = 0; bi < 15; ++bi)
-                {
-                    recentButton = GLFW_GAMEPAD_BUTTON_LAST;
-                    if (bi != GLFW_GAMEPAD_BUTTON_Y && state.buttons[bi] == GLFW_PRESS )
-                    {
-                        recentButton = bi;
-                        break;
-                    }
-                }
-#undef GAMEPAD_BUTTON_PRESSED
-#undef GAMEPAD_BUTTON_ONCE
-
-                if ((joystickZeroLeft - stickLeft).GetLength() > 0.08)
-                {
-                    pxr::GfVec3d camDir = cameraTransform.ExtractTranslation() - cameraPivot;
-                    camDir[1] = 0.0;
-                    camDir.Normalize();
-                    cameraPivot = pxr::GfVec3d(cameraPivot[0] + stickLeft[1] * camDir[0] * positionMultiplier, eyesHeight, cameraPivot[2] + stickLeft[1] * camDir[2] * positionMultiplier);
-                    cameraPivot = pxr::GfVec3d(cameraPivot[0] + stickLeft[0] * camDir[2] * positionMultiplier, eyesHeight, cameraPivot[2] + stickLeft[0] * (-camDir[0]) * positionMultiplier);
-
-                    if (primLocked && !selectedPrimPath.IsEmpty())
-                    {
-                        const pxr::UsdPrim& prim = stage->GetPrimAtPath(selectedPrimPath);
-                        pxr::GfVec3d translate;
-                        pxr::GfVec3f rotate;
-                        pxr::GfVec3f scale;
-                        pxr::GfVec3f pivot;
-                        pxr::UsdGeomXformCommonAPI::RotationOrder rotOrder;
-                        pxr::UsdGeomXformCommonAPI(prim).GetXformVectors(&translate, &rotate, &scale, &pivot, &rotOrder, pxr::UsdTimeCode::Default());
-
-                        translate[0] += stickLeft[1] * camDir[0] * positionMultiplier + stickLeft[0] * camDir[2] * positionMultiplier;
-                        translate[1] += 0.0;
-                        translate[2] += stickLeft[1] * camDir[2] * positionMultiplier + stickLeft[0] * (-camDir[0]) * positionMultiplier;
-
-                        // pxr::UsdGeomImageable(prim).ComputeLocalToWorldTransform(0);
-                        const auto& sourcePrim = pxr::UsdGeomXform(prim);
-                        sourcePrim.ClearXformOpOrder();
-                        const auto& transformOp = sourcePrim.AddTransformOp();
-                        auto m = pxr::GfMatrix4d().SetIdentity();
-                        m *= pxr::GfMatrix4d().SetScale(scale);
-                        m *= pxr::GfMatrix4d().SetRotate(pxr::GfRotation(pxr::GfVec3d(1, 0, 0), rotate[0]));
-                        m *= pxr::GfMatrix4d().SetRotate(pxr::GfRotation(pxr::GfVec3d(0, 1, 0), rotate[1]));
-                        m *= pxr::GfMatrix4d().SetRotate(pxr::GfRotation(pxr::GfVec3d(0, 0, 1), rotate[2]));
-                        m *= pxr::GfMatrix4d().SetTranslate(translate);
-                        transformOp.Set(m);
-
-                    }
-                }
-                if ((joystickZeroRight - stickRight).GetLength() > 0.08)
-                {
-                    pitch += stickRight[0] * rotationMultiplier;
-                    yaw += stickRight[1] * rotationMultiplier;
-                }
-
-                if (abs(joystickTriggerLeft - state.axes[GLFW_GAMEPAD_AXIS_LEFT_TRIGGER]) > 0.05)
-                    lookAtDistance -= (state.axes[GLFW_GAMEPAD_AXIS_LEFT_TRIGGER] + 1.0) * distanceMultiplier;
-                if (abs(joystickTriggerRight - state.axes[GLFW_GAMEPAD_AXIS_RIGHT_TRIGGER]) > 0.05)
-                    lookAtDistance += (state.axes[GLFW_GAMEPAD_AXIS_RIGHT_TRIGGER] + 1.0) * distanceMultiplier;
-                lookAtDistance = std::max(0.1, lookAtDistance);
-
+            if (gamepadConnected)
+                applyGamepadMotion(gamepadState, gamepadEvent.time - gamepadTime);
+            gamepadTime = std::max(gamepadTime, gamepadEvent.time);
 
+            const GLFWgamepadstate released = {};
+            const GLFWgamepadstate& state = gamepadEvent.connected ? gamepadEvent.state : released;
+            if (gamepadEvent.connected && !gamepadConnected)
+            {
+                joystickZeroLeft = pxr::GfVec2f(state.axes[GLFW_GAMEPAD_AXIS_LEFT_X], state.axes[GLFW_GAMEPAD_AXIS_LEFT_Y]);
+                joystickZeroRight = pxr::GfVec2f(state.axes[GLFW_GAMEPAD_AXIS_RIGHT_X], state.axes[GLFW_GAMEPAD_AXIS_RIGHT_Y]);
+                joystickTriggerLeft = state.axes[GLFW_GAMEPAD_AXIS_LEFT_TRIGGER];
+                joystickTriggerRight = state.axes[GLFW_GAMEPAD_AXIS_RIGHT_TRIGGER];
             }
+            applyGamepadButtons(state, gamepadState);
+            gamepadConnected = gamepadEvent.connected;
+            gamepadState = state;
+        }
+        if (gamepadConnected)
+        {
+            applyGamepadMotion(gamepadState, inputTime - gamepadTime);
+            // 抓取时准星下还没有物体的话，之后每帧再试
+            if (primLocked && !bridge.IsDragging() && !selectedPrimPath.IsEmpty())
+                bridge.BeginDrag(selectedPrimPath, selectionHitPoint);
         }
+        gamepadTime = std::max(gamepadTime, inputTime);
+
+        // MuJoCo 推进一步并同步到 USD
+        bridge.StepAndSync(frame * 0.01, frame);
 
         // set cube rotation
         //
@@ -523,29 +484,19 @@ int main(int argc, char** argv)
         }
         glPopMatrix();
 
-        pxr::GfVec2d halfSize(1.0 / display_w, 1.0 / display_h);
         pxr::GfVec2d screenPoint(2.0 * ((display_w/2.0) / display_w) - 1.0, 2.0 * (1.0 - (display_h/2.0) / display_h) - 1.0);
 
-        // Compute pick frustum.
-        auto pickFrustum = frustum.ComputeNarrowedFrustum(screenPoint, halfSize);
-        auto pickView = pickFrustum.ComputeViewMatrix();
-        auto pickProj = pickFrustum.ComputeProjectionMatrix();
-
-        pxr::GfVec3d selectionHitPoint;
-        pxr::GfVec3d selectionHitNormal;
-
+        // 准星下的 prim：CPU 上对网格 BVH 求交，不再每帧走一遍 Hydra 的 ID 渲染
         if (!primLocked)
         {
             selectedPrimPath = pxr::SdfPath();
-            if (highlight && engine->TestIntersection(
-                pickView,
-                pickProj,
-                stage->GetPseudoRoot(),
-                renderParams,
-                &selectionHitPoint,
-                &selectionHitNormal,
-                &selectedPrimPath))
+            PickHit hit;
+            if (highlight)
+                picker.Update(renderParams.frame);
+            if (highlight && picker.Pick(frustum, screenPoint, &hit))
             {
+                selectedPrimPath = hit.primPath;
+                selectionHitPoint = hit.point;
                 engine->SetSelected({ selectedPrimPath });
             }
             else
@@ -0,0 +1,174 @@
+//
+// Copyright 2020 Pixar
+//
+// Licensed under the terms set forth in the LICENSE.txt file available at
+// https://openusd.org/license.
+//
+#include "material.h"
+#include "renderParam.h"
+
+#include "pxr/imaging/hd/material.h"
+#include "pxr/imaging/hd/perfLog.h"
+#include "pxr/imaging/hd/sceneDelegate.h"
+#include "pxr/base/gf/vec3f.h"
+#include "pxr/base/tf/staticTokens.h"
+#include "pxr/usd/sdf/assetPath.h"
+
+#include <algorithm>
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+TF_DEFINE_PRIVATE_TOKENS(
+    _tokens,
+    (UsdPreviewSurface)
+    (UsdUVTexture)
+    (file)
+    (diffuseColor)
+    (emissiveColor)
+    (roughness)
+    (metallic)
+    (opacity)
+);
+
+// Authored value of a node parameter, if it has the expected type.
+template <typename T>
+static bool
+_GetParam(HdMaterialNode const& node, TfToken const& name, T *value)
+{
+    auto it = node.parameters.find(name);
+    if (it == node.parameters.end() || !it->second.IsHolding<T>()) {
+        return false;
+    }
+    *value = it->second.UncheckedGet<T>();
+    return true;
+}
+
+static uint8_t
+_Quantize(float value)
+{
+    return uint8_t(std::min(std::max(value, 0.f), 1.f) * 255.f + .5f);
+}
+
+// File of the UsdUVTexture node that drives the given input of the given
+// node, or an empty string if there is none.
+static std::string
+_GetTextureFile(HdMaterialNetwork const& network,
+                SdfPath const& nodePath, TfToken const& input)
+{
+    for (HdMaterialRelationship const& rel : network.relationships) {
+        if (rel.outputId != nodePath || rel.outputName != input) {
+            continue;
+        }
+        for (HdMaterialNode const& node : network.nodes) {
+            SdfAssetPath file;
+            if (node.path == rel.inputId &&
+                node.identifier == _tokens->UsdUVTexture &&
+                _GetParam(node, _tokens->file, &file)) {
+                return file.GetResolvedPath().empty()
+                    ? file.GetAssetPath() : file.GetResolvedPath();
+            }
+        }
+    }
+    return std::string();
+}
+
+// Packs the constant inputs of the network's UsdPreviewSurface; anything the
+// network doesn't author (or drives through a texture) keeps the default. A
+// texture driving diffuseColor is returned in diffuseTexture; it gets
+// looked up with the mesh's "st" primvar.
+static osc::PackedMaterial
+_PackMaterial(HdMaterialNetwork const& network, std::string *diffuseTexture)
+{
+    osc::PackedMaterial material;
+    for (HdMaterialNode const& node : network.nodes) {
+        if (node.identifier != _tokens->UsdPreviewSurface) {
+            continue;
+        }
+        GfVec3f color;
+        if (_GetParam(node, _tokens->diffuseColor, &color)) {
+            material.diffuse = osc::vec3f(color[0], color[1], color[2]);
+        }
+        if (_GetParam(node, _tokens->emissiveColor, &color)) {
+            material.emissive = osc::vec3f(color[0], color[1], color[2]);
+        }
+        float value;
+        if (_GetParam(node, _tokens->opacity, &value)) {
+            material.opacity = value;
+        }
+        if (_GetParam(node, _tokens->roughness, &value)) {
+            material.roughness = _Quantize(value);
+        }
+        if (_GetParam(node, _tokens->metallic, &value)) {
+            material.metallic = _Quantize(value);
+        }
+        *diffuseTexture =
+            _GetTextureFile(network, node.path, _tokens->diffuseColor);
+        if (!diffuseTexture->empty()) {
+            // the texture is the color; the constant is only its fallback
+            material.diffuse = osc::vec3f(1.f);
+        }
+        break;
+    }
+    return material;
+}
+
+HdTinyMaterial::HdTinyMaterial(SdfPath const& id)
+    : HdMaterial(id)
+    , _materialIndex(-1)
+{
+}
+
+HdTinyMaterial::~HdTinyMaterial() = default;
+
+HdDirtyBits
+HdTinyMaterial::GetInitialDirtyBitsMask() const
+{
+    return HdMaterial::AllDirty;
+}
+
+void
+HdTinyMaterial::Sync(HdSceneDelegate *sceneDelegate,
+                     HdRenderParam   *renderParam,
+                     HdDirtyBits     *dirtyBits)
+{
+    HD_TRACE_FUNCTION();
+
+    osc::Scene *scene =
+        static_cast<HdTinyRenderParam*>(renderParam)->GetScene();
+
+    if (_materialIndex < 0) {
+        _materialIndex = int(scene->addMaterial());
+    }
+
+    if (*dirtyBits & (HdMaterial::DirtyParams | HdMaterial::DirtyResource)) {
+        osc::PackedMaterial material;
+        std::string diffuseTexture;
+        const VtValue resource =
+            sceneDelegate->GetMaterialResource(GetId());
+        if (resource.IsHolding<HdMaterialNetworkMap>()) {
+            HdMaterialNetworkMap const& networkMap =
+                resource.UncheckedGet<HdMaterialNetworkMap>();
+            auto it = networkMap.map.find(HdMaterialTerminalTokens->surface);
+            if (it != networkMap.map.end()) {
+                material = _PackMaterial(it->second, &diffuseTexture);
+            }
+        }
+        scene->setMaterial(uint16_t(_materialIndex), material,
+                           diffuseTexture.empty()
+                           ? -1 : scene->addTexture(diffuseTexture));
+    }
+
+    *dirtyBits = HdMaterial::Clean;
+}
+
+void
+HdTinyMaterial::Finalize(HdRenderParam *renderParam)
+{
+    if (_materialIndex >= 0) {
+        static_cast<HdTinyRenderParam*>(renderParam)->GetScene()->
+            removeMaterial(uint16_t(_materialIndex));
+        _materialIndex = -1;
+    }
+}
+
+PXR_NAMESPACE_CLOSE_SCOPE
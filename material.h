@@ -0,0 +1,56 @@
+//
+// Copyright 2020 Pixar
+//
+// Licensed under the terms set forth in the LICENSE.txt file available at
+// https://openusd.org/license.
+//
+#ifndef EXTRAS_IMAGING_EXAMPLES_HD_TINY_MATERIAL_H
+#define EXTRAS_IMAGING_EXAMPLES_HD_TINY_MATERIAL_H
+
+#include "pxr/pxr.h"
+#include "pxr/imaging/hd/material.h"
+#include "Scene.h"
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+/// \class HdTinyMaterial
+///
+/// HdTiny's material Sprim. On Sync it finds the UsdPreviewSurface node in
+/// the material's surface network and packs its constant inputs into a
+/// single record of the scene's material table. Meshes only store the
+/// 16-bit index of that record, so editing a material rewrites one record
+/// and touches no geometry. A UsdUVTexture driving diffuseColor gets
+/// registered with the scene's texture cache, which the renderer samples.
+///
+class HdTinyMaterial final : public HdMaterial
+{
+public:
+    HdTinyMaterial(SdfPath const& id);
+    ~HdTinyMaterial() override;
+
+    /// Pull the material network and update this material's record.
+    void Sync(HdSceneDelegate *sceneDelegate,
+              HdRenderParam   *renderParam,
+              HdDirtyBits     *dirtyBits) override;
+
+    /// Release this material's record.
+    void Finalize(HdRenderParam *renderParam) override;
+
+    HdDirtyBits GetInitialDirtyBitsMask() const override;
+
+    /// Index of this material's record in the scene's material table; the
+    /// default material until the first Sync.
+    uint16_t GetMaterialIndex() const {
+        return _materialIndex < 0
+            ? uint16_t(osc::Scene::DEFAULT_MATERIAL)
+            : uint16_t(_materialIndex);
+    }
+
+private:
+    // Index into the scene's material table, or -1 before first Sync.
+    int _materialIndex;
+};
+
+PXR_NAMESPACE_CLOSE_SCOPE
+
+#endif // EXTRAS_IMAGING_EXAMPLES_HD_TINY_MATERIAL_H
@@ -5,13 +5,43 @@
 // https://openusd.org/license.
 //
 #include "mesh.h"
+#include "instancer.h"
+#include "material.h"
+#include "renderDelegate.h"
+#include "renderParam.h"
+#include "resourceRegistry.h"
+#include "MeshOptimizer.h"
+#include "Triangulate.h"
+
+#include "pxr/imaging/hd/perfLog.h"
+#include "pxr/base/arch/hash.h"
+#include "pxr/base/tf/hash.h"
+#include "pxr/base/tf/staticTokens.h"
 
 #include <iostream>
 
 PXR_NAMESPACE_OPEN_SCOPE
 
+TF_DEFINE_PRIVATE_TOKENS(
+    _tokens,
+    (st)
+);
+
+// USD matrices use the row-vector convention: rows 0-2 are the images of the
+// basis vectors, row 3 is the translation.
+static osc::affine3f
+_ToAffine(GfMatrix4d const& m)
+{
+    return osc::affine3f(osc::vec3f(m[0][0], m[0][1], m[0][2]),
+                         osc::vec3f(m[1][0], m[1][1], m[1][2]),
+                         osc::vec3f(m[2][0], m[2][1], m[2][2]),
+                         osc::vec3f(m[3][0], m[3][1], m[3][2]));
+}
+
 HdTinyMesh::HdTinyMesh(SdfPath const& id)
     : HdMesh(id)
+    , _transform(1)
+    , _meshID(-1)
 {
 }
 
@@ -19,7 +49,15 @@ HdDirtyBits
 HdTinyMesh::GetInitialDirtyBitsMask() const
 {
     return HdChangeTracker::Clean
-        | HdChangeTracker::DirtyTransform;
+        | HdChangeTracker::InitRepr
+        | HdChangeTracker::DirtyPoints
+        | HdChangeTracker::DirtyTopology
+        | HdChangeTracker::DirtyTransform
+        | HdChangeTracker::DirtyVisibility
+        | HdChangeTracker::DirtyPrimvar
+        | HdChangeTracker::DirtyInstancer
+        | HdChangeTracker::DirtyInstanceIndex
+        | HdChangeTracker::DirtyMaterialId;
 }
 
 HdDirtyBits
@@ -28,7 +66,7 @@ HdTinyMesh::_PropagateDirtyBits(HdDirtyBits bits) const
     return bits;
 }
 
-void 
+void
 HdTinyMesh::_InitRepr(TfToken const &reprToken, HdDirtyBits *dirtyBits)
 {
 
@@ -40,7 +78,248 @@ HdTinyMesh::Sync(HdSceneDelegate *sceneDelegate,
                    HdDirtyBits     *dirtyBits,
                    TfToken const   &reprToken)
 {
-    std::cout << "* (multithreaded) Sync Tiny Mesh id=" << GetId() << std::endl;
+    HD_TRACE_FUNCTION();
+
+    SdfPath const& id = GetId();
+    osc::Scene *scene =
+        static_cast<HdTinyRenderParam*>(renderParam)->GetScene();
+
+    // Anything that changes the mesh's instances in the top-level scene;
+    // material-only edits leave the TLAS alone.
+    const bool instancesDirty =
+        (*dirtyBits & (HdChangeTracker::DirtyPoints
+                       | HdChangeTracker::DirtyTopology
+                       | HdChangeTracker::DirtyTransform
+                       | HdChangeTracker::DirtyVisibility
+                       | HdChangeTracker::DirtyInstancer
+                       | HdChangeTracker::DirtyInstanceIndex)) != 0;
+
+    const bool geometryDirty =
+        HdChangeTracker::IsTopologyDirty(*dirtyBits, id) ||
+        HdChangeTracker::IsPrimvarDirty(*dirtyBits, id, HdTokens->points) ||
+        HdChangeTracker::IsPrimvarDirty(*dirtyBits, id, _tokens->st);
+    if (geometryDirty) {
+        _geometry = _BuildGeometry(sceneDelegate);
+    }
+
+    if (HdChangeTracker::IsTransformDirty(*dirtyBits, id)) {
+        _transform = sceneDelegate->GetTransform(id);
+    }
+
+    if (HdChangeTracker::IsVisibilityDirty(*dirtyBits, id)) {
+        _UpdateVisibility(sceneDelegate, dirtyBits);
+    }
+
+    // Make sure the instancer (and its parents) are synced before pulling
+    // instance transforms from them.
+    _UpdateInstancer(sceneDelegate, dirtyBits);
+    HdInstancer::_SyncInstancerAndParents(
+        sceneDelegate->GetRenderIndex(), GetInstancerId());
+
+    if (_meshID < 0) {
+        _meshID = int(scene->addMesh());
+        // Hits report this for picking, see HdTinyRenderer.
+        scene->setMeshPrimID(uint32_t(_meshID), GetPrimId());
+    }
+    if (instancesDirty || geometryDirty) {
+        scene->setMesh(uint32_t(_meshID), _geometry,
+                       IsVisible()
+                       ? _ComputeInstanceTransforms(sceneDelegate)
+                       : std::vector<osc::affine3f>());
+    }
+
+    if (*dirtyBits & HdChangeTracker::DirtyMaterialId) {
+        SetMaterialId(sceneDelegate->GetMaterialId(id));
+
+        // Material sprims are synced before rprims, so the material's
+        // record already exists; meshes without one use the default.
+        uint16_t materialIndex = osc::Scene::DEFAULT_MATERIAL;
+        if (HdSprim *material = sceneDelegate->GetRenderIndex().GetSprim(
+                HdPrimTypeTokens->material, GetMaterialId())) {
+            materialIndex =
+                static_cast<HdTinyMaterial*>(material)->GetMaterialIndex();
+        }
+        scene->setMeshMaterial(uint32_t(_meshID), materialIndex);
+    }
+
+    *dirtyBits &= ~HdChangeTracker::AllSceneDirtyBits;
+}
+
+void
+HdTinyMesh::Finalize(HdRenderParam *renderParam)
+{
+    if (_meshID >= 0) {
+        static_cast<HdTinyRenderParam*>(renderParam)->GetScene()->
+            removeMesh(uint32_t(_meshID));
+        _meshID = -1;
+    }
+    _geometry.reset();
+}
+
+std::shared_ptr<osc::Geometry>
+HdTinyMesh::_BuildGeometry(HdSceneDelegate *sceneDelegate)
+{
+    SdfPath const& id = GetId();
+
+    const HdMeshTopology topology = GetMeshTopology(sceneDelegate);
+    const VtValue pointsValue = sceneDelegate->Get(id, HdTokens->points);
+    if (!pointsValue.IsHolding<VtVec3fArray>()) {
+        return nullptr;
+    }
+    const VtVec3fArray &points = pointsValue.UncheckedGet<VtVec3fArray>();
+
+    // Texture coordinates, for materials with a diffuse texture; either
+    // per point or per face corner.
+    VtVec2fArray st;
+    bool faceVaryingSt = false;
+    for (HdInterpolation interpolation : { HdInterpolationVertex,
+                                           HdInterpolationVarying,
+                                           HdInterpolationFaceVarying }) {
+        for (HdPrimvarDescriptor const& primvar :
+                 GetPrimvarDescriptors(sceneDelegate, interpolation)) {
+            if (primvar.name != _tokens->st) {
+                continue;
+            }
+            const VtValue stValue = sceneDelegate->Get(id, _tokens->st);
+            const size_t expected =
+                interpolation == HdInterpolationFaceVarying
+                ? topology.GetFaceVertexIndices().size() : points.size();
+            if (stValue.IsHolding<VtVec2fArray>() &&
+                stValue.UncheckedGet<VtVec2fArray>().size() == expected) {
+                st = stValue.UncheckedGet<VtVec2fArray>();
+                faceVaryingSt = interpolation == HdInterpolationFaceVarying;
+            }
+        }
+    }
+
+    // Meshes with identical topology, points and st share one geometry
+    // (and BLAS); only the first one to get here actually builds it.
+    const uint64_t pointsHash = ArchHash64(
+        reinterpret_cast<const char*>(points.cdata()),
+        points.size() * sizeof(GfVec3f));
+    const uint64_t stHash = ArchHash64(
+        reinterpret_cast<const char*>(st.cdata()),
+        st.size() * sizeof(GfVec2f));
+    HdRenderIndex &renderIndex = sceneDelegate->GetRenderIndex();
+    HdTinyResourceRegistry *resourceRegistry =
+        static_cast<HdTinyResourceRegistry*>(
+            renderIndex.GetResourceRegistry().get());
+    const bool optimize =
+        renderIndex.GetRenderDelegate()->GetRenderSetting<bool>(
+            HdTinyRenderSettingsTokens->optimizeMeshes, false);
+
+    HdTinyResourceRegistry::GeometryKey key;
+    key.topology = topology;
+    key.points = points;
+    key.st = st;
+    key.faceVaryingSt = faceVaryingSt;
+    key.optimize = optimize;
+    return resourceRegistry->GetGeometry(
+        TfHash::Combine(topology.ComputeHash(), pointsHash,
+                        stHash, faceVaryingSt, optimize), key,
+        [&](osc::Geometry &geometry) {
+            osc::TriangleMesh &mesh = geometry.mesh;
+            const osc::vec3f *pointData =
+                reinterpret_cast<const osc::vec3f*>(points.cdata());
+            VtIntArray const& faceVertexCounts =
+                topology.GetFaceVertexCounts();
+            VtIntArray const& faceVertexIndices =
+                topology.GetFaceVertexIndices();
+            if (faceVaryingSt) {
+                // every face corner becomes a vertex of its own, so it
+                // can have its own texture coordinates
+                mesh.vertex.resize(faceVertexIndices.size());
+                for (size_t i = 0; i < faceVertexIndices.size(); ++i) {
+                    const int point = faceVertexIndices[i];
+                    mesh.vertex[i] =
+                        point >= 0 && size_t(point) < points.size()
+                        ? pointData[point] : osc::vec3f(0.f);
+                }
+            } else {
+                mesh.vertex.assign(pointData, pointData + points.size());
+            }
+            if (!st.empty()) {
+                mesh.texcoord.assign(
+                    reinterpret_cast<const osc::vec2f*>(st.cdata()),
+                    reinterpret_cast<const osc::vec2f*>(st.cdata())
+                        + st.size());
+            }
+
+            // faces with out-of-range points get dropped, rather than
+            // read out of bounds during traversal
+            const osc::PolygonMesh polygons = {
+                faceVertexCounts.cdata(), faceVertexCounts.size(),
+                faceVertexIndices.cdata(), faceVertexIndices.size(),
+                pointData, points.size()
+            };
+            const int flags =
+                (topology.GetOrientation() == HdTokens->leftHanded
+                    ? osc::TRIANGULATE_FLIP : 0)
+                | (faceVaryingSt ? osc::TRIANGULATE_CORNERS : 0);
+            // Each triangle remembers its face, so that hits can be
+            // reported per face (see the elementId AOV).
+            VtIntArray const& holeIndices = topology.GetHoleIndices();
+            std::vector<int> &triangleFaces = geometry.triangleFaces;
+            mesh.index.resize(osc::maxTriangles(polygons));
+            triangleFaces.resize(mesh.index.size());
+            const size_t numTriangles = osc::triangulate(
+                polygons, mesh.index.data(), triangleFaces.data(), flags);
+            mesh.index.resize(numTriangles);
+            triangleFaces.resize(numTriangles);
+            if (!holeIndices.empty()) {
+                std::vector<bool> isHole(faceVertexCounts.size(), false);
+                for (int face : holeIndices) {
+                    if (face >= 0 && size_t(face) < isHole.size()) {
+                        isHole[face] = true;
+                    }
+                }
+                size_t numKept = 0;
+                for (size_t i = 0; i < numTriangles; ++i) {
+                    if (!isHole[triangleFaces[i]]) {
+                        mesh.index[numKept] = mesh.index[i];
+                        triangleFaces[numKept] = triangleFaces[i];
+                        ++numKept;
+                    }
+                }
+                mesh.index.resize(numKept);
+                triangleFaces.resize(numKept);
+            }
+
+            // Optimizing permutes all per-vertex arrays (texcoords
+            // included) along with the points; the faces have to follow
+            // the triangles' new order by hand.
+            if (optimize) {
+                osc::MeshRemap remap;
+                osc::optimizeMesh(mesh, &remap);
+                std::vector<int> optimizedFaces(remap.triangle.size());
+                for (size_t i = 0; i < remap.triangle.size(); ++i) {
+                    optimizedFaces[i] = triangleFaces[remap.triangle[i]];
+                }
+                triangleFaces.swap(optimizedFaces);
+            }
+            geometry.build();
+        });
+}
+
+std::vector<osc::affine3f>
+HdTinyMesh::_ComputeInstanceTransforms(HdSceneDelegate *sceneDelegate)
+{
+    SdfPath const& instancerId = GetInstancerId();
+    if (instancerId.IsEmpty()) {
+        return { _ToAffine(_transform) };
+    }
+
+    HdInstancer *instancer =
+        sceneDelegate->GetRenderIndex().GetInstancer(instancerId);
+    const VtMatrix4dArray instanceTransforms =
+        static_cast<HdTinyInstancer*>(instancer)->
+            ComputeInstanceTransforms(GetId());
+
+    std::vector<osc::affine3f> transforms(instanceTransforms.size());
+    for (size_t i = 0; i < instanceTransforms.size(); ++i) {
+        transforms[i] = _ToAffine(_transform * instanceTransforms[i]);
+    }
+    return transforms;
 }
 
 PXR_NAMESPACE_CLOSE_SCOPE
@@ -9,6 +9,10 @@
 
 #include "pxr/pxr.h"
 #include "pxr/imaging/hd/mesh.h"
+#include "pxr/base/gf/matrix4d.h"
+#include "Scene.h"
+
+#include <memory>
 
 PXR_NAMESPACE_OPEN_SCOPE
 
@@ -79,6 +83,12 @@ public:
         HdDirtyBits*     dirtyBits,
         TfToken const    &reprToken) override;
 
+    /// Release any resources this class is holding onto: in this case,
+    /// remove the mesh and its instances from the top-level scene.
+    ///   \param renderParam An HdTinyRenderParam object containing the
+    ///                      top-level scene.
+    void Finalize(HdRenderParam *renderParam) override;
+
 protected:
     // Initialize the given representation of this Rprim.
     // This is called prior to syncing the prim, the first time the repr
@@ -111,6 +121,25 @@ protected:
     // This class does not support copying.
     HdTinyMesh(const HdTinyMesh&) = delete;
     HdTinyMesh &operator =(const HdTinyMesh&) = delete;
+
+private:
+    // Pull points and topology, triangulate, and build the BLAS.
+    std::shared_ptr<osc::Geometry> _BuildGeometry(
+        HdSceneDelegate *sceneDelegate);
+
+    // Compute the world transform of each instance of this mesh; a single
+    // one if the mesh isn't instanced.
+    std::vector<osc::affine3f> _ComputeInstanceTransforms(
+        HdSceneDelegate *sceneDelegate);
+
+    // Triangles and BLAS, shared with all instances in the scene.
+    std::shared_ptr<osc::Geometry> _geometry;
+
+    // The mesh's object-to-world transform.
+    GfMatrix4d _transform;
+
+    // Slot of this mesh in the top-level scene, or -1 before first Sync.
+    int _meshID;
 };
 
 PXR_NAMESPACE_CLOSE_SCOPE
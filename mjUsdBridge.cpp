@@ -0,0 +1,898 @@
+// ============================================================================
+// MuJoCo ↔ OpenUSD 桥接：mjSpec 的构建与增量更新
+// ============================================================================
+#include "mjUsdBridge.h"
+#include <pxr/usd/usd/primRange.h>
+#include <pxr/usd/usdGeom/capsule.h>
+#include <pxr/usd/usdGeom/cube.h>
+#include <pxr/usd/usdGeom/cylinder.h>
+#include <pxr/usd/usdGeom/mesh.h>
+#include <pxr/usd/usdGeom/sphere.h>
+#include <pxr/usd/usdGeom/tokens.h>
+#include <pxr/usd/usdGeom/xformable.h>
+#include <pxr/usd/usdGeom/xformCache.h>
+#include <pxr/usd/usdGeom/xformOp.h>
+#include <pxr/base/gf/math.h>
+#include <pxr/base/gf/matrix3d.h>
+#include <pxr/base/gf/matrix4d.h>
+#include <pxr/base/gf/quatd.h>
+#include <pxr/base/tf/staticTokens.h>
+#include <tbb/parallel_for.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+
+using namespace pxr;
+
+TF_DEFINE_PRIVATE_TOKENS(
+    physicsTokens,
+    ((mass, "physics:mass"))
+    ((density, "physics:density"))
+    ((dynamicFriction, "physics:dynamicFriction"))
+    ((rigidBodyEnabled, "physics:rigidBodyEnabled"))
+    (PhysicsRigidBodyAPI)
+);
+
+// MuJoCo 3.3 起 mjs_delete 需要传入 spec
+static void DeleteElement(mjSpec* spec, mjsElement* element)
+{
+#if mjVERSION_HEADER >= 330
+    mjs_delete(spec, element);
+#else
+    (void)spec;
+    mjs_delete(element);
+#endif
+}
+
+static bool IsRigidBody(const UsdPrim& prim)
+{
+    const TfTokenVector schemas = prim.GetAppliedSchemas();
+    if (std::find(schemas.begin(), schemas.end(), physicsTokens->PhysicsRigidBodyAPI) == schemas.end())
+        return false;
+    bool enabled = true;
+    if (UsdAttribute attr = prim.GetAttribute(physicsTokens->rigidBodyEnabled))
+        attr.Get(&enabled);
+    return enabled;
+}
+
+// 世界变换（行向量约定，p' = p * M）拆成 stretch * rigid：rigid 是正交化
+// 后的旋转加平移，stretch = M * R^T 是剩下的缩放和切变，作用在 prim 的局部
+// 坐标上。MuJoCo 的 body 只能表达 rigid，stretch 烘焙进 geom 的顶点和尺寸
+static GfMatrix4d SplitStretch(const GfMatrix4d& world, GfMatrix3d* stretch = nullptr)
+{
+    GfMatrix4d rigid = world;
+    rigid.Orthonormalize(false);
+    // 带镜像时正交化的结果不是旋转，把镜像留给 stretch
+    if (rigid.GetDeterminant3() < 0.0)
+        for (int k = 0; k < 3; ++k)
+            rigid.SetRow3(k, -rigid.GetRow3(k));
+    if (stretch)
+        *stretch = world.ExtractRotationMatrix() * rigid.ExtractRotationMatrix().GetTranspose();
+    return rigid;
+}
+
+// 变换都在 time 上读：仿真写回的位姿是 time 上的时间样本，用默认时间读
+// 会读到最初的位姿
+static GfMatrix3d ReadStretch(const UsdPrim& prim, UsdTimeCode time)
+{
+    GfMatrix3d stretch;
+    SplitStretch(UsdGeomXformCache(time).GetLocalToWorldTransform(prim), &stretch);
+    return stretch;
+}
+
+// body 的位姿：world 下的 body 用世界变换，其余用相对父 body（即父 prim）
+// 的变换，都只取 rigid 部分；stretch 非空时顺便返回 prim 的 stretch
+static GfMatrix4d ReadPose(const UsdPrim& prim, bool topLevel, UsdTimeCode time,
+                           GfMatrix3d* stretch = nullptr)
+{
+    UsdGeomXformCache xformCache(time);
+    const GfMatrix4d pose = SplitStretch(xformCache.GetLocalToWorldTransform(prim), stretch);
+    if (topLevel)
+        return pose;
+    return pose * SplitStretch(xformCache.GetLocalToWorldTransform(prim.GetParent())).GetInverse();
+}
+
+// MuJoCo 只有平移 + 旋转：matrix 应是 SplitStretch 得到的刚体变换，
+// 这里再正交化一次只为去掉数值误差
+static void SetPose(double pos[3], double quat[4], GfMatrix4d matrix)
+{
+    const GfVec3d t = matrix.ExtractTranslation();
+    matrix.Orthonormalize(false);
+    const GfQuatd q = matrix.ExtractRotationQuat();
+    pos[0] = t[0]; pos[1] = t[1]; pos[2] = t[2];
+    quat[0] = q.GetReal();
+    quat[1] = q.GetImaginary()[0];
+    quat[2] = q.GetImaginary()[1];
+    quat[3] = q.GetImaginary()[2];
+}
+
+// 顶点太少或退化成平面的网格 MuJoCo 编译不过，跳过
+static bool IsSolid(const std::vector<osc::vec3f>& vertex)
+{
+    if (vertex.size() < 4)
+        return false;
+    osc::vec3f lower = vertex[0], upper = vertex[0];
+    for (const osc::vec3f& v : vertex)
+    {
+        lower = min(lower, v);
+        upper = max(upper, v);
+    }
+    const osc::vec3f extent = upper - lower;
+    return extent.x > 1e-8f && extent.y > 1e-8f && extent.z > 1e-8f;
+}
+
+// 基本体的类型、尺寸和朝向（MuJoCo 的胶囊/圆柱沿 z 轴，USD 的沿 axis）。
+// stretch 按各局部轴的伸缩烘焙进尺寸：非均匀缩放的球变成椭球，胶囊/圆柱
+// 的半径取两个横轴中较大的伸缩；切变只能近似，忽略
+static bool ReadShape(const UsdPrim& prim, UsdTimeCode time, mjtGeom& type,
+                      double size[3], double quat[4])
+{
+    const GfMatrix3d stretch = ReadStretch(prim, time);
+    double scale[3];
+    for (int k = 0; k < 3; ++k)
+        scale[k] = stretch.GetRow(k).GetLength();
+
+    double radius = 0.0, height = 0.0;
+    TfToken axis = UsdGeomTokens->z;
+    if (prim.IsA<UsdGeomCube>())
+    {
+        double edge = 2.0;
+        UsdGeomCube(prim).GetSizeAttr().Get(&edge);
+        type = mjGEOM_BOX;
+        for (int k = 0; k < 3; ++k)
+            size[k] = 0.5 * edge * scale[k];
+        return true;
+    }
+    if (prim.IsA<UsdGeomSphere>())
+    {
+        radius = 1.0;
+        UsdGeomSphere(prim).GetRadiusAttr().Get(&radius);
+        const bool uniform = GfIsClose(scale[0], scale[1], 1e-6 * scale[0])
+                          && GfIsClose(scale[0], scale[2], 1e-6 * scale[0]);
+        type = uniform ? mjGEOM_SPHERE : mjGEOM_ELLIPSOID;
+        for (int k = 0; k < 3; ++k)
+            size[k] = radius * scale[k];
+        return true;
+    }
+    if (prim.IsA<UsdGeomCapsule>())
+    {
+        UsdGeomCapsule capsule(prim);
+        capsule.GetRadiusAttr().Get(&radius);
+        capsule.GetHeightAttr().Get(&height);
+        capsule.GetAxisAttr().Get(&axis);
+        type = mjGEOM_CAPSULE;
+    }
+    else if (prim.IsA<UsdGeomCylinder>())
+    {
+        UsdGeomCylinder cylinder(prim);
+        cylinder.GetRadiusAttr().Get(&radius);
+        cylinder.GetHeightAttr().Get(&height);
+        cylinder.GetAxisAttr().Get(&axis);
+        type = mjGEOM_CYLINDER;
+    }
+    else
+        return false;
+
+    const int a = axis == UsdGeomTokens->x ? 0 : axis == UsdGeomTokens->y ? 1 : 2;
+    size[0] = radius * std::max(scale[(a + 1) % 3], scale[(a + 2) % 3]);
+    size[1] = 0.5 * height * scale[a];
+    size[2] = 0.0;
+    const double s = std::sqrt(0.5);
+    // z 轴转到 x 轴：绕 y 转 +90°；转到 y 轴：绕 x 转 -90°
+    if (axis == UsdGeomTokens->x)
+    {
+        quat[0] = s; quat[1] = 0; quat[2] = s; quat[3] = 0;
+    }
+    else if (axis == UsdGeomTokens->y)
+    {
+        quat[0] = s; quat[1] = -s; quat[2] = 0; quat[3] = 0;
+    }
+    else
+    {
+        quat[0] = 1; quat[1] = 0; quat[2] = 0; quat[3] = 0;
+    }
+    return true;
+}
+
+// UsdPhysics 的质量、密度、动摩擦；没写（或被删掉）的属性用 MuJoCo 的
+// 默认值，没有显式质量时按密度算。prim 拆成多个 geom 时，每个 geom 分到
+// weight 比例的质量
+static void ReadPhysicsAttributes(mjsGeom* geom, const UsdPrim& prim, double weight = 1.0)
+{
+    mjsGeom defaults;
+    mjs_defaultGeom(&defaults);
+    geom->mass = defaults.mass;
+    geom->density = defaults.density;
+    geom->friction[0] = defaults.friction[0];
+
+    float value = 0.f;
+    UsdAttribute attr;
+    if ((attr = prim.GetAttribute(physicsTokens->mass)) && attr.Get(&value) && value > 0.f)
+        geom->mass = weight * value;
+    if ((attr = prim.GetAttribute(physicsTokens->density)) && attr.Get(&value) && value > 0.f)
+        geom->density = value;
+    if ((attr = prim.GetAttribute(physicsTokens->dynamicFriction)) && attr.Get(&value) && value >= 0.f)
+        geom->friction[0] = value;
+}
+
+static bool IsMeshAttribute(const TfToken& name)
+{
+    return name == UsdGeomTokens->points
+        || name == UsdGeomTokens->faceVertexCounts
+        || name == UsdGeomTokens->faceVertexIndices
+        || name == UsdGeomTokens->orientation;
+}
+
+static bool IsGeomAttribute(const TfToken& name)
+{
+    return name == physicsTokens->mass
+        || name == physicsTokens->density
+        || name == physicsTokens->dynamicFriction
+        || name == UsdGeomTokens->size
+        || name == UsdGeomTokens->radius
+        || name == UsdGeomTokens->height
+        || name == UsdGeomTokens->axis;
+}
+
+MjUsdBridge::MjUsdBridge(const std::string& usdPath, const PhysicsGeometryOptions& physicsOptions)
+    : physicsOptions(physicsOptions)
+{
+    mjv_defaultPerturb(&perturb);
+    if (!physicsOptions.cacheDir.empty())
+    {
+        std::error_code error;
+        std::filesystem::create_directories(physicsOptions.cacheDir, error);
+    }
+    stage = UsdStage::Open(usdPath);
+    if (!stage)
+    {
+        std::cerr << "Failed to open USD stage: " << usdPath << std::endl;
+        return;
+    }
+
+    BuildSpec();
+    model = mj_compile(spec, nullptr);
+    if (!model)
+    {
+        std::cerr << "MuJoCo compile error: " << mjs_getError(spec) << std::endl;
+        return;
+    }
+    data = mj_makeData(model);
+
+    char error[1000] = "";
+    if (mj_saveXML(spec, "scene.xml", error, sizeof(error)) != 0)
+        std::cerr << "Error saving XML: " << error << std::endl;
+
+    noticeKey = TfNotice::Register(TfCreateWeakPtr(this), &MjUsdBridge::OnObjectsChanged,
+                                   UsdStageWeakPtr(stage));
+}
+
+MjUsdBridge::~MjUsdBridge()
+{
+    TfNotice::Revoke(noticeKey);
+    if (data)
+        mj_deleteData(data);
+    if (model)
+        mj_deleteModel(model);
+    if (spec)
+        mj_deleteSpec(spec);
+}
+
+void MjUsdBridge::BuildSpec()
+{
+    spec = mj_makeSpec();
+    world = mjs_findBody(spec, "world");
+    PrebuildPhysicsGeometry(stage->GetPseudoRoot());
+    for (const UsdPrim& child : stage->GetPseudoRoot().GetChildren())
+        AddPrim(world, child);
+    prebuiltGeometry.clear();
+}
+
+void MjUsdBridge::AddPrim(mjsBody* parent, const UsdPrim& prim)
+{
+    if (!prim.IsActive() || !prim.IsDefined() || prim.IsAbstract())
+        return;
+
+    // freejoint 只能加在 world 的子 body 上，刚体用世界位姿挂到 world 下
+    const bool rigid = IsRigidBody(prim);
+    if (rigid)
+        parent = world;
+    const bool topLevel = parent == world;
+
+    const SdfPath& path = prim.GetPath();
+    mjsBody* body = mjs_addBody(parent, nullptr);
+    mjs_setName(body->element, path.GetText());
+    SetPose(body->pos, body->quat, ReadPose(prim, topLevel, syncTime, &stretches[path]));
+    if (topLevel)
+        topLevelBodies.insert(path);
+    if (rigid)
+    {
+        mjs_addFreeJoint(body);
+        bodyNames.push_back(path.GetString());
+        primPaths.push_back(path);
+    }
+
+    AddGeom(body, prim);
+    for (const UsdPrim& child : prim.GetChildren())
+        AddPrim(body, child);
+}
+
+void MjUsdBridge::AddGeom(mjsBody* body, const UsdPrim& prim)
+{
+    if (prim.IsA<UsdGeomMesh>())
+    {
+        AddMeshGeoms(body, prim);
+        return;
+    }
+    mjtGeom type = mjGEOM_BOX;
+    double size[3] = {0, 0, 0};
+    double quat[4] = {1, 0, 0, 0};
+    if (!ReadShape(prim, syncTime, type, size, quat))
+        return;
+
+    mjsGeom* geom = mjs_addGeom(body, nullptr);
+    mjs_setName(geom->element, prim.GetPath().GetText());
+    geom->type = type;
+    std::copy(size, size + 3, geom->size);
+    std::copy(quat, quat + 4, geom->quat);
+    ReadPhysicsAttributes(geom, prim);
+}
+
+void MjUsdBridge::AddMeshGeoms(mjsBody* body, const UsdPrim& prim)
+{
+    PhysicsGeometry physics;
+    const auto prebuilt = prebuiltGeometry.find(prim.GetPath());
+    if (prebuilt != prebuiltGeometry.end())
+    {
+        physics = std::move(prebuilt->second);
+        prebuiltGeometry.erase(prebuilt);
+    }
+    else
+    {
+        VtVec3fArray points;
+        std::vector<osc::vec3i> triangles;
+        ReadPhysicsMesh(prim, points, triangles);
+        BuildPhysicsGeometry(reinterpret_cast<const osc::vec3f*>(points.cdata()), points.size(),
+                             triangles.data(), triangles.size(), physicsOptions, physics);
+    }
+
+    // 每个凸包一个网格资源和 geom；没有凸包时用整个物理 LOD
+    std::vector<const osc::ConvexHull*> hulls;
+    double totalVolume = 0.0;
+    for (const osc::ConvexHull& hull : physics.hulls)
+    {
+        if (hull.empty())
+            continue;
+        hulls.push_back(&hull);
+        totalVolume += hull.volume();
+    }
+    if (hulls.empty() && !IsSolid(physics.vertex))
+        return;
+    const size_t count = hulls.empty() ? 1 : hulls.size();
+
+    const std::string path = prim.GetPath().GetString();
+    MeshGeoms& geoms = meshGeoms[prim.GetPath()];
+    for (size_t i = 0; i < count; ++i)
+    {
+        const std::vector<osc::vec3f>& vertex = hulls.empty() ? physics.vertex : hulls[i]->vertex;
+        const std::vector<osc::vec3i>& index = hulls.empty() ? physics.index : hulls[i]->index;
+        const std::string name = count > 1 ? path + ":hull" + std::to_string(i) : path;
+        mjsMesh* mesh = mjs_addMesh(spec, nullptr);
+        mjs_setName(mesh->element, name.c_str());
+        mjs_setFloat(mesh->uservert, reinterpret_cast<const float*>(vertex.data()), int(3 * vertex.size()));
+        mjs_setInt(mesh->userface, reinterpret_cast<const int*>(index.data()), int(3 * index.size()));
+
+        mjsGeom* geom = mjs_addGeom(body, nullptr);
+        mjs_setName(geom->element, name.c_str());
+        geom->type = mjGEOM_MESH;
+        mjs_setString(geom->meshname, name.c_str());
+        // prim 的质量按凸包体积分给各个 geom
+        const double weight = totalVolume > 0.0 ? hulls[i]->volume() / totalVolume : 1.0 / count;
+        ReadPhysicsAttributes(geom, prim, weight);
+        geoms.names.push_back(name);
+        geoms.weights.push_back(weight);
+    }
+}
+
+void MjUsdBridge::ReadPhysicsMesh(const UsdPrim& prim, VtVec3fArray& points,
+                                  std::vector<osc::vec3i>& triangles)
+{
+    // stretch 烘焙进顶点；带镜像时绕序跟着反转，网格的体积才是正的
+    const GfMatrix3d stretch = ReadStretch(prim, syncTime);
+    ReadMeshTriangles(UsdGeomMesh(prim), points, triangles, stretch.GetDeterminant() < 0.0);
+    if (stretch == GfMatrix3d(1.0))
+        return;
+    for (GfVec3f& p : points)
+        p = p * stretch;
+}
+
+void MjUsdBridge::PrebuildPhysicsGeometry(const UsdPrim& root)
+{
+    // Stage 不保证线程安全，先串行读出所有网格
+    std::vector<SdfPath> paths;
+    std::vector<VtVec3fArray> points;
+    std::vector<std::vector<osc::vec3i>> triangles;
+    for (const UsdPrim& prim : UsdPrimRange(root))
+    {
+        if (!prim.IsA<UsdGeomMesh>())
+            continue;
+        paths.push_back(prim.GetPath());
+        points.emplace_back();
+        triangles.emplace_back();
+        ReadPhysicsMesh(prim, points.back(), triangles.back());
+    }
+
+    std::vector<PhysicsGeometry> geometry(paths.size());
+    tbb::parallel_for(size_t(0), paths.size(), [&](size_t i)
+    {
+        BuildPhysicsGeometry(reinterpret_cast<const osc::vec3f*>(points[i].cdata()), points[i].size(),
+                             triangles[i].data(), triangles[i].size(), physicsOptions, geometry[i]);
+    });
+    for (size_t i = 0; i < paths.size(); ++i)
+        prebuiltGeometry[paths[i]] = std::move(geometry[i]);
+}
+
+void MjUsdBridge::RebuildGeoms(const UsdPrim& prim)
+{
+    mjsBody* body = mjs_findBody(spec, prim.GetPath().GetText());
+    if (!body)
+        return;
+    RemoveGeoms(prim.GetPath());
+    AddGeom(body, prim);
+}
+
+void MjUsdBridge::RemoveGeoms(const SdfPath& path)
+{
+    const auto it = meshGeoms.find(path);
+    const std::vector<std::string> names =
+        it != meshGeoms.end() ? it->second.names : std::vector<std::string>{path.GetString()};
+    // geom 引用着网格资源，先删 geom
+    for (const std::string& name : names)
+    {
+        if (mjsElement* geom = mjs_findElement(spec, mjOBJ_GEOM, name.c_str()))
+            DeleteElement(spec, geom);
+        if (mjsElement* mesh = mjs_findElement(spec, mjOBJ_MESH, name.c_str()))
+            DeleteElement(spec, mesh);
+    }
+    if (it != meshGeoms.end())
+        meshGeoms.erase(it);
+}
+
+void MjUsdBridge::RemovePrim(const SdfPath& path)
+{
+    // 挂在 world 下的后代刚体不在子树里，先单独删
+    for (auto it = topLevelBodies.begin(); it != topLevelBodies.end();)
+    {
+        if (it->HasPrefix(path))
+        {
+            if (mjsBody* body = mjs_findBody(spec, it->GetText()))
+                DeleteElement(spec, body->element);
+            it = topLevelBodies.erase(it);
+        }
+        else
+            ++it;
+    }
+    if (mjsBody* body = mjs_findBody(spec, path.GetText()))
+        DeleteElement(spec, body->element);
+
+    for (auto it = meshGeoms.begin(); it != meshGeoms.end();)
+    {
+        if (it->first.HasPrefix(path))
+        {
+            for (const std::string& name : it->second.names)
+                if (mjsElement* mesh = mjs_findElement(spec, mjOBJ_MESH, name.c_str()))
+                    DeleteElement(spec, mesh);
+            it = meshGeoms.erase(it);
+        }
+        else
+            ++it;
+    }
+
+    for (auto it = stretches.begin(); it != stretches.end();)
+    {
+        if (it->first.HasPrefix(path))
+            it = stretches.erase(it);
+        else
+            ++it;
+    }
+
+    for (size_t i = primPaths.size(); i-- > 0;)
+    {
+        if (primPaths[i].HasPrefix(path))
+        {
+            primPaths.erase(primPaths.begin() + i);
+            bodyNames.erase(bodyNames.begin() + i);
+        }
+    }
+}
+
+mjsBody* MjUsdBridge::FindParentBody(const SdfPath& path)
+{
+    for (SdfPath p = path.GetParentPath(); !p.IsEmpty() && !p.IsAbsoluteRootPath(); p = p.GetParentPath())
+        if (mjsBody* body = mjs_findBody(spec, p.GetText()))
+            return body;
+    return world;
+}
+
+bool MjUsdBridge::PatchGeom(const UsdPrim& prim, bool patchModel)
+{
+    const auto it = meshGeoms.find(prim.GetPath());
+    const std::vector<std::string> names =
+        it != meshGeoms.end() ? it->second.names : std::vector<std::string>{prim.GetPath().GetString()};
+    // 先改 mjSpec，记下编辑前后有没有显式质量、密度和形状的变化
+    std::vector<mjsGeom*> geoms;
+    bool hadMass = false, hasMass = false, reshaped = false;
+    double newMass = 0.0, oldDensity = 0.0, newDensity = 0.0;
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        mjsGeom* geom = mjs_asGeom(mjs_findElement(spec, mjOBJ_GEOM, names[i].c_str()));
+        geoms.push_back(geom);
+        if (!geom)
+            continue;
+        hadMass |= geom->mass > 0;
+        oldDensity = geom->density;
+        if (geom->type != mjGEOM_MESH)
+        {
+            mjtGeom type = geom->type;
+            double size[3], quat[4];
+            std::copy(geom->size, geom->size + 3, size);
+            std::copy(geom->quat, geom->quat + 4, quat);
+            ReadShape(prim, syncTime, type, size, quat);
+            reshaped |= type != geom->type || !std::equal(size, size + 3, geom->size)
+                     || !std::equal(quat, quat + 4, geom->quat);
+            geom->type = type;
+            std::copy(size, size + 3, geom->size);
+            std::copy(quat, quat + 4, geom->quat);
+        }
+        ReadPhysicsAttributes(geom, prim, it != meshGeoms.end() ? it->second.weights[i] : 1.0);
+        if (geom->mass > 0)
+        {
+            hasMass = true;
+            newMass += geom->mass;
+        }
+        newDensity = geom->density;
+    }
+    if (!patchModel)
+        return true;
+    // 尺寸和朝向决定惯量（有显式质量时也一样），质量在显式值和按密度算
+    // 之间切换时也要从头算，这些都交给重新编译
+    if (reshaped || hadMass != hasMass)
+        return false;
+
+    int b = -1;
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        const int g = geoms[i] ? mj_name2id(model, mjOBJ_GEOM, names[i].c_str()) : -1;
+        if (g < 0)
+            continue;
+        b = model->geom_bodyid[g];
+        model->geom_friction[3 * g] = geoms[i]->friction[0];
+    }
+    if (b < 0)
+        return true;
+
+    // body 上只有这个 prim 的 geom，形状没变：质量和惯量按同一比例缩放。
+    // 有显式质量时 MuJoCo 不看密度，按新质量缩放；否则按密度之比
+    double scale = 1.0;
+    if (hasMass && model->body_mass[b] > 0)
+        scale = newMass / model->body_mass[b];
+    else if (!hasMass && oldDensity > 0)
+        scale = newDensity / oldDensity;
+    if (scale != 1.0)
+    {
+        model->body_mass[b] *= scale;
+        mju_scl3(model->body_inertia + 3 * b, model->body_inertia + 3 * b, scale);
+        mj_setConst(model, data);
+    }
+    return true;
+}
+
+void MjUsdBridge::PatchPose(const UsdPrim& prim, bool patchModel)
+{
+    const std::string name = prim.GetPath().GetString();
+    mjsBody* body = mjs_findBody(spec, name.c_str());
+    if (!body)
+        return;
+    SetPose(body->pos, body->quat, ReadPose(prim, topLevelBodies.count(prim.GetPath()) > 0, syncTime));
+    if (!patchModel)
+        return;
+
+    const int b = mj_name2id(model, mjOBJ_BODY, name.c_str());
+    if (b < 0)
+        return;
+    const int j = model->body_jntadr[b];
+    if (model->body_jntnum[b] > 0 && model->jnt_type[j] == mjJNT_FREE)
+    {
+        // 自由刚体的位姿是状态：直接改 qpos，并清零速度
+        mjtNum* qpos = data->qpos + model->jnt_qposadr[j];
+        mju_copy3(qpos, body->pos);
+        mju_copy4(qpos + 3, body->quat);
+        mju_zero(data->qvel + model->jnt_dofadr[j], 6);
+    }
+    else
+    {
+        mju_copy3(model->body_pos + 3 * b, body->pos);
+        mju_copy4(model->body_quat + 4 * b, body->quat);
+    }
+}
+
+void MjUsdBridge::OnObjectsChanged(UsdNotice::ObjectsChanged const& notice,
+                                   UsdStageWeakPtr const& sender)
+{
+    if (syncing || sender != stage)
+        return;
+    // 只记录路径，真正的修改放到下一次 StepAndSync，
+    // 这样连续的多次编辑只重新编译一次
+    for (const SdfPath& path : notice.GetResyncedPaths())
+    {
+        if (path.IsPropertyPath())
+            pendingChanges.insert(path);
+        else
+            pendingResyncs.insert(path);
+    }
+    for (const SdfPath& path : notice.GetChangedInfoOnlyPaths())
+    {
+        // prim 上的元数据（如 apiSchemas）变化按结构变化处理
+        if (path.IsPropertyPath())
+            pendingChanges.insert(path);
+        else
+            pendingResyncs.insert(path);
+    }
+}
+
+void MjUsdBridge::ApplyPendingEdits()
+{
+    if (!model || (pendingResyncs.empty() && pendingChanges.empty()))
+        return;
+    SdfPathVector resyncs(pendingResyncs.begin(), pendingResyncs.end());
+    const SdfPathVector changes(pendingChanges.begin(), pendingChanges.end());
+    pendingResyncs.clear();
+    pendingChanges.clear();
+    SdfPath::RemoveDescendentPaths(&resyncs);
+
+    // 1. 结构变化：删掉旧的子树，按 Stage 现状重新添加
+    bool recompile = false;
+    for (const SdfPath& path : resyncs)
+    {
+        if (path.IsAbsoluteRootPath())
+        {
+            const std::set<SdfPath> bodies = topLevelBodies;
+            for (const SdfPath& body : bodies)
+                RemovePrim(body);
+            PrebuildPhysicsGeometry(stage->GetPseudoRoot());
+            for (const UsdPrim& child : stage->GetPseudoRoot().GetChildren())
+                AddPrim(world, child);
+        }
+        else
+        {
+            RemovePrim(path);
+            if (UsdPrim prim = stage->GetPrimAtPath(path))
+            {
+                PrebuildPhysicsGeometry(prim);
+                AddPrim(FindParentBody(path), prim);
+            }
+        }
+        prebuiltGeometry.clear();
+        recompile = true;
+    }
+
+    // 2. 属性变化
+    std::set<SdfPath> geomEdits, poseEdits;
+    for (const SdfPath& path : changes)
+    {
+        const bool covered = std::any_of(resyncs.begin(), resyncs.end(),
+                                         [&](const SdfPath& p) { return path.HasPrefix(p); });
+        if (covered)
+            continue;
+        const SdfPath primPath = path.GetPrimPath();
+        UsdPrim prim = stage->GetPrimAtPath(primPath);
+        if (!prim)
+            continue;
+
+        const TfToken& name = path.GetNameToken();
+        if (IsMeshAttribute(name))
+        {
+            // 顶点或拓扑变了，物理 LOD 和凸分解要重算，geom 的个数也可能变
+            RebuildGeoms(prim);
+            recompile = true;
+        }
+        else if (name == physicsTokens->rigidBodyEnabled)
+        {
+            RemovePrim(primPath);
+            AddPrim(FindParentBody(primPath), prim);
+            recompile = true;
+        }
+        else if (UsdGeomXformOp::IsXformOp(name) || name == UsdGeomTokens->xformOpOrder)
+        {
+            // 缩放或切变变了：geom 要重新烘焙，子 prim 的 stretch 也跟着变，
+            // 整个子树重建；位姿照样在编译后写进去
+            const auto stretch = stretches.find(primPath);
+            if (stretch != stretches.end() && !GfIsClose(ReadStretch(prim, syncTime), stretch->second, 1e-9))
+            {
+                RemovePrim(primPath);
+                PrebuildPhysicsGeometry(prim);
+                AddPrim(FindParentBody(primPath), prim);
+                prebuiltGeometry.clear();
+                recompile = true;
+            }
+            poseEdits.insert(primPath);
+        }
+        else if (IsGeomAttribute(name))
+            geomEdits.insert(primPath);
+    }
+
+    // 3. 要重新编译时参数只改 mjSpec，否则原地改 mjModel；有原地改不了的
+    //    编辑就改成重新编译，之前的编辑都已写进 mjSpec，不会丢
+    for (const SdfPath& path : geomEdits)
+        if (!PatchGeom(stage->GetPrimAtPath(path), !recompile))
+            recompile = true;
+    if (recompile)
+    {
+        // body 编号可能变了，正在进行的拖拽作废
+        EndDrag();
+        if (mj_recompile(spec, nullptr, model, data) != 0)
+            std::cerr << "MuJoCo recompile error: " << mjs_getError(spec) << std::endl;
+        // 状态向量的大小可能变了，旧检查点作废
+        checkpoints.Reset(model, checkpoints.Capacity());
+        // 尺寸变了就按新模型重建通道，并发布当前状态：客户端重新打开后
+        // 有观测可读，不会和我们互相等着
+        if (channel.IsOpen() && !channel.Matches(model))
+            channel.Publish(model, data);
+    }
+    // mj_recompile 保留了旧的 qpos，自由刚体的新位姿要在编译后再写进去
+    for (const SdfPath& path : poseEdits)
+        PatchPose(stage->GetPrimAtPath(path), true);
+}
+
+bool MjUsdBridge::BeginDrag(const SdfPath& primPath, const GfVec3d& worldPoint)
+{
+    EndDrag();
+    if (!model)
+        return false;
+    const int b = mj_name2id(model, mjOBJ_BODY, primPath.GetText());
+    if (b <= 0 || model->body_weldid[b] == 0)
+        return false;
+
+    // 抓取点换到 body 坐标系
+    const mjtNum point[3] = {worldPoint[0], worldPoint[1], worldPoint[2]};
+    mjtNum offset[3];
+    mju_sub3(offset, point, data->xpos + 3 * b);
+    mju_mulMatTVec3(perturb.localpos, data->xmat + 9 * b, offset);
+    perturb.select = b;
+    perturb.active = mjPERT_TRANSLATE;
+
+    // 场景只用来算 perturb.scale（鼠标拖拽的缩放），这里用不到
+    mjvScene scene;
+    mjv_defaultScene(&scene);
+    mjv_initPerturb(model, data, &scene, &perturb);
+    return true;
+}
+
+void MjUsdBridge::MoveDragTarget(const GfVec3d& delta)
+{
+    if (!perturb.active)
+        return;
+    const mjtNum move[3] = {delta[0], delta[1], delta[2]};
+    mju_addTo3(perturb.refpos, move);
+    mju_addTo3(perturb.refselpos, move);
+}
+
+void MjUsdBridge::EndDrag()
+{
+    if (data && perturb.select > 0)
+        mju_zero(data->xfrc_applied + 6 * perturb.select, 6);
+    mjv_defaultPerturb(&perturb);
+}
+
+bool MjUsdBridge::OpenChannel(const std::string& name, bool lockstep, double stepBudget)
+{
+    if (!model || !channel.Create(name, model))
+        return false;
+    this->lockstep = lockstep;
+    this->stepBudget = stepBudget;
+    // 先发布初始状态，客户端等到它就可以开始算第一个动作
+    channel.Publish(model, data);
+    return true;
+}
+
+void MjUsdBridge::Step()
+{
+    if (perturb.active)
+    {
+        mju_zero(data->xfrc_applied + 6 * perturb.select, 6);
+        mjv_applyPerturbForce(model, data, &perturb);
+    }
+    mj_step(model, data);
+    ++stepCount;
+    if (checkpointInterval > 0 && stepCount % checkpointInterval == 0)
+        checkpoints.Save(model, data, stepCount);
+    channel.Publish(model, data);
+}
+
+void MjUsdBridge::EnableCheckpoints(int interval, int capacity)
+{
+    checkpointInterval = interval > 0 ? interval : 0;
+    if (model)
+        checkpoints.Reset(model, checkpointInterval > 0 ? capacity : 0);
+}
+
+bool MjUsdBridge::Rewind(int back)
+{
+    if (!model)
+        return false;
+    // 正好停在最近的检查点上（比如刚回退过）时，它不算一个
+    if (checkpoints.Size() > 0 && checkpoints.LatestStep() == stepCount)
+        ++back;
+    back = std::min(back, checkpoints.Size() - 1);
+    if (!checkpoints.Restore(model, data, back, &stepCount))
+        return false;
+    channel.Publish(model, data);
+    return true;
+}
+
+void MjUsdBridge::StepAndSync(double time, int frame)
+{
+    ApplyPendingEdits();
+    if (!model || !data)
+        return;
+    if (channel.IsOpen() && lockstep)
+    {
+        const double deadline = std::chrono::duration<double>(
+            std::chrono::steady_clock::now().time_since_epoch()).count() + stepBudget;
+        // 一个动作一步，最多用到 deadline。没读到完整的动作（ReadAction 里
+        // 已经退避过）或尺寸对不上时不步进，这一帧到此为止，下一帧再读
+        while (channel.WaitForAction(deadline))
+        {
+            if (!channel.ReadAction(model, data))
+                break;
+            Step();
+        }
+    }
+    else
+    {
+        channel.ReadAction(model, data);
+        Step();
+    }
+
+    if (bodyNames.size() != primPaths.size())
+    {
+        std::cerr << "bodyNames and primPaths size mismatch!" << std::endl;
+        return;
+    }
+    // 写回 Stage 的是相对父 prim 的局部变换
+    UsdGeomXformCache xformCache(time);
+    syncing = true;
+    for (size_t i = 0; i < bodyNames.size(); ++i)
+    {
+        int id = mj_name2id(model, mjOBJ_BODY, bodyNames[i].c_str());
+        if (id < 0)
+            continue;
+        UsdPrim prim = stage->GetPrimAtPath(primPaths[i]);
+        UsdGeomXformable x(prim);
+        if (!x)
+            continue;
+        const double* pos = data->xpos + 3 * id;
+        const double* quat = data->xquat + 4 * id; // w x y z
+        GfMatrix4d mat;
+        GfQuatd q(quat[0], quat[1], quat[2], quat[3]);
+        mat.SetRotate(q);
+        mat.SetTranslateOnly(GfVec3d(pos[0], pos[1], pos[2]));
+        const GfMatrix4d parent = xformCache.GetLocalToWorldTransform(prim.GetParent());
+        // 仿真只改 rigid 部分，烘焙进 geom 的 stretch 原样写回
+        const auto stretch = stretches.find(primPaths[i]);
+        if (stretch != stretches.end())
+            mat = GfMatrix4d(stretch->second, GfVec3d(0.0)) * mat;
+
+        UsdGeomXformOp op = x.GetTransformOp();
+        if (!op)
+        {
+            x.ClearXformOpOrder();
+            op = x.AddTransformOp();
+        }
+        op.Set(mat * parent.GetInverse(), time);
+    }
+    syncing = false;
+    syncTime = time;
+}
@@ -0,0 +1,139 @@
+// ============================================================================
+// MuJoCo ↔ OpenUSD 桥接：由 Stage 构建 mjSpec，增量同步 Stage 上的编辑，
+// 并把仿真得到的刚体位姿写回 Stage
+// ============================================================================
+#pragma once
+
+#include <pxr/usd/usd/notice.h>
+#include <pxr/usd/usd/stage.h>
+#include <pxr/usd/usd/timeCode.h>
+#include <pxr/usd/sdf/path.h>
+#include <pxr/base/gf/matrix3d.h>
+#include <pxr/base/gf/vec3d.h>
+#include <pxr/base/tf/notice.h>
+#include <pxr/base/tf/weakBase.h>
+#include <mujoco/mujoco.h>
+#include "checkpointRing.h"
+#include "physicsGeometry.h"
+#include "shmChannel.h"
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+// MuJoCo 模型与 USD Stage 的双向同步。
+//
+// 每个 prim 对应一个 body（名字就是 prim 路径），Cube/Sphere/Capsule/
+// Cylinder 各带一个同名 geom；Mesh 按 physicsOptions 简化并做凸分解
+// （见 physicsGeometry.h），每个凸包一个网格资源和 geom（只有一个时同名，
+// 否则名为 "<prim 路径>:hull<i>"），分解不出凸包时用整个物理 LOD。
+// 带 PhysicsRigidBodyAPI 的 prim 挂到 world 下并加 freejoint，其余 body
+// 焊接在父 body 上。body 只取 prim 世界变换的旋转和平移，缩放和切变
+// （stretch）烘焙进网格顶点和基本体尺寸，写回 Stage 时原样保留。
+//
+// Stage 的编辑通过 UsdNotice::ObjectsChanged 收集，在下一次 StepAndSync 时
+// 一次性应用到 mjSpec 上：
+//   - 增删 prim、网格顶点或拓扑变化（重建该网格的物理几何）、刚体开关、
+//     改变 stretch 的位姿编辑（重建子树）、基本体尺寸、显式质量的增删：
+//     修改 mjSpec，用 mj_recompile 重新编译，mjData 的状态保留；
+//   - 质量、密度、摩擦、位姿：同时改 mjSpec 和 mjModel 里对应的字段，
+//     不重新编译。
+class MjUsdBridge : public pxr::TfWeakBase {
+public:
+    explicit MjUsdBridge(const std::string& usdPath,
+                         const PhysicsGeometryOptions& physicsOptions = PhysicsGeometryOptions());
+    ~MjUsdBridge();
+
+    pxr::UsdStageRefPtr GetStage() { return stage; }
+
+    void StepAndSync(double time, int frame);
+
+    // 拖拽：用 mjvPerturb 在选中点和目标点之间加弹簧力，不改写 Stage。
+    // BeginDrag 选中 prim 对应的 body 和世界坐标下的抓取点（body 焊在
+    // world 上时返回 false）；之后每个输入事件只移动目标点
+    bool BeginDrag(const pxr::SdfPath& primPath, const pxr::GfVec3d& worldPoint);
+    void MoveDragTarget(const pxr::GfVec3d& delta);
+    void EndDrag();
+    bool IsDragging() const { return perturb.active != 0; }
+
+    // 外部控制器的共享内存通道（格式见 shmChannel.h）。默认每帧一步，用
+    // 客户端最新的动作；lockstep 时由客户端驱动：每帧在 stepBudget 秒内
+    // 每收到一个动作就步进一次并发布观测
+    bool OpenChannel(const std::string& name, bool lockstep = false, double stepBudget = 0.01);
+
+    // 每 interval 步把状态存进检查点环，最多保留 capacity 个；interval 为 0 关闭
+    void EnableCheckpoints(int interval, int capacity);
+    // 回退到倒数第 back 个检查点并从那里继续；连着回退会一直往前退
+    bool Rewind(int back = 0);
+    int CheckpointCount() const { return checkpoints.Size(); }
+
+private:
+    void BuildSpec();
+    void Step();
+    // 为 prim 及其子树添加 body（刚体挂到 world 下）
+    void AddPrim(mjsBody* parent, const pxr::UsdPrim& prim);
+    void AddGeom(mjsBody* body, const pxr::UsdPrim& prim);
+    void AddMeshGeoms(mjsBody* body, const pxr::UsdPrim& prim);
+    // 网格三角化后的顶点和面，物理几何由它构建
+    void ReadPhysicsMesh(const pxr::UsdPrim& prim, pxr::VtVec3fArray& points,
+                         std::vector<osc::vec3i>& triangles);
+    // 物理 LOD 和凸分解最耗时：添加子树前先对其中所有网格并行算好，
+    // AddMeshGeoms 直接取用
+    void PrebuildPhysicsGeometry(const pxr::UsdPrim& root);
+    // 删掉 prim 的 geom 和网格资源，按 Stage 现状重新添加
+    void RebuildGeoms(const pxr::UsdPrim& prim);
+    void RemoveGeoms(const pxr::SdfPath& path);
+    // 删除 prim 子树的 body、挂到 world 下的刚体后代和网格资源
+    void RemovePrim(const pxr::SdfPath& path);
+    mjsBody* FindParentBody(const pxr::SdfPath& path);
+
+    // 参数编辑：改 mjSpec，patchModel 时同时原地修改 mjModel。PatchGeom
+    // 改不了 mjModel（质量或惯量要从头算）时返回 false，由调用方重新编译
+    bool PatchGeom(const pxr::UsdPrim& prim, bool patchModel);
+    void PatchPose(const pxr::UsdPrim& prim, bool patchModel);
+
+    void OnObjectsChanged(pxr::UsdNotice::ObjectsChanged const& notice,
+                          pxr::UsdStageWeakPtr const& sender);
+    void ApplyPendingEdits();
+
+    pxr::UsdStageRefPtr stage;
+    PhysicsGeometryOptions physicsOptions;
+    mjSpec* spec = nullptr;
+    mjsBody* world = nullptr;
+    mjModel* model = nullptr;
+    mjData* data = nullptr;
+    mjvPerturb perturb;
+
+    CheckpointRing checkpoints;
+    int checkpointInterval = 0;
+    uint64_t stepCount = 0;
+
+    ShmChannel channel;
+    bool lockstep = false;
+    double stepBudget = 0.01;
+
+    // 带 freejoint 的 body，仿真后位姿要写回 Stage
+    std::vector<std::string> bodyNames;
+    std::vector<pxr::SdfPath> primPaths;
+    // world 下的 body：Stage 顶层 prim 和刚体
+    std::set<pxr::SdfPath> topLevelBodies;
+    // 每个 body 的 prim 烘焙进 geom 的 stretch
+    std::map<pxr::SdfPath, pxr::GfMatrix3d> stretches;
+    // Mesh prim 的 geom 名字（网格资源与 geom 同名），以及各 geom 按凸包
+    // 体积分到的质量比例
+    struct MeshGeoms {
+        std::vector<std::string> names;
+        std::vector<double> weights;
+    };
+    std::map<pxr::SdfPath, MeshGeoms> meshGeoms;
+    std::map<pxr::SdfPath, PhysicsGeometry> prebuiltGeometry;
+
+    // 尚未应用的编辑
+    pxr::TfNotice::Key noticeKey;
+    std::set<pxr::SdfPath> pendingResyncs;
+    std::set<pxr::SdfPath> pendingChanges;
+    // 写回位姿时自己触发的通知要忽略
+    bool syncing = false;
+    // 最近一次写回位姿的时间；重建和参数编辑都在这个时间上读变换
+    pxr::UsdTimeCode syncTime = pxr::UsdTimeCode::Default();
+};
@@ -0,0 +1,103 @@
+// ============================================================================
+// 物理几何：简化 LOD、凸分解和它们的磁盘缓存
+// ============================================================================
+#include "physicsGeometry.h"
+#include "MeshSimplifier.h"
+#include "Triangulate.h"
+#include <pxr/usd/usdGeom/tokens.h>
+#include <pxr/base/arch/hash.h>
+#include <cstdio>
+#include <iostream>
+
+using namespace pxr;
+
+// 磁盘缓存文件名：<cacheDir><prefix>_<16 位十六进制哈希>.bin
+static std::string PhysicsCacheFile(const std::string& cacheDir,
+                                    const char* prefix, uint64_t key)
+{
+    char keyText[17];
+    snprintf(keyText, sizeof(keyText), "%016llx", (unsigned long long)key);
+    return cacheDir + prefix + "_" + keyText + ".bin";
+}
+
+template <typename T>
+static uint64_t HashArray(const T* data, size_t count, uint64_t seed)
+{
+    return ArchHash64(reinterpret_cast<const char*>(data),
+                      count * sizeof(T), seed);
+}
+
+bool ReadMeshTriangles(const UsdGeomMesh& mesh, VtVec3fArray& points,
+                       std::vector<osc::vec3i>& triangles, bool flip)
+{
+    mesh.GetPointsAttr().Get(&points);
+    VtArray<int> faceCounts;
+    mesh.GetFaceVertexCountsAttr().Get(&faceCounts);
+    VtArray<int> faceIndices;
+    mesh.GetFaceVertexIndicesAttr().Get(&faceIndices);
+    TfToken orientation = UsdGeomTokens->rightHanded;
+    mesh.GetOrientationAttr().Get(&orientation);
+    if (orientation == UsdGeomTokens->leftHanded)
+        flip = !flip;
+
+    const osc::PolygonMesh polygons = {
+        faceCounts.cdata(), faceCounts.size(),
+        faceIndices.cdata(), faceIndices.size(),
+        reinterpret_cast<const osc::vec3f*>(points.cdata()),
+        points.size()
+    };
+    const size_t maxTriangles = osc::maxTriangles(polygons);
+    triangles.resize(maxTriangles);
+    triangles.resize(osc::triangulate(polygons, triangles.data(), nullptr,
+                                      flip ? osc::TRIANGULATE_FLIP : 0));
+    return triangles.size() == maxTriangles;
+}
+
+void BuildPhysicsGeometry(const osc::vec3f* points, size_t numPoints,
+                          const osc::vec3i* triangles, size_t numTriangles,
+                          const PhysicsGeometryOptions& options,
+                          PhysicsGeometry& out)
+{
+    const bool cache = !options.cacheDir.empty();
+    const size_t budget = options.physicsTriangleBudget;
+    if (budget > 0 && numTriangles > budget) {
+        uint64_t key = HashArray(points, numPoints, 0);
+        key = HashArray(triangles, numTriangles, key);
+        key = HashArray(&budget, 1, key);
+        const std::string lodFile =
+            PhysicsCacheFile(options.cacheDir, "lod", key);
+        if (!cache || !osc::loadSimplifiedMesh(lodFile, key,
+                                               out.vertex, out.index)) {
+            osc::simplifyMesh(points, numPoints, triangles, numTriangles,
+                              budget, out.vertex, out.index);
+            if (cache && !osc::saveSimplifiedMesh(lodFile, key, out.vertex,
+                                                  out.index)) {
+                std::cerr << "Failed to write LOD cache: " << lodFile
+                          << std::endl;
+            }
+        }
+    } else {
+        out.vertex.assign(points, points + numPoints);
+        out.index.assign(triangles, triangles + numTriangles);
+    }
+
+    out.hulls.clear();
+    if (!options.convexDecomposition) {
+        return;
+    }
+    uint64_t key = HashArray(out.vertex.data(), out.vertex.size(), 0);
+    key = HashArray(out.index.data(), out.index.size(), key);
+    key = HashArray(&options.hullParams, 1, key);
+    const std::string hullFile =
+        PhysicsCacheFile(options.cacheDir, "hulls", key);
+    if (!cache || !osc::loadHullCache(hullFile, key, out.hulls)) {
+        out.hulls = osc::decomposeConvex(
+            out.vertex.data(), out.vertex.size(),
+            out.index.data(), out.index.size(),
+            options.hullParams);
+        if (cache && !osc::saveHullCache(hullFile, key, out.hulls)) {
+            std::cerr << "Failed to write hull cache: " << hullFile
+                      << std::endl;
+        }
+    }
+}
@@ -0,0 +1,42 @@
+// ============================================================================
+// 物理几何：由渲染网格生成 MuJoCo 用的简化 LOD 和凸分解
+// ============================================================================
+#pragma once
+
+#include <pxr/usd/usdGeom/mesh.h>
+#include <pxr/base/vt/types.h>
+#include "ConvexDecomposition.h"
+#include <string>
+#include <vector>
+
+// MuJoCo 用的物理网格和 Hydra 渲染的网格分开，渲染始终用完整网格，
+// 物理只用简化后的 LOD 或它的凸分解
+struct PhysicsGeometryOptions {
+    // 物理网格的三角形上限，超出时用二次误差边折叠简化；0 表示不简化
+    size_t physicsTriangleBudget = 5000;
+    // 是否把凹网格分解成多个凸包（否则 MuJoCo 只用整个网格的凸包碰撞）
+    bool convexDecomposition = true;
+    osc::DecompositionParams hullParams;
+    // LOD 和凸包的磁盘缓存目录（带结尾的 /）；空表示不缓存
+    std::string cacheDir;
+};
+
+struct PhysicsGeometry {
+    // 物理 LOD
+    std::vector<osc::vec3f> vertex;
+    std::vector<osc::vec3i> index;
+    // LOD 的凸分解；不做凸分解，或分解不出有体积的凸包（例如退化网格）时为空
+    std::vector<osc::ConvexHull> hulls;
+};
+
+// 读出 USD 网格的顶点并三角化（凸面扇形，凹面剪耳），leftHanded 的网格
+// 反转绕序，flip 时再反转一次。有面被丢弃时返回 false
+bool ReadMeshTriangles(const pxr::UsdGeomMesh& mesh, pxr::VtVec3fArray& points,
+                       std::vector<osc::vec3i>& triangles, bool flip = false);
+
+// 物理 LOD 和凸包，两者都按输入和参数的哈希缓存在 cacheDir 下，再次构建时
+// 直接复用。不同网格可以并行构建
+void BuildPhysicsGeometry(const osc::vec3f* points, size_t numPoints,
+                          const osc::vec3i* triangles, size_t numTriangles,
+                          const PhysicsGeometryOptions& options,
+                          PhysicsGeometry& out);
@@ -0,0 +1,130 @@
+//
+// Copyright 2020 Pixar
+//
+// Licensed under the terms set forth in the LICENSE.txt file available at
+// https://openusd.org/license.
+//
+#include "renderBuffer.h"
+
+#include "pxr/base/gf/math.h"
+
+#include <algorithm>
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+HdTinyRenderBuffer::HdTinyRenderBuffer(SdfPath const& id)
+    : HdRenderBuffer(id)
+    , _width(0)
+    , _height(0)
+    , _format(HdFormatInvalid)
+    , _buffer()
+    , _mappers(0)
+    , _converged(false)
+{
+}
+
+HdTinyRenderBuffer::~HdTinyRenderBuffer() = default;
+
+bool
+HdTinyRenderBuffer::Allocate(GfVec3i const& dimensions,
+                             HdFormat format,
+                             bool multiSampled)
+{
+    _Deallocate();
+
+    if (dimensions[2] != 1) {
+        TF_WARN("Render buffer allocated with dims <%d, %d, %d> and"
+                " format %s; depth must be 1!",
+                dimensions[0], dimensions[1], dimensions[2],
+                TfEnum::GetName(format).c_str());
+        return false;
+    }
+
+    _width = dimensions[0];
+    _height = dimensions[1];
+    _format = format;
+    _buffer.resize(_width * _height * HdDataSizeOfFormat(format), 0);
+    return true;
+}
+
+void
+HdTinyRenderBuffer::_Deallocate()
+{
+    // If the buffer is mapped while we're doing this, there's not a great
+    // recovery path...
+    TF_VERIFY(!IsMapped());
+
+    _width = 0;
+    _height = 0;
+    _format = HdFormatInvalid;
+    _buffer.resize(0);
+    _mappers.store(0);
+    _converged.store(false);
+}
+
+void
+HdTinyRenderBuffer::Write(GfVec3i const& pixel,
+                          size_t numComponents,
+                          float const* value)
+{
+    const HdFormat componentFormat = HdGetComponentFormat(_format);
+    const size_t componentCount = HdGetComponentCount(_format);
+    const size_t formatSize = HdDataSizeOfFormat(_format);
+    const size_t idx = (pixel[1] * _width + pixel[0]) * formatSize;
+
+    if (componentFormat == HdFormatFloat32) {
+        float *dst = reinterpret_cast<float*>(&_buffer[idx]);
+        for (size_t c = 0; c < componentCount; ++c) {
+            dst[c] = (c < numComponents) ? value[c] : 0.0f;
+        }
+    } else if (componentFormat == HdFormatUNorm8) {
+        uint8_t *dst = &_buffer[idx];
+        for (size_t c = 0; c < componentCount; ++c) {
+            dst[c] = (c < numComponents)
+                ? uint8_t(GfClamp(value[c], 0.0f, 1.0f) * 255.0f + 0.5f)
+                : 0;
+        }
+    } else if (componentFormat == HdFormatInt32) {
+        int32_t *dst = reinterpret_cast<int32_t*>(&_buffer[idx]);
+        for (size_t c = 0; c < componentCount; ++c) {
+            dst[c] = (c < numComponents) ? int32_t(value[c]) : 0;
+        }
+    } else {
+        TF_CODING_ERROR("Unsupported format for pixel write");
+    }
+}
+
+void
+HdTinyRenderBuffer::Write(GfVec3i const& pixel,
+                          size_t numComponents,
+                          int const* value)
+{
+    if (HdGetComponentFormat(_format) != HdFormatInt32) {
+        float floatValue[4];
+        numComponents = std::min(numComponents, size_t(4));
+        for (size_t c = 0; c < numComponents; ++c) {
+            floatValue[c] = float(value[c]);
+        }
+        Write(pixel, numComponents, floatValue);
+        return;
+    }
+    const size_t componentCount = HdGetComponentCount(_format);
+    const size_t idx =
+        (pixel[1] * _width + pixel[0]) * HdDataSizeOfFormat(_format);
+    int32_t *dst = reinterpret_cast<int32_t*>(&_buffer[idx]);
+    for (size_t c = 0; c < componentCount; ++c) {
+        dst[c] = (c < numComponents) ? value[c] : 0;
+    }
+}
+
+void
+HdTinyRenderBuffer::Clear(size_t numComponents, float const* value)
+{
+    for (unsigned int y = 0; y < _height; ++y) {
+        for (unsigned int x = 0; x < _width; ++x) {
+            Write(GfVec3i(x, y, 1), numComponents, value);
+        }
+    }
+}
+
+PXR_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,107 @@
+//
+// Copyright 2020 Pixar
+//
+// Licensed under the terms set forth in the LICENSE.txt file available at
+// https://openusd.org/license.
+//
+#ifndef EXTRAS_IMAGING_EXAMPLES_HD_TINY_RENDER_BUFFER_H
+#define EXTRAS_IMAGING_EXAMPLES_HD_TINY_RENDER_BUFFER_H
+
+#include "pxr/pxr.h"
+#include "pxr/imaging/hd/renderBuffer.h"
+
+#include <atomic>
+#include <vector>
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+/// \class HdTinyRenderBuffer
+///
+/// A CPU-side image buffer that the render pass writes AOV data (color,
+/// depth) into. Hydra's present task maps it to get the pixels to the
+/// screen.
+///
+class HdTinyRenderBuffer final : public HdRenderBuffer
+{
+public:
+    HdTinyRenderBuffer(SdfPath const& id);
+    ~HdTinyRenderBuffer() override;
+
+    /// Allocate a new buffer with the given dimensions and format.
+    ///   \param dimensions Width, height, and depth of the desired buffer.
+    ///                     (Only depth==1 is supported).
+    ///   \param format The format of the desired buffer.
+    ///   \param multiSampled Ignored; HdTiny renders one sample per pixel.
+    ///   \return True if the buffer was successfully allocated.
+    bool Allocate(GfVec3i const& dimensions,
+                  HdFormat format,
+                  bool multiSampled) override;
+
+    unsigned int GetWidth() const override { return _width; }
+    unsigned int GetHeight() const override { return _height; }
+    unsigned int GetDepth() const override { return 1; }
+    HdFormat GetFormat() const override { return _format; }
+    bool IsMultiSampled() const override { return false; }
+
+    /// Map the buffer for reading/writing.
+    void* Map() override {
+        _mappers++;
+        return _buffer.data();
+    }
+
+    /// Unmap the buffer.
+    void Unmap() override {
+        _mappers--;
+    }
+
+    /// Return whether any clients have this buffer mapped currently.
+    bool IsMapped() const override {
+        return _mappers.load() != 0;
+    }
+
+    /// Whether the renderer has all the samples it accumulates for the
+    /// image in this buffer.
+    bool IsConverged() const override {
+        return _converged.load();
+    }
+
+    /// Set the convergence flag.
+    void SetConverged(bool cv) {
+        _converged.store(cv);
+    }
+
+    /// No multisampling, so nothing to resolve.
+    void Resolve() override {}
+
+    /// Write a pixel, converting from float to the buffer's format.
+    ///   \param pixel The (x,y) pixel coordinate to write to.
+    ///   \param numComponents The number of components in value.
+    ///   \param value The value to write.
+    void Write(GfVec3i const& pixel, size_t numComponents,
+               float const* value);
+
+    /// Write a pixel of integers, eg IDs, which don't all survive a
+    /// round trip through float.
+    void Write(GfVec3i const& pixel, size_t numComponents,
+               int const* value);
+
+    /// Fill the whole buffer with the given value.
+    void Clear(size_t numComponents, float const* value);
+
+private:
+    // Release any allocated resources.
+    void _Deallocate() override;
+
+    unsigned int _width;
+    unsigned int _height;
+    HdFormat _format;
+
+    std::vector<uint8_t> _buffer;
+
+    std::atomic<int> _mappers;
+    std::atomic<bool> _converged;
+};
+
+PXR_NAMESPACE_CLOSE_SCOPE
+
+#endif // EXTRAS_IMAGING_EXAMPLES_HD_TINY_RENDER_BUFFER_H
@@ -5,13 +5,23 @@
 // https://openusd.org/license.
 //
 #include "renderDelegate.h"
+#include "instancer.h"
+#include "light.h"
+#include "material.h"
 #include "mesh.h"
+#include "renderBuffer.h"
 #include "renderPass.h"
+#include "resourceRegistry.h"
+
+#include "pxr/imaging/hd/camera.h"
 
 #include <iostream>
 
 PXR_NAMESPACE_OPEN_SCOPE
 
+TF_DEFINE_PUBLIC_TOKENS(HdTinyRenderSettingsTokens,
+                        HDTINY_RENDER_SETTINGS_TOKENS);
+
 const TfTokenVector HdTinyRenderDelegate::SUPPORTED_RPRIM_TYPES =
 {
     HdPrimTypeTokens->mesh,
@@ -19,10 +29,17 @@ const TfTokenVector HdTinyRenderDelegate::SUPPORTED_RPRIM_TYPES =
 
 const TfTokenVector HdTinyRenderDelegate::SUPPORTED_SPRIM_TYPES =
 {
+    HdPrimTypeTokens->camera,
+    HdPrimTypeTokens->material,
+    HdPrimTypeTokens->distantLight,
+    HdPrimTypeTokens->sphereLight,
+    HdPrimTypeTokens->rectLight,
+    HdPrimTypeTokens->domeLight,
 };
 
 const TfTokenVector HdTinyRenderDelegate::SUPPORTED_BPRIM_TYPES =
 {
+    HdPrimTypeTokens->renderBuffer,
 };
 
 HdTinyRenderDelegate::HdTinyRenderDelegate()
@@ -42,7 +59,8 @@ void
 HdTinyRenderDelegate::_Initialize()
 {
     std::cout << "Creating Tiny RenderDelegate" << std::endl;
-    _resourceRegistry = std::make_shared<HdResourceRegistry>();
+    _resourceRegistry = std::make_shared<HdTinyResourceRegistry>();
+    _renderParam = std::make_unique<HdTinyRenderParam>(&_scene);
 }
 
 HdTinyRenderDelegate::~HdTinyRenderDelegate()
@@ -79,6 +97,9 @@ void
 HdTinyRenderDelegate::CommitResources(HdChangeTracker *tracker)
 {
     std::cout << "=> CommitResources RenderDelegate" << std::endl;
+    _scene.commit();
+    // Release deduplicated geometry no mesh refers to anymore.
+    _resourceRegistry->GarbageCollect();
 }
 
 HdRenderPassSharedPtr 
@@ -121,47 +142,77 @@ HdSprim *
 HdTinyRenderDelegate::CreateSprim(TfToken const& typeId,
                                     SdfPath const& sprimId)
 {
-    TF_CODING_ERROR("Unknown Sprim type=%s id=%s", 
-        typeId.GetText(), 
-        sprimId.GetText());
+    if (typeId == HdPrimTypeTokens->camera) {
+        return new HdCamera(sprimId);
+    } else if (typeId == HdPrimTypeTokens->material) {
+        return new HdTinyMaterial(sprimId);
+    } else if (typeId == HdPrimTypeTokens->distantLight ||
+               typeId == HdPrimTypeTokens->sphereLight ||
+               typeId == HdPrimTypeTokens->rectLight ||
+               typeId == HdPrimTypeTokens->domeLight) {
+        return new HdTinyLight(sprimId, typeId);
+    } else {
+        TF_CODING_ERROR("Unknown Sprim type=%s id=%s", 
+            typeId.GetText(), 
+            sprimId.GetText());
+    }
     return nullptr;
 }
 
 HdSprim *
 HdTinyRenderDelegate::CreateFallbackSprim(TfToken const& typeId)
 {
-    TF_CODING_ERROR("Creating unknown fallback sprim type=%s", 
-        typeId.GetText()); 
+    if (typeId == HdPrimTypeTokens->camera) {
+        return new HdCamera(SdfPath::EmptyPath());
+    } else if (typeId == HdPrimTypeTokens->material) {
+        return new HdTinyMaterial(SdfPath::EmptyPath());
+    } else if (typeId == HdPrimTypeTokens->distantLight ||
+               typeId == HdPrimTypeTokens->sphereLight ||
+               typeId == HdPrimTypeTokens->rectLight ||
+               typeId == HdPrimTypeTokens->domeLight) {
+        return new HdTinyLight(SdfPath::EmptyPath(), typeId);
+    } else {
+        TF_CODING_ERROR("Creating unknown fallback sprim type=%s", 
+            typeId.GetText()); 
+    }
     return nullptr;
 }
 
 void
 HdTinyRenderDelegate::DestroySprim(HdSprim *sPrim)
 {
-    TF_CODING_ERROR("Destroy Sprim not supported");
+    delete sPrim;
 }
 
 HdBprim *
 HdTinyRenderDelegate::CreateBprim(TfToken const& typeId, SdfPath const& bprimId)
 {
-    TF_CODING_ERROR("Unknown Bprim type=%s id=%s", 
-        typeId.GetText(), 
-        bprimId.GetText());
+    if (typeId == HdPrimTypeTokens->renderBuffer) {
+        return new HdTinyRenderBuffer(bprimId);
+    } else {
+        TF_CODING_ERROR("Unknown Bprim type=%s id=%s", 
+            typeId.GetText(), 
+            bprimId.GetText());
+    }
     return nullptr;
 }
 
 HdBprim *
 HdTinyRenderDelegate::CreateFallbackBprim(TfToken const& typeId)
 {
-    TF_CODING_ERROR("Creating unknown fallback bprim type=%s", 
-        typeId.GetText()); 
+    if (typeId == HdPrimTypeTokens->renderBuffer) {
+        return new HdTinyRenderBuffer(SdfPath::EmptyPath());
+    } else {
+        TF_CODING_ERROR("Creating unknown fallback bprim type=%s", 
+            typeId.GetText()); 
+    }
     return nullptr;
 }
 
 void
 HdTinyRenderDelegate::DestroyBprim(HdBprim *bPrim)
 {
-    TF_CODING_ERROR("Destroy Bprim not supported");
+    delete bPrim;
 }
 
 HdInstancer *
@@ -169,21 +220,58 @@ HdTinyRenderDelegate::CreateInstancer(
     HdSceneDelegate *delegate,
     SdfPath const& id)
 {
-    TF_CODING_ERROR("Creating Instancer not supported id=%s", 
-        id.GetText());
-    return nullptr;
+    return new HdTinyInstancer(delegate, id);
 }
 
 void 
 HdTinyRenderDelegate::DestroyInstancer(HdInstancer *instancer)
 {
-    TF_CODING_ERROR("Destroy instancer not supported");
+    delete instancer;
 }
 
 HdRenderParam *
 HdTinyRenderDelegate::GetRenderParam() const
 {
-    return nullptr;
+    return _renderParam.get();
+}
+
+HdAovDescriptor
+HdTinyRenderDelegate::GetDefaultAovDescriptor(TfToken const& name) const
+{
+    if (name == HdAovTokens->color) {
+        return HdAovDescriptor(HdFormatUNorm8Vec4, false,
+                               VtValue(GfVec4f(0.0f)));
+    } else if (name == HdAovTokens->depth) {
+        return HdAovDescriptor(HdFormatFloat32, false, VtValue(1.0f));
+    } else if (name == HdAovTokens->primId ||
+               name == HdAovTokens->instanceId ||
+               name == HdAovTokens->elementId) {
+        return HdAovDescriptor(HdFormatInt32, false, VtValue(-1));
+    }
+    return HdAovDescriptor();
+}
+
+HdRenderBuffer *
+HdTinyRenderDelegate::GetBatchRenderBuffer(SdfPath const& cameraId,
+                                           TfToken const& aovName) const
+{
+    std::lock_guard<std::mutex> lock(_batchRenderBuffersMutex);
+    auto it = _batchRenderBuffers.find(_BatchBufferKey(cameraId, aovName));
+    return it == _batchRenderBuffers.end() ? nullptr : it->second.get();
+}
+
+HdTinyRenderBuffer *
+HdTinyRenderDelegate::_GetOrCreateBatchRenderBuffer(SdfPath const& cameraId,
+                                                    TfToken const& aovName)
+{
+    std::lock_guard<std::mutex> lock(_batchRenderBuffersMutex);
+    std::unique_ptr<HdTinyRenderBuffer> &rb =
+        _batchRenderBuffers[_BatchBufferKey(cameraId, aovName)];
+    if (!rb) {
+        rb = std::make_unique<HdTinyRenderBuffer>(
+            cameraId.AppendProperty(aovName));
+    }
+    return rb.get();
 }
 
 PXR_NAMESPACE_CLOSE_SCOPE
@@ -11,9 +11,37 @@
 #include "pxr/imaging/hd/renderDelegate.h"
 #include "pxr/imaging/hd/resourceRegistry.h"
 #include "pxr/base/tf/staticTokens.h"
+#include "renderParam.h"
+#include "Scene.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
 
 PXR_NAMESPACE_OPEN_SCOPE
 
+class HdTinyRenderBuffer;
+
+#define HDTINY_RENDER_SETTINGS_TOKENS \
+    (batchCameras)                    \
+    (batchResolution)                 \
+    (optimizeMeshes)                  \
+    (samplesToConvergence)
+
+/// Render settings understood by HdTiny:
+/// - batchCameras (SdfPathVector): camera Sprims that get rendered in the
+///   same pass as the viewer, each into its own color and depth buffer
+///   (see HdTinyRenderDelegate::GetBatchRenderBuffer).
+/// - batchResolution (GfVec2i): resolution of those buffers.
+/// - optimizeMeshes (bool): reorder each mesh's triangles and points for
+///   memory locality when it gets synced (see osc::optimizeMesh); off by
+///   default. Changing it rebuilds all meshes.
+/// - samplesToConvergence (int): samples per pixel the renderer accumulates
+///   before it reports the image as converged and stops tracing it; 16 by
+///   default.
+TF_DECLARE_PUBLIC_TOKENS(HdTinyRenderSettingsTokens,
+                         HDTINY_RENDER_SETTINGS_TOKENS);
+
 ///
 /// \class HdTinyRenderDelegate
 ///
@@ -69,7 +97,24 @@ public:
 
     HdRenderParam *GetRenderParam() const override;
 
+    /// Return the descriptor for the AOVs HdTiny can render (color,
+    /// depth, and primId, instanceId and elementId for picking).
+    HdAovDescriptor GetDefaultAovDescriptor(TfToken const& name) const override;
+
+    /// Return the buffer that the given AOV (color or depth) of a camera
+    /// listed in the batchCameras setting was rendered into, or nullptr if
+    /// that camera hasn't been rendered (yet).
+    HdRenderBuffer *GetBatchRenderBuffer(SdfPath const& cameraId,
+                                         TfToken const& aovName) const;
+
 private:
+    friend class HdTinyRenderPass;
+
+    // Return the buffer to render the given AOV of a batched camera into,
+    // creating it on first use.
+    HdTinyRenderBuffer *_GetOrCreateBatchRenderBuffer(
+        SdfPath const& cameraId, TfToken const& aovName);
+
     static const TfTokenVector SUPPORTED_RPRIM_TYPES;
     static const TfTokenVector SUPPORTED_SPRIM_TYPES;
     static const TfTokenVector SUPPORTED_BPRIM_TYPES;
@@ -78,6 +123,19 @@ private:
 
     HdResourceRegistrySharedPtr _resourceRegistry;
 
+    // The top-level scene: meshes register their geometry and instance
+    // transforms here during Sync, and CommitResources builds the TLAS.
+    osc::Scene _scene;
+
+    // Handed to prims during Sync, to give them access to _scene.
+    std::unique_ptr<HdTinyRenderParam> _renderParam;
+
+    // Output buffers of batched cameras, by camera and AOV name.
+    using _BatchBufferKey = std::pair<SdfPath, TfToken>;
+    std::map<_BatchBufferKey, std::unique_ptr<HdTinyRenderBuffer>>
+        _batchRenderBuffers;
+    mutable std::mutex _batchRenderBuffersMutex;
+
     // This class does not support copying.
     HdTinyRenderDelegate(const HdTinyRenderDelegate &) = delete;
     HdTinyRenderDelegate &operator =(const HdTinyRenderDelegate &) = delete;
@@ -0,0 +1,53 @@
+//
+// Copyright 2020 Pixar
+//
+// Licensed under the terms set forth in the LICENSE.txt file available at
+// https://openusd.org/license.
+//
+#ifndef EXTRAS_IMAGING_EXAMPLES_HD_TINY_RENDER_PARAM_H
+#define EXTRAS_IMAGING_EXAMPLES_HD_TINY_RENDER_PARAM_H
+
+#include "pxr/pxr.h"
+#include "pxr/imaging/hd/renderDelegate.h"
+#include "Scene.h"
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+///
+/// \class HdTinyRenderParam
+///
+/// The render delegate can create an object of type HdRenderParam, to pass
+/// to each prim during Sync(). HdTiny uses this class to pass the top-level
+/// scene, so that prims can register their geometry and instances with it.
+///
+class HdTinyRenderParam final : public HdRenderParam
+{
+public:
+    HdTinyRenderParam(osc::Scene *scene)
+        : _scene(scene)
+        {}
+    virtual ~HdTinyRenderParam() = default;
+
+    /// Accessor for the top-level scene.
+    osc::Scene *GetScene() const { return _scene; }
+
+    /// Record the optimizeMeshes setting that meshes get built with;
+    /// returns whether it changed, ie, all meshes have to be rebuilt.
+    bool UpdateOptimizeMeshes(bool optimizeMeshes) {
+        if (optimizeMeshes == _optimizeMeshes) {
+            return false;
+        }
+        _optimizeMeshes = optimizeMeshes;
+        return true;
+    }
+
+private:
+    /// The top-level scene, owned by the render delegate.
+    osc::Scene *_scene;
+    /// The optimizeMeshes setting as of the last render pass sync.
+    bool _optimizeMeshes = false;
+};
+
+PXR_NAMESPACE_CLOSE_SCOPE
+
+#endif // EXTRAS_IMAGING_EXAMPLES_HD_TINY_RENDER_PARAM_H
@@ -5,6 +5,13 @@
 // https://openusd.org/license.
 //
 #include "renderPass.h"
+#include "renderBuffer.h"
+#include "renderDelegate.h"
+#include "renderParam.h"
+
+#include "pxr/imaging/cameraUtil/conformWindow.h"
+#include "pxr/imaging/hd/camera.h"
+#include "pxr/imaging/hd/renderIndex.h"
 
 #include <iostream>
 
@@ -22,12 +29,127 @@ HdTinyRenderPass::~HdTinyRenderPass()
     std::cout << "Destroying renderPass" << std::endl;
 }
 
+void
+HdTinyRenderPass::_Sync()
+{
+    HdRenderIndex *renderIndex = GetRenderIndex();
+    HdTinyRenderDelegate *renderDelegate =
+        static_cast<HdTinyRenderDelegate*>(renderIndex->GetRenderDelegate());
+    HdTinyRenderParam *renderParam =
+        static_cast<HdTinyRenderParam*>(renderDelegate->GetRenderParam());
+
+    // Meshes bake the setting into their geometry (and look it up in
+    // the resource registry with it), so rebuilding them is all it takes.
+    const bool optimizeMeshes = renderDelegate->GetRenderSetting<bool>(
+        HdTinyRenderSettingsTokens->optimizeMeshes, false);
+    if (renderParam->UpdateOptimizeMeshes(optimizeMeshes)) {
+        renderIndex->GetChangeTracker().MarkAllRprimsDirty(
+            HdChangeTracker::DirtyPoints);
+    }
+}
+
 void
 HdTinyRenderPass::_Execute(
     HdRenderPassStateSharedPtr const& renderPassState,
     TfTokenVector const &renderTags)
 {
-    std::cout << "=> Execute RenderPass" << std::endl;
+    HdRenderIndex *renderIndex = GetRenderIndex();
+    HdTinyRenderDelegate *renderDelegate =
+        static_cast<HdTinyRenderDelegate*>(renderIndex->GetRenderDelegate());
+    HdTinyRenderParam *renderParam =
+        static_cast<HdTinyRenderParam*>(renderDelegate->GetRenderParam());
+
+    _views.clear();
+
+    // Resolve render buffers that were only bound by id.
+    HdRenderPassAovBindingVector aovBindings =
+        renderPassState->GetAovBindings();
+    for (HdRenderPassAovBinding &aov : aovBindings) {
+        if (!aov.renderBuffer) {
+            aov.renderBuffer = static_cast<HdRenderBuffer*>(
+                renderIndex->GetBprim(HdPrimTypeTokens->renderBuffer,
+                                      aov.renderBufferId));
+        }
+    }
+    // HdTiny can only render into AOVs.
+    if (!aovBindings.empty()) {
+        _views.push_back({ renderPassState->GetWorldToViewMatrix(),
+                           renderPassState->GetProjectionMatrix(),
+                           aovBindings });
+    }
+
+    _AddBatchedCameras(renderDelegate);
+
+    if (_views.empty()) {
+        return;
+    }
+    // All views get traced against the same scene in one go.
+    const int samplesToConvergence =
+        renderDelegate->GetRenderSetting<int>(
+            HdTinyRenderSettingsTokens->samplesToConvergence, 16);
+    _renderer.Render(*renderParam->GetScene(), _views, samplesToConvergence);
+}
+
+bool
+HdTinyRenderPass::IsConverged() const
+{
+    return _renderer.IsConverged();
+}
+
+void
+HdTinyRenderPass::_AddBatchedCameras(HdTinyRenderDelegate *renderDelegate)
+{
+    const SdfPathVector cameraIds =
+        renderDelegate->GetRenderSetting<SdfPathVector>(
+            HdTinyRenderSettingsTokens->batchCameras, SdfPathVector());
+    if (cameraIds.empty()) {
+        return;
+    }
+    const GfVec2i resolution =
+        renderDelegate->GetRenderSetting<GfVec2i>(
+            HdTinyRenderSettingsTokens->batchResolution, GfVec2i(640, 480));
+    if (resolution[0] <= 0 || resolution[1] <= 0) {
+        return;
+    }
+    const GfVec3i dimensions(resolution[0], resolution[1], 1);
+    const double aspect = double(resolution[0]) / resolution[1];
+
+    HdRenderIndex *renderIndex = GetRenderIndex();
+    for (SdfPath const& cameraId : cameraIds) {
+        const HdCamera *camera = static_cast<const HdCamera*>(
+            renderIndex->GetSprim(HdPrimTypeTokens->camera, cameraId));
+        if (!camera) {
+            continue;
+        }
+
+        HdTinyRenderBuffer *color =
+            renderDelegate->_GetOrCreateBatchRenderBuffer(
+                cameraId, HdAovTokens->color);
+        HdTinyRenderBuffer *depth =
+            renderDelegate->_GetOrCreateBatchRenderBuffer(
+                cameraId, HdAovTokens->depth);
+        if (color->GetWidth() != unsigned(resolution[0]) ||
+            color->GetHeight() != unsigned(resolution[1])) {
+            color->Allocate(dimensions, HdFormatUNorm8Vec4, false);
+            depth->Allocate(dimensions, HdFormatFloat32, false);
+        }
+
+        HdRenderPassAovBinding colorBinding;
+        colorBinding.aovName = HdAovTokens->color;
+        colorBinding.renderBuffer = color;
+        colorBinding.clearValue = VtValue(GfVec4f(0.0f));
+        HdRenderPassAovBinding depthBinding;
+        depthBinding.aovName = HdAovTokens->depth;
+        depthBinding.renderBuffer = depth;
+        depthBinding.clearValue = VtValue(1.0f);
+
+        // Fit the camera's aperture to the buffer's aspect ratio.
+        _views.push_back({ camera->GetTransform().GetInverse(),
+                           CameraUtilConformedWindow(
+                               camera->ComputeProjectionMatrix(),
+                               CameraUtilFit, aspect),
+                           { colorBinding, depthBinding } });
+    }
 }
 
 PXR_NAMESPACE_CLOSE_SCOPE
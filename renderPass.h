@@ -9,16 +9,22 @@
 
 #include "pxr/pxr.h"
 #include "pxr/imaging/hd/renderPass.h"
-#include "SampleRenderer.h"
+#include "renderer.h"
 
 PXR_NAMESPACE_OPEN_SCOPE
 
+class HdTinyRenderDelegate;
+
 /// \class HdTinyRenderPass
 ///
 /// HdRenderPass represents a single render iteration, rendering a view of the
 /// scene (the HdRprimCollection) for a specific viewer (the camera/viewport
 /// parameters in HdRenderPassState) to the current draw target.
 ///
+/// Cameras listed in the batchCameras render setting are rendered in the
+/// same _Execute as the viewer, each into its own buffers; see
+/// HdTinyRenderSettingsTokens.
+///
 class HdTinyRenderPass final : public HdRenderPass 
 {
 public:
@@ -31,8 +37,15 @@ public:
     /// Renderpass destructor.
     virtual ~HdTinyRenderPass();
 
+    /// Whether every view of the last _Execute has all its samples.
+    bool IsConverged() const override;
+
 protected:
 
+    /// Mark all meshes dirty if the optimizeMeshes setting changed, so
+    /// that they get rebuilt with it; runs before the rprims get synced.
+    void _Sync() override;
+
     /// Draw the scene with the bound renderpass state.
     ///   \param renderPassState Input parameters (including viewer parameters)
     ///                          for this renderpass.
@@ -40,7 +53,16 @@ protected:
     void _Execute(
         HdRenderPassStateSharedPtr const& renderPassState,
         TfTokenVector const &renderTags) override;
-    osc::SampleRenderer sample;
+
+private:
+    // Append a view for each camera of the batchCameras setting.
+    void _AddBatchedCameras(HdTinyRenderDelegate *renderDelegate);
+
+    // The CPU renderer that traces the scene into the bound AOVs.
+    HdTinyRenderer _renderer;
+
+    // Views rendered this _Execute; kept to avoid re-allocating.
+    std::vector<HdTinyRenderer::View> _views;
 };
 
 PXR_NAMESPACE_CLOSE_SCOPE
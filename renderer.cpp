@@ -0,0 +1,405 @@
+//
+// Copyright 2020 Pixar
+//
+// Licensed under the terms set forth in the LICENSE.txt file available at
+// https://openusd.org/license.
+//
+#include "renderer.h"
+#include "renderBuffer.h"
+
+#include "pxr/imaging/hd/tokens.h"
+#include "pxr/base/work/loops.h"
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+using namespace osc;
+
+namespace {
+    // Tiles are square; 16x16 pixels keeps a tile's rays coherent while
+    // still giving enough tiles to balance across threads.
+    const int TILE_SIZE = 16;
+}
+
+HdTinyRenderer::HdTinyRenderer() = default;
+
+HdTinyRenderer::~HdTinyRenderer() = default;
+
+HdTinyRenderer::_ViewState
+HdTinyRenderer::_ResolveView(View const& view)
+{
+    _ViewState state;
+    state.viewMatrix = view.viewMatrix;
+    state.projMatrix = view.projMatrix;
+    state.inverseViewMatrix = view.viewMatrix.GetInverse();
+    state.inverseProjMatrix = view.projMatrix.GetInverse();
+    state.colorBuffer = nullptr;
+    state.depthBuffer = nullptr;
+    state.primIdBuffer = nullptr;
+    state.instanceIdBuffer = nullptr;
+    state.elementIdBuffer = nullptr;
+    state.clearColor = GfVec4f(1.0f);
+    state.accumulation = nullptr;
+
+    for (HdRenderPassAovBinding const& aov : view.aovBindings) {
+        HdTinyRenderBuffer *rb =
+            static_cast<HdTinyRenderBuffer*>(aov.renderBuffer);
+        if (!rb) {
+            continue;
+        }
+        if (aov.aovName == HdAovTokens->color) {
+            state.colorBuffer = rb;
+            if (aov.clearValue.IsHolding<GfVec4f>()) {
+                state.clearColor = aov.clearValue.UncheckedGet<GfVec4f>();
+            }
+        } else if (aov.aovName == HdAovTokens->depth) {
+            state.depthBuffer = rb;
+        } else if (aov.aovName == HdAovTokens->primId) {
+            state.primIdBuffer = rb;
+        } else if (aov.aovName == HdAovTokens->instanceId) {
+            state.instanceIdBuffer = rb;
+        } else if (aov.aovName == HdAovTokens->elementId) {
+            state.elementIdBuffer = rb;
+        }
+    }
+
+    HdTinyRenderBuffer *sizeFrom = _MainBuffer(state);
+    state.width = sizeFrom ? sizeFrom->GetWidth() : 0;
+    state.height = sizeFrom ? sizeFrom->GetHeight() : 0;
+    state.numTilesX = (state.width + TILE_SIZE - 1) / TILE_SIZE;
+    state.numTiles =
+        state.numTilesX * ((state.height + TILE_SIZE - 1) / TILE_SIZE);
+    return state;
+}
+
+HdTinyRenderBuffer *
+HdTinyRenderer::_MainBuffer(_ViewState const& view)
+{
+    HdTinyRenderBuffer *const buffers[] = {
+        view.colorBuffer, view.depthBuffer, view.primIdBuffer,
+        view.instanceIdBuffer, view.elementIdBuffer
+    };
+    for (HdTinyRenderBuffer *buffer : buffers) {
+        if (buffer) {
+            return buffer;
+        }
+    }
+    return nullptr;
+}
+
+HdTinyRenderer::_Accumulation *
+HdTinyRenderer::_GetAccumulation(osc::Scene const& scene,
+                                 _ViewState const& view,
+                                 int samplesToConvergence)
+{
+    HdTinyRenderBuffer const* key = _MainBuffer(view);
+    if (!key || view.width == 0 || view.height == 0) {
+        return nullptr;
+    }
+    _Accumulation &accum = _accumulations[key];
+    accum.used = true;
+
+    // A buffer we converged that isn't flagged converged anymore got
+    // re-allocated, and lost its pixels.
+    const bool reallocated =
+        accum.numSamples >= samplesToConvergence && !key->IsConverged();
+    if (reallocated ||
+        accum.sceneVersion != scene.getVersion() ||
+        accum.width != view.width || accum.height != view.height ||
+        accum.viewMatrix != view.viewMatrix ||
+        accum.projMatrix != view.projMatrix) {
+        accum.viewMatrix = view.viewMatrix;
+        accum.projMatrix = view.projMatrix;
+        accum.width = view.width;
+        accum.height = view.height;
+        accum.sceneVersion = scene.getVersion();
+        accum.numSamples = 0;
+        accum.sum.assign(view.colorBuffer ? size_t(view.width) * view.height
+                                          : 0,
+                         GfVec4f(0.0f));
+    }
+    return &accum;
+}
+
+void
+HdTinyRenderer::Render(osc::Scene const& scene,
+                       std::vector<View> const& views,
+                       int samplesToConvergence)
+{
+    samplesToConvergence = std::max(samplesToConvergence, 1);
+    for (auto &entry : _accumulations) {
+        entry.second.used = false;
+    }
+
+    _views.clear();
+    int maxTiles = 0;
+    for (View const& view : views) {
+        _ViewState state = _ResolveView(view);
+        state.accumulation =
+            _GetAccumulation(scene, state, samplesToConvergence);
+        // Views that have all their samples don't get traced again.
+        if (!state.accumulation ||
+            state.accumulation->numSamples >= samplesToConvergence) {
+            state.numTiles = 0;
+        }
+        _views.push_back(state);
+        maxTiles = std::max(maxTiles, state.numTiles);
+    }
+
+    // Drop the accumulation buffers of views that went away.
+    for (auto it = _accumulations.begin(); it != _accumulations.end(); ) {
+        if (it->second.used) {
+            ++it;
+        } else {
+            it = _accumulations.erase(it);
+        }
+    }
+
+    // Interleave the views' tiles, so that at any time the threads work
+    // on all views at once instead of one view after the other.
+    _tiles.clear();
+    for (int tile = 0; tile < maxTiles; ++tile) {
+        for (int v = 0; v < int(_views.size()); ++v) {
+            if (tile < _views[v].numTiles) {
+                _tiles.emplace_back(v, tile);
+            }
+        }
+    }
+
+    WorkParallelForN(_tiles.size(),
+        [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                _ViewState const& view = _views[_tiles[i].first];
+                const int tile = _tiles[i].second;
+                const int x0 = (tile % view.numTilesX) * TILE_SIZE;
+                const int y0 = (tile / view.numTilesX) * TILE_SIZE;
+                _RenderTile(scene, view, x0, y0,
+                            std::min(x0 + TILE_SIZE, view.width),
+                            std::min(y0 + TILE_SIZE, view.height));
+            }
+        });
+
+    _converged = true;
+    for (_ViewState const& view : _views) {
+        if (!view.accumulation) {
+            continue;
+        }
+        if (view.numTiles > 0) {
+            ++view.accumulation->numSamples;
+        }
+        const bool converged =
+            view.accumulation->numSamples >= samplesToConvergence;
+        _converged = _converged && converged;
+        HdTinyRenderBuffer *const buffers[] = {
+            view.colorBuffer, view.depthBuffer, view.primIdBuffer,
+            view.instanceIdBuffer, view.elementIdBuffer
+        };
+        for (HdTinyRenderBuffer *buffer : buffers) {
+            if (buffer) {
+                buffer->SetConverged(converged);
+            }
+        }
+    }
+}
+
+osc::Ray
+HdTinyRenderer::_GenerateRay(_ViewState const& view, float x, float y) const
+{
+    // Image position in NDC; render buffers are stored bottom row first,
+    // as is NDC.
+    const GfVec3d ndc(2.0 * (x / view.width) - 1.0,
+                      2.0 * (y / view.height) - 1.0,
+                      -1.0);
+    const GfVec3d nearPlane = view.inverseProjMatrix.Transform(ndc);
+
+    GfVec3d origin, dir;
+    if (view.projMatrix[3][3] == 0.0) {
+        // perspective: all rays start at the eye
+        origin = GfVec3d(0.0);
+        dir = nearPlane;
+    } else {
+        // orthographic: all rays are parallel to -z
+        origin = GfVec3d(nearPlane[0], nearPlane[1], 0.0);
+        dir = GfVec3d(0.0, 0.0, -1.0);
+    }
+    origin = view.inverseViewMatrix.Transform(origin);
+    dir = view.inverseViewMatrix.TransformDir(dir).GetNormalized();
+
+    osc::Ray ray;
+    ray.org = vec3f(origin[0], origin[1], origin[2]);
+    ray.dir = vec3f(dir[0], dir[1], dir[2]);
+    return ray;
+}
+
+void
+HdTinyRenderer::_RenderTile(osc::Scene const& scene, _ViewState const& view,
+                            int x0, int y0, int x1, int y1) const
+{
+    _Accumulation &accum = *view.accumulation;
+    const int sampleIndex = accum.numSamples;
+    const float weight = 1.0f / float(sampleIndex + 1);
+    for (int y = y0; y < y1; ++y) {
+        for (int x = x0; x < x1; ++x) {
+            // seeded per pixel and sample, so images don't depend on tile
+            // scheduling, but each sample gets different light samples
+            gdt::LCG<16> random(unsigned(y * view.width + x),
+                                unsigned(sampleIndex));
+            // The first sample goes through the pixel center, so that a
+            // single sample looks like it used to; the others are
+            // jittered across the pixel.
+            float jitterX = 0.5f;
+            float jitterY = 0.5f;
+            if (sampleIndex > 0) {
+                jitterX = random();
+                jitterY = random();
+            }
+            osc::Ray ray = _GenerateRay(view, x + jitterX, y + jitterY);
+            osc::Hit hit;
+            float color[4] = { view.clearColor[0], view.clearColor[1],
+                               view.clearColor[2], view.clearColor[3] };
+            float depth = 1.0f;
+            int primId = -1;
+            int instanceId = -1;
+            int elementId = -1;
+            if (scene.intersect(ray, hit)) {
+                const Instance &inst = scene.getInstance(hit.instID);
+                primId = scene.getPrimID(inst);
+                instanceId = int(inst.instanceID);
+                elementId = inst.geometry->faceOf(hit.primID);
+                const vec3f c = _Shade(scene, ray, hit, random);
+                color[0] = c.x;
+                color[1] = c.y;
+                color[2] = c.z;
+                color[3] = 1.0f;
+                const vec3f hitPos = ray.org + hit.t * ray.dir;
+                depth = _ComputeDepth(view,
+                    GfVec3d(hitPos.x, hitPos.y, hitPos.z));
+            }
+            if (view.colorBuffer) {
+                GfVec4f &sum = accum.sum[size_t(y) * view.width + x];
+                sum += GfVec4f(color[0], color[1], color[2], color[3]);
+                const GfVec4f average = sum * weight;
+                view.colorBuffer->Write(GfVec3i(x, y, 1), 4, average.data());
+            }
+            // Depth and IDs are those of the pixel center, which the
+            // first sample already has.
+            if (sampleIndex == 0) {
+                const GfVec3i pixel(x, y, 1);
+                if (view.depthBuffer) {
+                    view.depthBuffer->Write(pixel, 1, &depth);
+                }
+                if (view.primIdBuffer) {
+                    view.primIdBuffer->Write(pixel, 1, &primId);
+                }
+                if (view.instanceIdBuffer) {
+                    view.instanceIdBuffer->Write(pixel, 1, &instanceId);
+                }
+                if (view.elementIdBuffer) {
+                    view.elementIdBuffer->Write(pixel, 1, &elementId);
+                }
+            }
+        }
+    }
+}
+
+osc::vec3f
+HdTinyRenderer::_Shade(osc::Scene const& scene,
+                       osc::Ray const& ray,
+                       osc::Hit const& hit,
+                       gdt::LCG<16> &random) const
+{
+    const Instance &inst = scene.getInstance(hit.instID);
+    const TriangleMesh &mesh = inst.geometry->mesh;
+    const vec3i index = mesh.index[hit.primID];
+    const float u = hit.u;
+    const float v = hit.v;
+
+    // ------------------------------------------------------------------
+    // geometry normal, brought to world space (normals transform with
+    // the inverse transpose - and worldToObject already is the inverse)
+    // ------------------------------------------------------------------
+    const vec3f &A = mesh.vertex[index.x];
+    const vec3f &B = mesh.vertex[index.y];
+    const vec3f &C = mesh.vertex[index.z];
+    const LinearSpace3f normalXfm = inst.worldToObject.l.transposed();
+    vec3f Ng = xfmVector(normalXfm, cross(B-A, C-A));
+    vec3f Ns = mesh.normal.empty()
+        ? Ng
+        : xfmVector(normalXfm,
+                    (1.f-u-v) * mesh.normal[index.x]
+                    +       u * mesh.normal[index.y]
+                    +       v * mesh.normal[index.z]);
+
+    if (dot(ray.dir, Ng) > 0.f) Ng = -Ng;
+    Ng = normalize(Ng);
+    if (dot(Ng, Ns) < 0.f)
+        Ns -= 2.f*dot(Ng, Ns)*Ng;
+    Ns = normalize(Ns);
+
+    const PackedMaterial &material = scene.getMaterial(inst);
+    vec3f diffuseColor = material.diffuse;
+    const int diffuseTexture = scene.getDiffuseTexture(inst);
+    if (diffuseTexture >= 0 && !mesh.texcoord.empty()) {
+        const vec2f tc = (1.f-u-v) * mesh.texcoord[index.x]
+            +       u * mesh.texcoord[index.y]
+            +       v * mesh.texcoord[index.z];
+        const vec4f texel = scene.sampleTexture(diffuseTexture, tc);
+        diffuseColor *= vec3f(texel.x, texel.y, texel.z);
+    }
+
+    const vec3f surfPos = ray.org + hit.t * ray.dir;
+
+    if (!scene.hasLights()) {
+        // ------------------------------------------------------------------
+        // no lights in the stage: shadow ray towards the (single, fixed)
+        // point light, same setup as the device programs
+        // ------------------------------------------------------------------
+        const vec3f lightPos(-907.108f, 2205.875f, -400.0267f);
+
+        osc::Ray shadowRay;
+        shadowRay.org  = surfPos + 1e-3f * Ng;
+        shadowRay.dir  = lightPos - surfPos;
+        shadowRay.tmin = 1e-3f;
+        shadowRay.tmax = 1.f-1e-3f;
+        const float lightVisibility = scene.occluded(shadowRay) ? 0.f : 1.f;
+
+        const float cosDN = 0.1f + .8f*fabsf(dot(ray.dir, Ns));
+        return (.1f + (.2f + .8f*lightVisibility) * cosDN) * diffuseColor
+            + material.emissive;
+    }
+
+    // ------------------------------------------------------------------
+    // one light, picked proportional to power, and one shadow ray to it
+    // ------------------------------------------------------------------
+    vec3f color = material.emissive;
+    const float u0 = random();
+    const float u1 = random();
+    const float u2 = random();
+    LightSample ls;
+    if (scene.sampleLight(surfPos, Ns, u0, u1, u2, ls)) {
+        const float cosNL = dot(Ns, normalize(ls.dir));
+        if (cosNL > 0.f) {
+            osc::Ray shadowRay;
+            shadowRay.org  = surfPos + 1e-3f * Ng;
+            shadowRay.dir  = ls.dir;
+            shadowRay.tmin = 1e-3f;
+            shadowRay.tmax = 1.f-1e-3f;
+            if (!scene.occluded(shadowRay)) {
+                color += (float(1./M_PI) * cosNL) * diffuseColor
+                    * ls.contribution;
+            }
+        }
+    }
+    return color;
+}
+
+float
+HdTinyRenderer::_ComputeDepth(_ViewState const& view,
+                              GfVec3d const& hitPos) const
+{
+    const GfVec3d clipPos =
+        view.projMatrix.Transform(view.viewMatrix.Transform(hitPos));
+    // For the depth range transform, we assume [0,1].
+    return float((clipPos[2] + 1.0) / 2.0);
+}
+
+PXR_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,149 @@
+//
+// Copyright 2020 Pixar
+//
+// Licensed under the terms set forth in the LICENSE.txt file available at
+// https://openusd.org/license.
+//
+#ifndef EXTRAS_IMAGING_EXAMPLES_HD_TINY_RENDERER_H
+#define EXTRAS_IMAGING_EXAMPLES_HD_TINY_RENDERER_H
+
+#include "pxr/pxr.h"
+#include "pxr/imaging/hd/renderPassState.h"
+#include "pxr/base/gf/matrix4d.h"
+#include "Scene.h"
+#include "gdt/random/random.h"
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+class HdTinyRenderBuffer;
+
+/// \class HdTinyRenderer
+///
+/// HdTinyRenderer implements the CPU rendering path: it traces primary and
+/// shadow rays against the scene's two-level BVH and writes the shaded
+/// result into the bound AOVs. The image is split into tiles which are
+/// rendered in parallel.
+///
+/// Rendering is progressive: every Render() adds one jittered sample per
+/// pixel to a per-view accumulation buffer and writes the running average.
+/// The accumulation starts over when the view's camera, size or the scene
+/// changes, and a view stops being traced once it has the requested number
+/// of samples; only then are its render buffers marked converged.
+///
+/// Several views (e.g. the viewer plus a robot's cameras) can be rendered
+/// in one call. Their tiles are interleaved into a single parallel loop, so
+/// all views share the thread pool and the scene's BVHs stay hot in cache
+/// rather than being streamed through once per view.
+///
+class HdTinyRenderer final
+{
+public:
+    /// One camera, and the AOVs to render it into.
+    struct View {
+        /// The camera's world-to-view matrix.
+        GfMatrix4d viewMatrix;
+        /// The camera's view-to-NDC projection matrix.
+        GfMatrix4d projMatrix;
+        /// The AOVs to write to. Supported are color, depth, and primId,
+        /// instanceId and elementId (the face, in the mesh's own
+        /// topology - whatever triangulation and optimizeMeshes did).
+        HdRenderPassAovBindingVector aovBindings;
+    };
+
+    HdTinyRenderer();
+    ~HdTinyRenderer();
+
+    /// Add one sample per pixel to each of the given views that has fewer
+    /// than samplesToConvergence samples, and write the averages into
+    /// their AOVs.
+    void Render(osc::Scene const& scene, std::vector<View> const& views,
+                int samplesToConvergence);
+
+    /// Whether all views of the last Render() have all their samples.
+    bool IsConverged() const { return _converged; }
+
+private:
+    // Running sum of a view's samples, and what they were taken with.
+    struct _Accumulation {
+        GfMatrix4d viewMatrix;
+        GfMatrix4d projMatrix;
+        int width = 0;
+        int height = 0;
+        uint64_t sceneVersion = 0;
+        int numSamples = 0;
+        std::vector<GfVec4f> sum;
+        // Whether a view of the current Render() still uses this.
+        bool used = false;
+    };
+
+    // Per-view state, resolved from a View once per Render().
+    struct _ViewState {
+        GfMatrix4d viewMatrix;
+        GfMatrix4d projMatrix;
+        GfMatrix4d inverseViewMatrix;
+        GfMatrix4d inverseProjMatrix;
+
+        int width;
+        int height;
+        int numTilesX;
+        int numTiles;
+
+        HdTinyRenderBuffer *colorBuffer;
+        HdTinyRenderBuffer *depthBuffer;
+        // Which prim, instance and face each pixel shows, for picking.
+        HdTinyRenderBuffer *primIdBuffer;
+        HdTinyRenderBuffer *instanceIdBuffer;
+        HdTinyRenderBuffer *elementIdBuffer;
+        GfVec4f clearColor;
+
+        _Accumulation *accumulation;
+    };
+
+    // Resolve matrices, buffers and tiling of the given view.
+    static _ViewState _ResolveView(View const& view);
+
+    // The buffer the view's size comes from, and that identifies its
+    // accumulation: the color buffer, if bound, or else any other.
+    static HdTinyRenderBuffer *_MainBuffer(_ViewState const& view);
+
+    // Find the view's accumulation buffer, restarting it if anything it
+    // was accumulated with changed.
+    _Accumulation *_GetAccumulation(osc::Scene const& scene,
+                                    _ViewState const& view,
+                                    int samplesToConvergence);
+
+    // Add the next sample to all pixels of the view in [x0,x1)x[y0,y1).
+    void _RenderTile(osc::Scene const& scene, _ViewState const& view,
+                     int x0, int y0, int x1, int y1) const;
+
+    // Generate the primary ray through the given point of the image, in
+    // pixels.
+    osc::Ray _GenerateRay(_ViewState const& view, float x, float y) const;
+
+    // Shade the given hit, tracing a single shadow ray to one light
+    // sampled from the scene's lights.
+    osc::vec3f _Shade(osc::Scene const& scene,
+                      osc::Ray const& ray,
+                      osc::Hit const& hit,
+                      gdt::LCG<16> &random) const;
+
+    // Project a world-space point to [0,1] depth.
+    float _ComputeDepth(_ViewState const& view, GfVec3d const& hitPos) const;
+
+    // Scratch space, kept to avoid re-allocating every frame.
+    std::vector<_ViewState> _views;
+    // (view, tile) pairs, round-robin over all views.
+    std::vector<std::pair<int, int>> _tiles;
+    // Accumulation buffers, by the render buffer they are shown in.
+    std::unordered_map<HdTinyRenderBuffer const*, _Accumulation>
+        _accumulations;
+    bool _converged = false;
+};
+
+PXR_NAMESPACE_CLOSE_SCOPE
+
+#endif // EXTRAS_IMAGING_EXAMPLES_HD_TINY_RENDERER_H
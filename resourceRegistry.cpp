@@ -0,0 +1,79 @@
+//
+// Copyright 2020 Pixar
+//
+// Licensed under the terms set forth in the LICENSE.txt file available at
+// https://openusd.org/license.
+//
+#include "resourceRegistry.h"
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+HdTinyResourceRegistry::HdTinyResourceRegistry()
+    : _geometryHits(0)
+    , _geometryMisses(0)
+    , _geometryCollisions(0)
+{
+}
+
+HdTinyResourceRegistry::~HdTinyResourceRegistry() = default;
+
+HdTinyGeometrySharedPtr
+HdTinyResourceRegistry::GetGeometry(GeometryID id,
+                                    GeometryKey const& key,
+                                    GeometryBuilder const& build)
+{
+    std::shared_ptr<_GeometryEntry> entry;
+    bool isFirst = false;
+    {
+        // The instance holds the registry lock while alive, so only
+        // look up/insert here; the (expensive) build happens outside.
+        // The key is set before the lock is released and never changes
+        // afterwards, so it can be compared without the lock.
+        HdInstance<std::shared_ptr<_GeometryEntry>> instance =
+            _geometryRegistry.GetInstance(id);
+        isFirst = instance.IsFirstInstance();
+        if (isFirst) {
+            instance.SetValue(std::make_shared<_GeometryEntry>());
+            instance.GetValue()->key = key;
+        }
+        entry = instance.GetValue();
+    }
+
+    if (isFirst) {
+        ++_geometryMisses;
+    } else if (entry->key == key) {
+        ++_geometryHits;
+    } else {
+        // Same hash, different mesh: build a private geometry that never
+        // enters the registry.
+        ++_geometryCollisions;
+        entry = std::make_shared<_GeometryEntry>();
+        entry->key = key;
+    }
+
+    std::call_once(entry->built, [&]() { build(entry->geometry); });
+
+    // Alias into the entry, so that users of the geometry keep the entry
+    // (and thus the registry's reference count) alive.
+    return HdTinyGeometrySharedPtr(entry, &entry->geometry);
+}
+
+VtDictionary
+HdTinyResourceRegistry::GetResourceAllocation() const
+{
+    VtDictionary result = HdResourceRegistry::GetResourceAllocation();
+    result["geometryHits"] = VtValue(GetGeometryHits());
+    result["geometryMisses"] = VtValue(GetGeometryMisses());
+    result["geometryCollisions"] = VtValue(GetGeometryCollisions());
+    result["uniqueGeometries"] = VtValue(GetNumUniqueGeometries());
+    return result;
+}
+
+void
+HdTinyResourceRegistry::_GarbageCollect()
+{
+    // Drops entries that nothing but the registry refers to anymore.
+    _geometryRegistry.GarbageCollect();
+}
+
+PXR_NAMESPACE_CLOSE_SCOPE
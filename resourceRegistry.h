@@ -0,0 +1,112 @@
+//
+// Copyright 2020 Pixar
+//
+// Licensed under the terms set forth in the LICENSE.txt file available at
+// https://openusd.org/license.
+//
+#ifndef EXTRAS_IMAGING_EXAMPLES_HD_TINY_RESOURCE_REGISTRY_H
+#define EXTRAS_IMAGING_EXAMPLES_HD_TINY_RESOURCE_REGISTRY_H
+
+#include "pxr/pxr.h"
+#include "pxr/imaging/hd/instanceRegistry.h"
+#include "pxr/imaging/hd/meshTopology.h"
+#include "pxr/base/vt/types.h"
+#include "pxr/imaging/hd/resourceRegistry.h"
+#include "pxr/imaging/hf/perfLog.h"
+#include "Scene.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+using HdTinyGeometrySharedPtr = std::shared_ptr<osc::Geometry>;
+
+/// \class HdTinyResourceRegistry
+///
+/// Deduplicates geometry across Rprims. Meshes key their triangles by a
+/// hash of topology and point data; meshes with byte-identical content (as
+/// is common after referencing and flattening) share one osc::Geometry,
+/// i.e. one copy of the triangles and one BLAS. A hash hit is only shared
+/// once the content compares equal, so colliding meshes never alias.
+/// Entries are reference counted and dropped during garbage collection
+/// once no mesh uses them.
+///
+class HdTinyResourceRegistry final : public HdResourceRegistry
+{
+public:
+    HF_MALLOC_TAG_NEW("new HdTinyResourceRegistry");
+
+    HdTinyResourceRegistry();
+    ~HdTinyResourceRegistry() override;
+
+    using GeometryID = HdInstance<HdTinyGeometrySharedPtr>::ID;
+    using GeometryBuilder = std::function<void(osc::Geometry &geometry)>;
+
+    /// The content a geometry is built from. The arrays are shared, not
+    /// copied, so keeping them in the registry is cheap.
+    struct GeometryKey {
+        HdMeshTopology topology;
+        VtVec3fArray points;
+        VtVec2fArray st;
+        bool faceVaryingSt = false;
+        bool optimize = false;
+
+        bool operator==(GeometryKey const& other) const {
+            return optimize == other.optimize
+                && faceVaryingSt == other.faceVaryingSt
+                && topology == other.topology
+                && points == other.points
+                && st == other.st;
+        }
+    };
+
+    /// Return the geometry with the given content hash. If there is none
+    /// yet, a new one is registered and filled in by calling \p build.
+    /// Concurrent callers with the same hash wait for that one build;
+    /// callers with other hashes are not blocked by it. If the registered
+    /// geometry's \p key differs (a hash collision), an unshared geometry
+    /// is built instead.
+    HdTinyGeometrySharedPtr
+    GetGeometry(GeometryID id, GeometryKey const& key,
+                GeometryBuilder const& build);
+
+    /// Number of lookups that found an existing geometry.
+    size_t GetGeometryHits() const { return _geometryHits.load(); }
+
+    /// Number of lookups that had to build a new geometry.
+    size_t GetGeometryMisses() const { return _geometryMisses.load(); }
+
+    /// Number of lookups whose hash matched a different mesh.
+    size_t GetGeometryCollisions() const { return _geometryCollisions.load(); }
+
+    /// Number of distinct geometries currently registered.
+    size_t GetNumUniqueGeometries() const { return _geometryRegistry.size(); }
+
+    /// Reports dedup statistics in addition to the base class' allocation
+    /// info.
+    VtDictionary GetResourceAllocation() const override;
+
+protected:
+    void _GarbageCollect() override;
+
+private:
+    // A registered geometry plus the flag guarding its one-time build.
+    struct _GeometryEntry {
+        GeometryKey key;
+        osc::Geometry geometry;
+        std::once_flag built;
+    };
+
+    HdInstanceRegistry<std::shared_ptr<_GeometryEntry>> _geometryRegistry;
+
+    std::atomic<size_t> _geometryHits;
+    std::atomic<size_t> _geometryMisses;
+    std::atomic<size_t> _geometryCollisions;
+};
+
+PXR_NAMESPACE_CLOSE_SCOPE
+
+#endif // EXTRAS_IMAGING_EXAMPLES_HD_TINY_RESOURCE_REGISTRY_H
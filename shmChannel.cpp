@@ -0,0 +1,217 @@
+// ============================================================================
+// 共享内存观测/动作通道
+// ============================================================================
+#include "shmChannel.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static_assert(sizeof(mjtNum) == sizeof(double), "the channel's arrays are doubles");
+static_assert(std::atomic<uint32_t>::is_always_lock_free
+              && std::atomic<uint64_t>::is_always_lock_free,
+              "atomics in shared memory have to be lock-free");
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+              "futex words are plain 32-bit integers");
+
+static double Now()
+{
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void FutexWake(std::atomic<uint32_t>* word)
+{
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT_MAX,
+            nullptr, nullptr, 0);
+}
+
+static void FutexWait(std::atomic<uint32_t>* word, uint32_t expected, double timeout)
+{
+    timespec ts;
+    ts.tv_sec = time_t(timeout);
+    ts.tv_nsec = long((timeout - double(ts.tv_sec)) * 1e9);
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected,
+            &ts, nullptr, 0);
+}
+
+// 读不到完整的槽时的退避：先让出 CPU，之后睡眠时间逐次加倍（最长约 1ms）
+static void Backoff(int attempt)
+{
+    if (attempt < 4)
+        std::this_thread::yield();
+    else
+        std::this_thread::sleep_for(std::chrono::microseconds(1 << std::min(attempt - 4, 10)));
+}
+
+static uint64_t AlignUp(uint64_t size)
+{
+    return (size + 63) & ~uint64_t(63);
+}
+
+bool ShmChannel::Create(const std::string& name, const mjModel* m,
+                        uint32_t obsSlots, uint32_t actSlots)
+{
+    Close();
+    this->name = name.empty() || name[0] != '/' ? "/" + name : name;
+    this->obsSlots = obsSlots;
+    this->actSlots = actSlots;
+
+    const uint64_t obsSlotSize = AlignUp(sizeof(ShmSlot)
+        + sizeof(double) * (m->nq + m->nv + m->nsensordata));
+    const uint64_t actSlotSize = AlignUp(sizeof(ShmSlot) + sizeof(double) * m->nu);
+    const uint64_t obsOffset = AlignUp(sizeof(ShmHeader));
+    const uint64_t actOffset = obsOffset + obsSlots * obsSlotSize;
+    size = actOffset + actSlots * actSlotSize;
+
+    // 先删掉同名的旧段，仍映射着它的客户端不受影响
+    shm_unlink(this->name.c_str());
+    const int fd = shm_open(this->name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0)
+    {
+        std::cerr << "shm_open failed: " << this->name << std::endl;
+        return false;
+    }
+    void* memory = MAP_FAILED;
+    if (ftruncate(fd, off_t(size)) == 0)
+        memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED)
+    {
+        std::cerr << "Failed to map shared memory: " << this->name << std::endl;
+        shm_unlink(this->name.c_str());
+        return false;
+    }
+
+    // 新段全是 0，原子量和序号都从 0 开始
+    header = static_cast<ShmHeader*>(memory);
+    header->version = VERSION;
+    header->nq = uint32_t(m->nq);
+    header->nv = uint32_t(m->nv);
+    header->nu = uint32_t(m->nu);
+    header->nsensordata = uint32_t(m->nsensordata);
+    header->obsSlots = obsSlots;
+    header->actSlots = actSlots;
+    header->obsSlotSize = obsSlotSize;
+    header->actSlotSize = actSlotSize;
+    header->obsOffset = obsOffset;
+    header->actOffset = actOffset;
+    step = 0;
+    lastAction = 0;
+    action.assign(m->nu, 0.0);
+    // magic 最后写，客户端看到它就说明头部完整了
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header->magic, MAGIC, sizeof(MAGIC));
+    return true;
+}
+
+void ShmChannel::Close()
+{
+    if (!header)
+        return;
+    header->closed.store(1, std::memory_order_release);
+    header->obsFutex.fetch_add(1, std::memory_order_release);
+    header->actFutex.fetch_add(1, std::memory_order_release);
+    FutexWake(&header->obsFutex);
+    FutexWake(&header->actFutex);
+    munmap(header, size);
+    shm_unlink(name.c_str());
+    header = nullptr;
+}
+
+bool ShmChannel::Matches(const mjModel* m) const
+{
+    return header && header->nq == uint32_t(m->nq) && header->nv == uint32_t(m->nv)
+        && header->nu == uint32_t(m->nu) && header->nsensordata == uint32_t(m->nsensordata);
+}
+
+ShmSlot* ShmChannel::Slot(uint64_t offset, uint64_t slotSize, uint64_t index) const
+{
+    return reinterpret_cast<ShmSlot*>(reinterpret_cast<char*>(header) + offset + index * slotSize);
+}
+
+void ShmChannel::Publish(const mjModel* m, const mjData* d)
+{
+    if (!header)
+        return;
+    if (!Matches(m))
+    {
+        const std::string channelName = name;
+        if (!Create(channelName, m, obsSlots, actSlots))
+            return;
+    }
+
+    const uint64_t n = header->obsCount.load(std::memory_order_relaxed);
+    ShmSlot* slot = Slot(header->obsOffset, header->obsSlotSize, n % header->obsSlots);
+    slot->sequence.store(2 * n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot->step = step++;
+    slot->time = d->time;
+    double* payload = reinterpret_cast<double*>(slot + 1);
+    std::memcpy(payload, d->qpos, sizeof(double) * m->nq);
+    std::memcpy(payload + m->nq, d->qvel, sizeof(double) * m->nv);
+    std::memcpy(payload + m->nq + m->nv, d->sensordata, sizeof(double) * m->nsensordata);
+    slot->sequence.store(2 * n + 2, std::memory_order_release);
+
+    header->obsCount.store(n + 1, std::memory_order_release);
+    header->obsFutex.fetch_add(1, std::memory_order_release);
+    FutexWake(&header->obsFutex);
+}
+
+bool ShmChannel::ReadAction(const mjModel* m, mjData* d)
+{
+    // 模型重新编译后 Publish 会按新尺寸重建共享内存段，在那之前旧段的动作
+    // 对不上当前模型
+    if (!Matches(m))
+        return false;
+
+    // 序号是奇数或读前读后不一致，说明客户端写得比我们读得快、绕了一圈正在
+    // 覆盖这个槽，这时已经有更新的动作了：退避一下，取最新的槽重读。
+    // 读到一半的数据只进 action，不会写坏 d->ctrl
+    for (int attempt = 0; attempt < 16; ++attempt)
+    {
+        const uint64_t n = header->actCount.load(std::memory_order_acquire);
+        if (n == lastAction)
+            return false;
+        const ShmSlot* slot = Slot(header->actOffset, header->actSlotSize, (n - 1) % header->actSlots);
+        const uint64_t before = slot->sequence.load(std::memory_order_acquire);
+        if (!(before & 1))
+        {
+            std::memcpy(action.data(), slot + 1, sizeof(double) * m->nu);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot->sequence.load(std::memory_order_relaxed) == before)
+            {
+                std::memcpy(d->ctrl, action.data(), sizeof(double) * m->nu);
+                lastAction = n;
+                return true;
+            }
+        }
+        Backoff(attempt);
+    }
+    return false;
+}
+
+bool ShmChannel::WaitForAction(double deadline)
+{
+    if (!header)
+        return false;
+    // 先看 deadline：客户端总是立刻回动作时，调用方的循环也要按时结束
+    for (;;)
+    {
+        const double timeout = deadline - Now();
+        if (timeout <= 0.0)
+            return false;
+        const uint32_t futex = header->actFutex.load(std::memory_order_acquire);
+        if (header->actCount.load(std::memory_order_acquire) != lastAction)
+            return true;
+        FutexWait(&header->actFutex, futex, timeout);
+    }
+}
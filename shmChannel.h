@@ -0,0 +1,91 @@
+// ============================================================================
+// 共享内存观测/动作通道：外部控制器（同机的 Python/C++ 进程）驱动仿真
+// ============================================================================
+#pragma once
+
+#include <mujoco/mujoco.h>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 共享内存布局。客户端用同样的定义（或按偏移）映射，原地读写，不做序列化：
+//
+//   ShmHeader
+//   观测环（服务端写）：obsSlots 个槽，每槽 obsSlotSize 字节，
+//                       ShmSlot 后面依次是 qpos[nq] qvel[nv] sensordata[nsensordata]
+//   动作环（客户端写）：actSlots 个槽，每槽 actSlotSize 字节，
+//                       ShmSlot 后面是 ctrl[nu]
+//
+// 所有数组都是 double。每个槽是一个序号锁：写之前 sequence 置为奇数，写完
+// 置为偶数；读方读数据前后各读一次 sequence，相同且为偶数才有效。
+// obsCount/actCount 是已经写完的样本数，最新样本在槽 (count - 1) % slots。
+//
+// 通知用 futex：写完一个样本后 obsFutex/actFutex 加一并 FUTEX_WAKE，
+// 等待方在旧值上 FUTEX_WAIT（非 PRIVATE，跨进程有效）。
+//
+// 模型重新编译导致尺寸变化时，服务端把旧段的 closed 置 1、唤醒所有等待方，
+// 再用同一个名字建新段；客户端看到 closed 后重新打开。
+struct ShmSlot {
+    std::atomic<uint64_t> sequence;
+    // 观测：仿真步数；动作：客户端自己的编号
+    uint64_t step;
+    double time;
+    uint64_t reserved;
+};
+
+struct ShmHeader {
+    char magic[8];
+    uint32_t version;
+    std::atomic<uint32_t> closed;
+    uint32_t nq, nv, nu, nsensordata;
+    uint32_t obsSlots, actSlots;
+    uint64_t obsSlotSize, actSlotSize;
+    uint64_t obsOffset, actOffset;
+
+    // 服务端写的放一条 cache line，客户端写的放另一条
+    alignas(64) std::atomic<uint32_t> obsFutex;
+    std::atomic<uint64_t> obsCount;
+    alignas(64) std::atomic<uint32_t> actFutex;
+    std::atomic<uint64_t> actCount;
+};
+
+class ShmChannel {
+public:
+    static constexpr char MAGIC[8] = {'M', 'J', 'U', 'S', 'D', 'S', 'H', 'M'};
+    static constexpr uint32_t VERSION = 1;
+
+    ShmChannel() = default;
+    ~ShmChannel() { Close(); }
+    ShmChannel(const ShmChannel&) = delete;
+    ShmChannel& operator=(const ShmChannel&) = delete;
+
+    // 按模型的尺寸建共享内存段（name 形如 "/mjusd"，不带 / 会自动补上）
+    bool Create(const std::string& name, const mjModel* m,
+                uint32_t obsSlots = 64, uint32_t actSlots = 64);
+    void Close();
+    bool IsOpen() const { return header != nullptr; }
+    // 共享内存段的尺寸和模型一致
+    bool Matches(const mjModel* m) const;
+
+    // 写一个观测；模型尺寸变了会先重建共享内存段
+    void Publish(const mjModel* m, const mjData* d);
+    // 有新动作时拷到 d->ctrl 并返回 true；只取最新的一个。没有新动作、
+    // 读不到完整的槽或尺寸和模型对不上时返回 false，d->ctrl 不变
+    bool ReadAction(const mjModel* m, mjData* d);
+    // 等到有新动作或过了 deadline（steady_clock 秒）；返回是否有新动作。
+    // 过了 deadline 一律返回 false，即使有新动作也留到下一次
+    bool WaitForAction(double deadline);
+
+private:
+    ShmSlot* Slot(uint64_t offset, uint64_t slotSize, uint64_t index) const;
+
+    std::string name;
+    ShmHeader* header = nullptr;
+    size_t size = 0;
+    uint32_t obsSlots = 0, actSlots = 0;
+    uint64_t step = 0;
+    uint64_t lastAction = 0;
+    // 读动作的缓冲，确认读到完整的槽后才拷进 d->ctrl
+    std::vector<double> action;
+};
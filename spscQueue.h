@@ -0,0 +1,43 @@
+// ============================================================================
+// 单生产者 / 单消费者无锁环形队列
+// ============================================================================
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// 容量固定（CAPACITY 必须是 2 的幂），push/pop 都不分配内存也不加锁。
+// 只允许一个线程 push、一个线程 pop；head/tail 各占一条 cache line，
+// 避免两边互相抢同一行。
+template <typename T, size_t CAPACITY>
+class SpscQueue {
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "capacity must be a power of two");
+
+public:
+    // 生产者调用；队列满时返回 false（事件被丢弃）
+    bool Push(const T& item)
+    {
+        const size_t tail = this->tail.load(std::memory_order_relaxed);
+        if (tail - head.load(std::memory_order_acquire) == CAPACITY)
+            return false;
+        items[tail & (CAPACITY - 1)] = item;
+        this->tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 消费者调用；队列空时返回 false
+    bool Pop(T& item)
+    {
+        const size_t head = this->head.load(std::memory_order_relaxed);
+        if (head == tail.load(std::memory_order_acquire))
+            return false;
+        item = items[head & (CAPACITY - 1)];
+        this->head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) std::atomic<size_t> tail{0};
+    alignas(64) T items[CAPACITY];
+};
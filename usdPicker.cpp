@@ -0,0 +1,282 @@
+// ============================================================================
+// CPU 拾取：网格 BVH 的维护与射线求交
+// ============================================================================
+#include "usdPicker.h"
+#include "Triangulate.h"
+#include <pxr/usd/usd/primRange.h>
+#include <pxr/usd/usdGeom/mesh.h>
+#include <pxr/usd/usdGeom/tokens.h>
+#include <pxr/usd/usdGeom/xformCache.h>
+#include <pxr/usd/usdGeom/xformOp.h>
+#include <pxr/base/gf/ray.h>
+#include <tbb/parallel_for.h>
+#include <algorithm>
+
+using namespace pxr;
+
+static osc::vec3f ToVec3f(const GfVec3d& v)
+{
+    return osc::vec3f(float(v[0]), float(v[1]), float(v[2]));
+}
+
+// 原型（prototype）里的编辑按原型的路径通知，而网格按实例代理的路径登记：
+// 换成每个实例下对应的代理路径（实例本身在原型里时再换一层）
+static SdfPathVector InstanceProxyPaths(const UsdStageRefPtr& stage, const SdfPath& path)
+{
+    const SdfPathVector prefixes = path.GetPrefixes();
+    if (prefixes.empty())
+        return {path};
+    const SdfPath& root = prefixes.front();
+    const UsdPrim prototype = stage->GetPrimAtPath(root);
+    if (!prototype || !prototype.IsPrototype())
+        return {path};
+    SdfPathVector paths;
+    for (const UsdPrim& instance : prototype.GetInstances())
+        for (const SdfPath& p : InstanceProxyPaths(stage, path.ReplacePrefix(root, instance.GetPath())))
+            paths.push_back(p);
+    return paths;
+}
+
+UsdPicker::UsdPicker(const UsdStageRefPtr& stage)
+    : stage(stage)
+{
+    if (!stage)
+        return;
+    AddMeshes(stage->GetPseudoRoot());
+    noticeKey = TfNotice::Register(TfCreateWeakPtr(this), &UsdPicker::OnObjectsChanged,
+                                   UsdStageWeakPtr(stage));
+}
+
+UsdPicker::~UsdPicker()
+{
+    TfNotice::Revoke(noticeKey);
+}
+
+void UsdPicker::AddMeshes(const UsdPrim& root)
+{
+    // 和 UsdLoader 一样进到原生实例里，实例里的网格按代理路径登记，
+    // 拾取和高亮的都是那一个实例
+    for (const UsdPrim& prim : UsdPrimRange(root, UsdTraverseInstanceProxies()))
+    {
+        if (!prim.IsA<UsdGeomMesh>())
+            continue;
+        // 和渲染一致：不可见的、guide 用途的网格拾取不到
+        UsdGeomMesh usdMesh(prim);
+        if (usdMesh.ComputeVisibility() == UsdGeomTokens->invisible
+            || usdMesh.ComputePurpose() == UsdGeomTokens->guide)
+            continue;
+        std::unique_ptr<Mesh> mesh(new Mesh);
+        mesh->path = prim.GetPath();
+        mesh->pointsVarying = usdMesh.GetPointsAttr().ValueMightBeTimeVarying();
+        meshes[mesh->path] = std::move(mesh);
+    }
+    dirtyTransforms = true;
+}
+
+void UsdPicker::RemoveMeshes(const SdfPath& root)
+{
+    for (auto it = meshes.begin(); it != meshes.end();)
+    {
+        if (it->first.HasPrefix(root))
+            it = meshes.erase(it);
+        else
+            ++it;
+    }
+    dirtyTransforms = true;
+}
+
+void UsdPicker::BuildGeometry(Mesh& mesh)
+{
+    UsdGeomMesh usdMesh(stage->GetPrimAtPath(mesh.path));
+    VtArray<GfVec3f> points;
+    VtIntArray faceCounts, faceIndices;
+    usdMesh.GetPointsAttr().Get(&points, time);
+    usdMesh.GetFaceVertexCountsAttr().Get(&faceCounts, time);
+    usdMesh.GetFaceVertexIndicesAttr().Get(&faceIndices, time);
+
+    const osc::vec3f* vertex = reinterpret_cast<const osc::vec3f*>(points.cdata());
+    mesh.vertex.assign(vertex, vertex + points.size());
+    const osc::PolygonMesh polygons = {
+        faceCounts.cdata(), faceCounts.size(),
+        faceIndices.cdata(), faceIndices.size(),
+        mesh.vertex.data(), mesh.vertex.size()
+    };
+    mesh.index.resize(osc::maxTriangles(polygons));
+    mesh.index.resize(osc::triangulate(polygons, mesh.index.data()));
+
+    std::vector<osc::box3f> bounds(mesh.index.size());
+    for (size_t i = 0; i < mesh.index.size(); ++i)
+    {
+        const osc::vec3i idx = mesh.index[i];
+        bounds[i].extend(mesh.vertex[idx.x]);
+        bounds[i].extend(mesh.vertex[idx.y]);
+        bounds[i].extend(mesh.vertex[idx.z]);
+    }
+    mesh.bvh.build(bounds);
+    mesh.dirtyGeometry = false;
+}
+
+void UsdPicker::OnObjectsChanged(UsdNotice::ObjectsChanged const& notice,
+                                 UsdStageWeakPtr const& sender)
+{
+    if (sender != stage)
+        return;
+    for (const SdfPath& path : notice.GetResyncedPaths())
+        pendingResyncs.insert(path.GetPrimPath());
+    for (const SdfPath& path : notice.GetChangedInfoOnlyPaths())
+    {
+        if (!path.IsPropertyPath())
+            continue;
+        const TfToken& name = path.GetNameToken();
+        if (UsdGeomXformOp::IsXformOp(name) || name == UsdGeomTokens->xformOpOrder)
+            dirtyTransforms = true;
+        else if (name == UsdGeomTokens->visibility || name == UsdGeomTokens->purpose)
+            pendingResyncs.insert(path.GetPrimPath());
+        else if (name == UsdGeomTokens->points
+                 || name == UsdGeomTokens->faceVertexCounts
+                 || name == UsdGeomTokens->faceVertexIndices)
+            pendingGeometry.insert(path.GetPrimPath());
+    }
+}
+
+void UsdPicker::Update(UsdTimeCode time)
+{
+    if (!stage)
+        return;
+    if (time != this->time)
+    {
+        this->time = time;
+        dirtyTransforms = true;
+        for (auto& entry : meshes)
+            entry.second->dirtyGeometry |= entry.second->pointsVarying;
+    }
+
+    SdfPathVector resyncs;
+    for (const SdfPath& path : pendingResyncs)
+        for (const SdfPath& p : InstanceProxyPaths(stage, path))
+            resyncs.push_back(p);
+    pendingResyncs.clear();
+    SdfPath::RemoveDescendentPaths(&resyncs);
+    for (const SdfPath& path : resyncs)
+    {
+        RemoveMeshes(path);
+        if (UsdPrim prim = stage->GetPrimAtPath(path))
+            AddMeshes(prim);
+    }
+    SdfPathVector geometry;
+    for (const SdfPath& path : pendingGeometry)
+        for (const SdfPath& p : InstanceProxyPaths(stage, path))
+            geometry.push_back(p);
+    pendingGeometry.clear();
+    for (const SdfPath& path : geometry)
+    {
+        auto it = meshes.find(path);
+        if (it != meshes.end())
+        {
+            it->second->pointsVarying = UsdGeomMesh(stage->GetPrimAtPath(path))
+                                            .GetPointsAttr().ValueMightBeTimeVarying();
+            it->second->dirtyGeometry = true;
+            dirtyTransforms = true;
+        }
+    }
+
+    // 重新三角化、建 BVH 的网格之间并行
+    std::vector<Mesh*> dirty;
+    for (auto& entry : meshes)
+        if (entry.second->dirtyGeometry)
+            dirty.push_back(entry.second.get());
+    if (!dirty.empty())
+    {
+        tbb::parallel_for(size_t(0), dirty.size(), [&](size_t i) {
+            BuildGeometry(*dirty[i]);
+        });
+        dirtyTransforms = true;
+    }
+    if (!dirtyTransforms)
+        return;
+
+    // 变换和世界包围盒，再重建顶层 BVH
+    UsdGeomXformCache xformCache(time);
+    meshList.clear();
+    std::vector<osc::box3f> bounds;
+    for (auto& entry : meshes)
+    {
+        Mesh& mesh = *entry.second;
+        if (mesh.bvh.empty())
+            continue;
+        mesh.localToWorld = xformCache.GetLocalToWorldTransform(stage->GetPrimAtPath(mesh.path));
+        mesh.worldToLocal = mesh.localToWorld.GetInverse();
+        mesh.worldBounds = osc::box3f();
+        for (int corner = 0; corner < 8; ++corner)
+        {
+            const GfVec3d p((corner & 1) ? mesh.bvh.bounds.upper.x : mesh.bvh.bounds.lower.x,
+                            (corner & 2) ? mesh.bvh.bounds.upper.y : mesh.bvh.bounds.lower.y,
+                            (corner & 4) ? mesh.bvh.bounds.upper.z : mesh.bvh.bounds.lower.z);
+            mesh.worldBounds.extend(ToVec3f(mesh.localToWorld.Transform(p)));
+        }
+        meshList.push_back(&mesh);
+        bounds.push_back(mesh.worldBounds);
+    }
+    topLevel.build(bounds);
+    dirtyTransforms = false;
+}
+
+bool UsdPicker::Pick(const GfVec3d& origin, const GfVec3d& direction, PickHit* hit) const
+{
+    osc::Ray ray;
+    ray.org = ToVec3f(origin);
+    ray.dir = ToVec3f(direction);
+
+    const Mesh* hitMesh = nullptr;
+    uint32_t hitTriangle = 0;
+    topLevel.traverse(ray, [&](uint32_t meshID, osc::Ray& worldRay) {
+        const Mesh& mesh = *meshList[meshID];
+        // 射线变到网格局部空间；方向不归一化，t 的含义不变
+        osc::Ray local;
+        local.org = ToVec3f(mesh.worldToLocal.Transform(origin));
+        local.dir = ToVec3f(mesh.worldToLocal.TransformDir(direction));
+        local.tmin = worldRay.tmin;
+        local.tmax = worldRay.tmax;
+        const bool found = mesh.bvh.traverse(local, [&](uint32_t primID, osc::Ray& r) {
+            const osc::vec3i idx = mesh.index[primID];
+            float t, u, v;
+            if (!osc::intersectTriangle(r, mesh.vertex[idx.x], mesh.vertex[idx.y],
+                                        mesh.vertex[idx.z], t, u, v))
+                return false;
+            r.tmax = t;
+            hitTriangle = primID;
+            return true;
+        });
+        if (!found)
+            return false;
+        worldRay.tmax = local.tmax;
+        hitMesh = &mesh;
+        return true;
+    });
+    if (!hitMesh)
+        return false;
+
+    if (hit)
+    {
+        const osc::vec3i idx = hitMesh->index[hitTriangle];
+        const osc::vec3f A = hitMesh->vertex[idx.x];
+        const osc::vec3f n = cross(hitMesh->vertex[idx.y] - A, hitMesh->vertex[idx.z] - A);
+        // 法线按逆转置变到世界空间
+        GfVec3d normal = hitMesh->worldToLocal.GetTranspose().TransformDir(GfVec3d(n.x, n.y, n.z));
+        normal.Normalize();
+        if (GfDot(normal, direction) > 0.0)
+            normal = -normal;
+
+        hit->primPath = hitMesh->path;
+        hit->point = origin + double(ray.tmax) * direction;
+        hit->normal = normal;
+        hit->distance = double(ray.tmax) * direction.GetLength();
+    }
+    return true;
+}
+
+bool UsdPicker::Pick(const GfFrustum& frustum, const GfVec2d& ndc, PickHit* hit) const
+{
+    const GfRay ray = frustum.ComputeRay(ndc);
+    return Pick(ray.GetStartPoint(), ray.GetDirection(), hit);
+}
@@ -0,0 +1,79 @@
+// ============================================================================
+// CPU 拾取：对 Stage 上的网格做射线求交，代替每帧的 Hydra ID 渲染
+// ============================================================================
+#pragma once
+
+#include <pxr/usd/usd/notice.h>
+#include <pxr/usd/usd/stage.h>
+#include <pxr/usd/sdf/path.h>
+#include <pxr/base/gf/frustum.h>
+#include <pxr/base/gf/matrix4d.h>
+#include <pxr/base/gf/vec3d.h>
+#include <pxr/base/tf/notice.h>
+#include <pxr/base/tf/weakBase.h>
+#include "BVH.h"
+#include <memory>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+struct PickHit {
+    pxr::SdfPath primPath;
+    pxr::GfVec3d point;
+    // 朝向射线一侧的几何法线
+    pxr::GfVec3d normal;
+    double distance = 0.0;
+};
+
+// 每个网格在局部空间建一棵 BVH，外面再套一棵按世界包围盒建的顶层 BVH。
+//
+// 刚体移动只改变换，顶层 BVH 重建一下即可（网格数很少）；只有顶点或拓扑
+// 变化时才重新三角化、重建该网格的 BVH。Stage 的编辑通过
+// UsdNotice::ObjectsChanged 收集，在 Update 里一次性处理。
+class UsdPicker : public pxr::TfWeakBase {
+public:
+    explicit UsdPicker(const pxr::UsdStageRefPtr& stage);
+    ~UsdPicker();
+
+    // 每帧调用一次，时间变化或 Stage 有编辑时刷新
+    void Update(pxr::UsdTimeCode time);
+
+    // 世界空间射线求最近交点
+    bool Pick(const pxr::GfVec3d& origin, const pxr::GfVec3d& direction, PickHit* hit) const;
+    // 从视点穿过窗口坐标 ndc（[-1,1]）的射线
+    bool Pick(const pxr::GfFrustum& frustum, const pxr::GfVec2d& ndc, PickHit* hit) const;
+
+private:
+    struct Mesh {
+        pxr::SdfPath path;
+        // 局部空间的三角形和 BVH
+        std::vector<osc::vec3f> vertex;
+        std::vector<osc::vec3i> index;
+        osc::WideBVH bvh;
+        bool pointsVarying = false;
+        bool dirtyGeometry = true;
+
+        pxr::GfMatrix4d localToWorld;
+        pxr::GfMatrix4d worldToLocal;
+        osc::box3f worldBounds;
+    };
+
+    void AddMeshes(const pxr::UsdPrim& root);
+    void RemoveMeshes(const pxr::SdfPath& root);
+    void BuildGeometry(Mesh& mesh);
+
+    void OnObjectsChanged(pxr::UsdNotice::ObjectsChanged const& notice,
+                          pxr::UsdStageWeakPtr const& sender);
+
+    pxr::UsdStageRefPtr stage;
+    std::unordered_map<pxr::SdfPath, std::unique_ptr<Mesh>, pxr::SdfPath::Hash> meshes;
+    // 顶层 BVH 的图元 i 对应 meshList[i]
+    std::vector<Mesh*> meshList;
+    osc::WideBVH topLevel;
+
+    pxr::UsdTimeCode time = pxr::UsdTimeCode::Default();
+    bool dirtyTransforms = true;
+    pxr::TfNotice::Key noticeKey;
+    std::set<pxr::SdfPath> pendingResyncs;
+    std::set<pxr::SdfPath> pendingGeometry;
+};